@@ -0,0 +1,87 @@
+#include "battery.h"
+
+// ADC reading at which each level starts, from the discharge curve of the cell.
+static const uint16_t battery_level_voltage[] = {569, 606, 642, 676, 703, 722, 732, 740, 747, 753, 759, 764, 769, 773, 776, 780, 783, 785, 788, 790, 792, 794, 796, 798, 800, 801, 803, 804, 805, 807, 808, 809, 810, 811, 812, 813, 814, 815, 816, 817, 818, 819, 820, 820, 821, 822, 823, 823, 824, 825, 825, 826, 827, 827, 828, 829, 829, 830, 830, 831, 831, 832, 833, 833, 834, 834, 835, 835, 836, 836, 837, 837, 838, 838, 839, 839, 840, 840, 841, 842, 842, 843, 843, 844, 844, 844, 845, 845, 845, 845, 846, 846, 846, 847, 847, 848, 849, 850, 851, 853, 876, 907, 937, 967, 996, 1023};
+
+#define BATTERY_TABLE_SIZE (sizeof(battery_level_voltage) / sizeof(battery_level_voltage[0]))
+
+uint16_t battery_raw_to_mv(uint16_t raw) {
+  // 3600 / 1024 == 225 / 64, exact
+  return (uint16_t)(((uint32_t)raw * 225) >> 6);
+}
+
+uint8_t battery_level_get(uint16_t raw) {
+  // number of table entries <= raw, the table is sorted
+  uint8_t lo = 0;
+  uint8_t hi = BATTERY_TABLE_SIZE;
+  while (lo < hi) {
+    uint8_t mid = (lo + hi) / 2;
+    if (battery_level_voltage[mid] <= raw) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo > BATTERY_LEVEL_MAX ? BATTERY_LEVEL_MAX : lo;
+}
+
+uint16_t battery_burst_median(int16_t *p_samples, uint8_t count) {
+  // insertion sort, a burst is a handful of readings
+  for (uint8_t i = 1; i < count; i++) {
+    int16_t v = p_samples[i];
+    uint8_t j = i;
+    while (j > 0 && p_samples[j - 1] > v) {
+      p_samples[j] = p_samples[j - 1];
+      j--;
+    }
+    p_samples[j] = v;
+  }
+
+  int32_t median = (count % 2) ? p_samples[count / 2] : (p_samples[count / 2 - 1] + p_samples[count / 2] + 1) / 2;
+  return median < 0 ? 0 : (uint16_t)median;
+}
+
+uint16_t battery_filter_update(battery_filter_t *p_filter, uint16_t raw) {
+  int32_t value = (int32_t)raw << BATTERY_FILTER_FRAC;
+
+  if (!p_filter->valid) {
+    p_filter->value = (uint16_t)value;
+    p_filter->valid = true;
+  } else {
+    // settles up to 2^shift - 1 fraction LSB short of a rising reading, well below 1 LSB
+    p_filter->value = (uint16_t)(p_filter->value + ((value - p_filter->value) >> BATTERY_FILTER_SHIFT));
+  }
+  return p_filter->value;
+}
+
+uint16_t battery_filtered_to_raw(uint16_t filtered) {
+  return (filtered + (1 << (BATTERY_FILTER_FRAC - 1))) >> BATTERY_FILTER_FRAC;
+}
+
+uint16_t battery_filtered_to_mv(uint16_t filtered) {
+  return (uint16_t)(((uint32_t)filtered * 225) >> (6 + BATTERY_FILTER_FRAC));
+}
+
+bool battery_level_update(battery_level_t *p_battery, uint16_t raw) {
+  uint8_t level = battery_level_get(raw);
+
+  if (p_battery->valid) {
+    if (level > p_battery->level) {
+      level = battery_level_get(raw > BATTERY_HYSTERESIS_RAW ? raw - BATTERY_HYSTERESIS_RAW : 0);
+      if (level <= p_battery->level) {
+        return false;
+      }
+    } else if (level < p_battery->level) {
+      level = battery_level_get(raw + BATTERY_HYSTERESIS_RAW);
+      if (level >= p_battery->level) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+
+  p_battery->level = level;
+  p_battery->valid = true;
+  return true;
+}
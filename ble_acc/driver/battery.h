@@ -0,0 +1,86 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @file
+ * @brief Battery level estimation from the 10 bit supply ADC reading.
+ *
+ * The ADC measures VDD / 3 against the 1.2 V bandgap, so one LSB is 3600 / 1024 mV.
+ * Everything is integer arithmetic, there is no FPU on the nRF51.
+ */
+
+#define BATTERY_LEVEL_MAX 100     /**< Battery Service levels are 0 to 100 %. */
+#define BATTERY_HYSTERESIS_RAW 2  /**< A level change must hold with the reading moved this many LSB back. */
+#define BATTERY_BURST_SIZE 8      /**< ADC conversions per measurement, reduced to their median. */
+#define BATTERY_FILTER_FRAC 4     /**< Fraction bits of the filtered reading. */
+#define BATTERY_FILTER_SHIFT 2    /**< A new measurement moves the filtered reading by 1 / 2^shift of the difference. */
+
+typedef struct {
+  uint8_t level; /**< Reported level in %. */
+  bool valid;    /**< level was set by a reading. */
+} battery_level_t;
+
+typedef struct {
+  uint16_t value; /**< Filtered reading in 1 / 2^BATTERY_FILTER_FRAC LSB. */
+  bool valid;     /**< value was set by a measurement. */
+} battery_filter_t;
+
+/**
+ * @brief Median of a burst of raw ADC readings. A conversion that hit a TX current peak
+ *        sits at the low end and does not move it, unlike the mean.
+ *
+ * @param[in,out] p_samples Raw readings, sorted on return.
+ * @param[in]     count     Number of readings, at least 1.
+ */
+uint16_t battery_burst_median(int16_t *p_samples, uint8_t count);
+
+/**
+ * @brief Feed a measurement to the IIR filter, the first one sets it.
+ *
+ * @return Filtered reading in 1 / 2^BATTERY_FILTER_FRAC LSB.
+ */
+uint16_t battery_filter_update(battery_filter_t *p_filter, uint16_t raw);
+
+/**
+ * @brief Filtered reading rounded to a raw ADC reading.
+ */
+uint16_t battery_filtered_to_raw(uint16_t filtered);
+
+/**
+ * @brief Filtered reading to mV, keeping the fraction bits.
+ */
+uint16_t battery_filtered_to_mv(uint16_t filtered);
+
+/**
+ * @brief Convert a raw ADC reading to mV, raw * 3600 / 1024.
+ */
+uint16_t battery_raw_to_mv(uint16_t raw);
+
+/**
+ * @brief Level in % for a raw ADC reading, without hysteresis.
+ */
+uint8_t battery_level_get(uint16_t raw);
+
+/**
+ * @brief Feed a raw ADC reading. The level only follows once the change holds
+ *        BATTERY_HYSTERESIS_RAW LSB back towards the current level, so a reading
+ *        sitting on a table edge does not make it toggle.
+ *
+ * @param[in,out] p_battery Level state, zero initialised before the first reading.
+ * @param[in]     raw       Raw ADC reading.
+ *
+ * @return true if p_battery->level changed.
+ */
+bool battery_level_update(battery_level_t *p_battery, uint16_t raw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
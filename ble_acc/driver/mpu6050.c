@@ -40,10 +40,16 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
+#include "app_scheduler.h"
+#include "app_util.h"
+#include "app_util_platform.h"
 #include "mpu6050.h"
 #include "mpu_reg.h"
+#include "nrf_delay.h"
 #include "nrf_drv_twi.h"
+#include "nrf_gpio.h"
 
 typedef __uint8_t uint8_t;
 typedef __uint16_t uint16_t;
@@ -57,6 +63,107 @@ static const uint8_t expected_who_am_i = 0x68U; // !< Expected value to get from
 static uint8_t m_device_address;                // !< Device address in bits [7:1]
 static nrf_drv_twi_t *m_p_twi;
 
+#define MPU6050_RESULT_PENDING 0xFFFFFFFF // !< Result of a synchronous transaction still on the bus.
+
+// One register access. Reads are a register address write followed by a repeated start read.
+typedef struct {
+  uint8_t tx[1 + MPU6050_BURST_WRITE_MAX];
+  uint8_t tx_len;
+  uint8_t *p_rx;
+  uint8_t rx_len;
+  mpu6050_evt_handler_t handler;
+  mpu6050_evt_handler_t irq_handler; // driver internal, called from the TWI interrupt instead of app_scheduler
+  void *p_context;
+  volatile uint32_t *p_result; // set by synchronous callers which spin on it instead of using handler
+} mpu6050_txn_t;
+
+static mpu6050_txn_t m_txn_queue[MPU6050_TXN_QUEUE_SIZE];
+static uint8_t m_txn_head;  // transaction currently on the bus
+static uint8_t m_txn_count; // queued transactions, including the one on the bus
+static bool m_txn_active;   // head transaction is on the bus
+
+// Completions app_scheduler had no room for, posted again by mpu6050_sched_flush(). No
+// transaction is queued while there are any, and a caller has at most one transaction queued
+// per completion, so the transaction queue size bounds them.
+static mpu6050_sched_evt_t m_sched_backlog[MPU6050_TXN_QUEUE_SIZE];
+static uint8_t m_sched_backlog_head;
+static uint8_t m_sched_backlog_count;
+
+static bool m_fifo_enabled; // samples are collected in the MPU6050 FIFO
+static bool m_awake;        // not in sleep mode
+static uint8_t m_channels = MPU6050_CHANNEL_ACCEL;
+
+// Write-through shadow of the configuration registers. A write of the value already in the
+// register is skipped, and read-modify-write needs no bus read. Bits which trigger an action
+// and clear themselves are never shadowed, a write setting one always goes to the bus.
+static const struct {
+  uint8_t reg;
+  uint8_t strobe_mask;
+} shadow_regs[] = {
+    {SMPLRT_DIV, 0}, {CONFIG, 0}, {GYRO_CONFIG, 0}, {ACCEL_CONFIG, 0}, {MOT_THR, 0},
+    {MOT_DUR, 0}, {FIFO_EN, 0}, {INT_PIN_CFG, 0}, {INT_ENABLE, 0}, {MOT_DETECT_CTRL, 0},
+    {USER_CTRL, USER_FIFO_RESET | USER_I2C_MST_RESET | USER_SIG_COND_RESET},
+    {PWR_MGMT_1, DEVICE_RESET},
+    {PWR_MGMT_2, 0},
+};
+
+#define SHADOW_COUNT (sizeof(shadow_regs) / sizeof(shadow_regs[0]))
+
+static uint8_t m_shadow[SHADOW_COUNT];
+static uint16_t m_shadow_valid; // bit per shadow_regs entry
+static mpu6050_bus_stats_t m_bus_stats;
+
+// Read-modify-write of a register the shadow does not know yet, waiting for its bus read.
+typedef struct {
+  bool busy;
+  uint8_t reg;
+  uint8_t mask;
+  uint8_t value;
+  uint8_t current; // read destination
+  mpu6050_evt_handler_t handler;
+  void *p_context;
+} rmw_t;
+
+#define RMW_COUNT 2
+
+static rmw_t m_rmw[RMW_COUNT];
+
+STATIC_ASSERT(SHADOW_COUNT <= 16);
+
+// Power-on profile, see mpu6050_init(). Checked at build time below.
+#define INIT_SAMPLE_PERIOD_MS 20 // 50 Hz
+#define INIT_DLPF DLPF_21HZ
+#define INIT_ACCEL_FS ACCEL_FS_2g
+#define INIT_GYRO_FS GYRO_FS_250
+// MPU-6000 and MPU-6050 Register Map and Descriptions Revision 4.2
+// The MPU-60X0 can be put into Accelerometer Only Low Power Mode using the following steps:
+// (i)   Set CYCLE bit to 1
+// (ii)  Set SLEEP bit to 0
+// (iii) Set TEMP_DIS bit to 1
+// (iv)  Set STBY_XG, STBY_YG, STBY_ZG bits to 1
+#define INIT_PWR_MGMT_1 (CLKSEL_PllGyroX | TEMP_DIS | CYCLE)
+#define INIT_PWR_MGMT_2 (gyroscope_STBY | LP_WAKE_CTRL_5)
+
+// Consecutive registers written in one transaction
+typedef struct {
+  uint8_t first_register;
+  uint8_t count;
+  uint8_t values[MPU6050_BURST_WRITE_MAX];
+} config_block_t;
+
+static const config_block_t init_profile[] = {
+    {SMPLRT_DIV, 4, {INIT_SAMPLE_PERIOD_MS - 1, INIT_DLPF, INIT_GYRO_FS, INIT_ACCEL_FS}},
+    {PWR_MGMT_1, 2, {INIT_PWR_MGMT_1, INIT_PWR_MGMT_2}},
+};
+
+STATIC_ASSERT(CONFIG == SMPLRT_DIV + 1 && GYRO_CONFIG == SMPLRT_DIV + 2 && ACCEL_CONFIG == SMPLRT_DIV + 3);
+STATIC_ASSERT(PWR_MGMT_2 == PWR_MGMT_1 + 1);
+STATIC_ASSERT(INIT_SAMPLE_PERIOD_MS >= 1 && INIT_SAMPLE_PERIOD_MS <= MPU6050_MAX_SAMPLE_PERIOD);
+STATIC_ASSERT(MPU6050_DLPF_BANDWIDTH(INIT_DLPF) > 0);                                        // not the reserved setting
+STATIC_ASSERT(MPU6050_DLPF_BANDWIDTH(INIT_DLPF) * 2 <= 1000 / INIT_SAMPLE_PERIOD_MS);        // below Nyquist
+STATIC_ASSERT((INIT_ACCEL_FS & ~ACCEL_FS_MASK) == 0 && (INIT_GYRO_FS & ~GYRO_FS_MASK) == 0); // only the FS_SEL bits
+STATIC_ASSERT((INIT_PWR_MGMT_1 & SLEEP) == 0);                                               // SLEEP would override CYCLE
+
 uint32_t check_retcode(uint32_t ret_code) {
   if (ret_code != NRF_SUCCESS) {
     // for (;;) {}
@@ -69,6 +176,9 @@ bool mpu6050_init(nrf_drv_twi_t *p_twi, uint8_t device_address) {
 
   m_p_twi          = p_twi;
   m_device_address = device_address;
+  // Init may run again after a failed attempt, the registers are unknown until written.
+  m_shadow_valid = 0;
+  m_fifo_enabled = false;
 
   // Do a reset on signal paths
   uint8_t reset_value = 0x04U | 0x02U | 0x01U; // Resets gyro, accelerometer and temperature sensor signal paths.
@@ -78,20 +188,14 @@ bool mpu6050_init(nrf_drv_twi_t *p_twi, uint8_t device_address) {
     return false;
   }
   // initialize MPU6050
-  ret_code = check_retcode(mpu6050_register_write(SMPLRT_DIV, SAMPLE_50HZ));
-  ret_code = check_retcode(mpu6050_register_write(CONFIG, DLPF_21HZ));
-  ret_code = check_retcode(mpu6050_register_write(ACCEL_CONFIG, ACCEL_FS_2g));
-  // MPU-6000 and MPU-6050 Register Map and Descriptions Revision 4.2 
-  // The MPU-60X0 can be put into Accelerometer Only Low Power Mode using the following steps:
-  // (i)   Set CYCLE bit to 1
-  // (ii)  Set SLEEP bit to 0
-  // (iii) Set TEMP_DIS bit to 1
-  // (iv)  Set STBY_XG, STBY_YG, STBY_ZG bits to 1
-  ret_code = check_retcode(mpu6050_register_write(PWR_MGMT_1, CLKSEL_PllGyroX | TEMP_DIS | CYCLE));
-  ret_code = check_retcode(mpu6050_register_write(PWR_MGMT_2, gyroscope_STBY | LP_WAKE_CTRL_5));
-  if (ret_code != NRF_SUCCESS) {
-    return false;
+  for (unsigned i = 0; i < sizeof(init_profile) / sizeof(init_profile[0]); i++) {
+    ret_code = mpu6050_register_burst_write(init_profile[i].first_register, init_profile[i].values, init_profile[i].count);
+    if (ret_code != NRF_SUCCESS) {
+      return false;
+    }
   }
+  m_awake    = true;
+  m_channels = MPU6050_CHANNEL_ACCEL;
   // Read and verify product ID
   return mpu6050_verify_product_id();
 }
@@ -110,36 +214,637 @@ bool mpu6050_verify_product_id(void) {
   }
 }
 
-uint32_t mpu6050_register_write(uint8_t register_address, uint8_t value) {
-  uint8_t w2_data[2];
+static void txn_sched_handler(void *p_event_data, uint16_t event_size) {
+  mpu6050_sched_evt_t *p_evt = (mpu6050_sched_evt_t *)p_event_data;
+  p_evt->handler(p_evt->result, p_evt->p_context);
+}
 
-  w2_data[0] = register_address;
-  w2_data[1] = value;
-  return nrf_drv_twi_tx(m_p_twi, m_device_address, w2_data, 2, false);
+// Post the backlog, oldest first. Must be called inside a critical region.
+static bool sched_backlog_flush(void) {
+  while (m_sched_backlog_count > 0) {
+    if (app_sched_event_put(&m_sched_backlog[m_sched_backlog_head], sizeof(mpu6050_sched_evt_t), txn_sched_handler) !=
+        NRF_SUCCESS) {
+      return false;
+    }
+    m_sched_backlog_head = (m_sched_backlog_head + 1) % MPU6050_TXN_QUEUE_SIZE;
+    m_sched_backlog_count--;
+  }
+  return true;
 }
 
-uint32_t mpu6050_register_read(uint8_t register_address, uint8_t *destination, uint8_t number_of_bytes) {
-  uint32_t ret_code = 0;
-  ret_code          = nrf_drv_twi_tx(m_p_twi, m_device_address, &register_address, 1, false);
+static void txn_sched_post(mpu6050_evt_handler_t handler, void *p_context, uint32_t result) {
+  mpu6050_sched_evt_t evt = {
+      .handler   = handler,
+      .p_context = p_context,
+      .result    = result,
+  };
+
+  CRITICAL_REGION_ENTER();
+  // a lost completion would leave its caller waiting for good
+  if ((!sched_backlog_flush() || app_sched_event_put(&evt, sizeof(evt), txn_sched_handler) != NRF_SUCCESS) &&
+      m_sched_backlog_count < MPU6050_TXN_QUEUE_SIZE) {
+    m_sched_backlog[(m_sched_backlog_head + m_sched_backlog_count) % MPU6050_TXN_QUEUE_SIZE] = evt;
+    m_sched_backlog_count++;
+  }
+  CRITICAL_REGION_EXIT();
+}
+
+bool mpu6050_sched_flush(void) {
+  bool posted;
+
+  CRITICAL_REGION_ENTER();
+  uint8_t count = m_sched_backlog_count;
+  sched_backlog_flush();
+  posted = m_sched_backlog_count != count;
+  CRITICAL_REGION_EXIT();
+  return posted;
+}
+
+static uint32_t txn_start(mpu6050_txn_t *p_txn) {
+  if (p_txn->rx_len) {
+    nrf_drv_twi_xfer_desc_t xfer = NRF_DRV_TWI_XFER_DESC_TXRX(m_device_address, p_txn->tx, p_txn->tx_len,
+                                                              p_txn->p_rx, p_txn->rx_len);
+    return nrf_drv_twi_xfer(m_p_twi, &xfer, 0);
+  }
+  nrf_drv_twi_xfer_desc_t xfer = NRF_DRV_TWI_XFER_DESC_TX(m_device_address, p_txn->tx, p_txn->tx_len);
+  return nrf_drv_twi_xfer(m_p_twi, &xfer, 0);
+}
+
+static int shadow_index(uint8_t reg) {
+  for (unsigned i = 0; i < SHADOW_COUNT; i++) {
+    if (shadow_regs[i].reg == reg) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+// True if a queued write, the one on the bus included, covers the register.
+static bool txn_queued_writes(uint8_t reg) {
+  for (uint8_t k = 0; k < m_txn_count; k++) {
+    mpu6050_txn_t const *p_txn = &m_txn_queue[(m_txn_head + k) % MPU6050_TXN_QUEUE_SIZE];
+    if (p_txn->rx_len == 0 && reg >= p_txn->tx[0] && reg < p_txn->tx[0] + p_txn->tx_len - 1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// True if every register of the write already holds its value. A register with a write still
+// queued only holds it once that write succeeds, so it does not match.
+static bool shadow_matches(mpu6050_txn_t const *p_txn) {
+  if (p_txn->rx_len != 0) {
+    return false;
+  }
+  for (uint8_t n = 1; n < p_txn->tx_len; n++) {
+    uint8_t reg = p_txn->tx[0] + n - 1;
+    int i       = shadow_index(reg);
+    if (i < 0 || !(m_shadow_valid & (1 << i)) || (p_txn->tx[n] & shadow_regs[i].strobe_mask) ||
+        m_shadow[i] != p_txn->tx[n] || txn_queued_writes(reg)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Update (valid) or forget (!valid) the registers a write covers. A register a later queued
+// write covers is not forgotten, the shadow already holds that write's value.
+static void shadow_store(mpu6050_txn_t const *p_txn, bool valid) {
+  if (p_txn->rx_len != 0) {
+    return;
+  }
+  for (uint8_t n = 1; n < p_txn->tx_len; n++) {
+    uint8_t reg = p_txn->tx[0] + n - 1;
+    if (reg == PWR_MGMT_1 && (p_txn->tx[n] & DEVICE_RESET)) {
+      m_shadow_valid = 0; // every register is back at its reset value
+      continue;
+    }
+    int i = shadow_index(reg);
+    if (i < 0) {
+      continue;
+    }
+    if (valid) {
+      m_shadow[i] = p_txn->tx[n] & ~shadow_regs[i].strobe_mask;
+      m_shadow_valid |= 1 << i;
+    } else if (!txn_queued_writes(reg)) {
+      m_shadow_valid &= ~(1 << i);
+    }
+  }
+}
+
+static void txn_report(mpu6050_txn_t const *p_txn, uint32_t result) {
+  if (p_txn->p_result != NULL) {
+    *p_txn->p_result = result;
+  } else if (p_txn->irq_handler != NULL) {
+    p_txn->irq_handler(result, p_txn->p_context);
+  } else if (p_txn->handler != NULL) {
+    txn_sched_post(p_txn->handler, p_txn->p_context, result);
+  }
+}
+
+// Pop the head transaction and report its result. Must be called inside a critical region.
+static void txn_finish(uint32_t result) {
+  mpu6050_txn_t txn = m_txn_queue[m_txn_head];
+
+  // pop first, irq_handler may queue follow-up transactions
+  m_txn_head = (m_txn_head + 1) % MPU6050_TXN_QUEUE_SIZE;
+  m_txn_count--;
+
+  if (result != NRF_SUCCESS) {
+    // the register may or may not have been written
+    shadow_store(&txn, false);
+    m_bus_stats.errors++;
+  }
+  txn_report(&txn, result);
+}
+
+// Put the head transaction on the bus if it is idle. Must be called inside a critical region.
+static void txn_kick(void) {
+  while (!m_txn_active && m_txn_count > 0) {
+    mpu6050_txn_t *p_txn = &m_txn_queue[m_txn_head];
+    uint32_t ret_code    = txn_start(p_txn);
+    if (ret_code == NRF_SUCCESS) {
+      m_txn_active = true;
+      m_bus_stats.transactions++;
+      m_bus_stats.bytes += p_txn->tx_len + p_txn->rx_len;
+      if (!m_awake && p_txn->rx_len > 0) {
+        m_bus_stats.asleep_reads++;
+      }
+      return;
+    }
+    txn_finish(ret_code);
+  }
+}
+
+static uint32_t txn_enqueue(mpu6050_txn_t const *p_txn) {
+  uint32_t ret_code = NRF_SUCCESS;
+  bool elided       = false;
+
+  CRITICAL_REGION_ENTER();
+  if (m_sched_backlog_count > 0) {
+    ret_code = NRF_ERROR_NO_MEM; // the completion might not fit either
+  } else if (shadow_matches(p_txn)) {
+    elided = true;
+    m_bus_stats.elided++;
+  } else if (m_txn_count == MPU6050_TXN_QUEUE_SIZE) {
+    ret_code = NRF_ERROR_NO_MEM;
+  } else {
+    // write-through, a failed write forgets the value again in txn_finish()
+    shadow_store(p_txn, true);
+    m_txn_queue[(m_txn_head + m_txn_count) % MPU6050_TXN_QUEUE_SIZE] = *p_txn;
+    m_txn_count++;
+    txn_kick();
+  }
+  CRITICAL_REGION_EXIT();
 
+  if (elided) {
+    txn_report(p_txn, NRF_SUCCESS);
+  }
+  return ret_code;
+}
+
+// Queue the transaction and spin until it is done.
+// Must not be called from an interrupt at or above the TWI interrupt priority.
+static uint32_t txn_run(mpu6050_txn_t *p_txn) {
+  volatile uint32_t result = MPU6050_RESULT_PENDING;
+
+  p_txn->p_result = &result;
+  uint32_t ret_code = txn_enqueue(p_txn);
   if (ret_code != NRF_SUCCESS) {
     return ret_code;
   }
-  ret_code = nrf_drv_twi_rx(m_p_twi, m_device_address, destination, number_of_bytes);
+  while (result == MPU6050_RESULT_PENDING) {
+  }
+  return result;
+}
+
+static void txn_write_init(mpu6050_txn_t *p_txn, uint8_t register_address, uint8_t value) {
+  memset(p_txn, 0, sizeof(*p_txn));
+  p_txn->tx[0]  = register_address;
+  p_txn->tx[1]  = value;
+  p_txn->tx_len = 2;
+}
+
+static void txn_read_init(mpu6050_txn_t *p_txn, uint8_t register_address, uint8_t *destination, uint8_t number_of_bytes) {
+  memset(p_txn, 0, sizeof(*p_txn));
+  p_txn->tx[0]  = register_address;
+  p_txn->tx_len = 1;
+  p_txn->p_rx   = destination;
+  p_txn->rx_len = number_of_bytes;
+}
+
+void mpu6050_twi_evt_handler(nrf_drv_twi_evt_t const *p_event, void *p_context) {
+  uint32_t result;
+
+  switch (p_event->type) {
+  case NRF_DRV_TWI_EVT_DONE:
+    result = NRF_SUCCESS;
+    break;
+  case NRF_DRV_TWI_EVT_ADDRESS_NACK:
+    result = NRF_ERROR_DRV_TWI_ERR_ANACK;
+    break;
+  default:
+    result = NRF_ERROR_DRV_TWI_ERR_DNACK;
+    break;
+  }
+
+  CRITICAL_REGION_ENTER();
+  if (m_txn_active) {
+    m_txn_active = false;
+    txn_finish(result);
+    txn_kick();
+  }
+  CRITICAL_REGION_EXIT();
+}
+
+uint32_t mpu6050_register_write(uint8_t register_address, uint8_t value) {
+  mpu6050_txn_t txn;
+
+  txn_write_init(&txn, register_address, value);
+  return txn_run(&txn);
+}
+
+uint32_t mpu6050_register_burst_write(uint8_t register_address, uint8_t const *p_values, uint8_t count) {
+  mpu6050_txn_t txn;
+
+  if (count < 1 || count > MPU6050_BURST_WRITE_MAX) {
+    return NRF_ERROR_INVALID_LENGTH;
+  }
+  txn_write_init(&txn, register_address, p_values[0]);
+  memcpy(txn.tx + 1, p_values, count);
+  txn.tx_len = 1 + count;
+  return txn_run(&txn);
+}
+
+// The register read of a read-modify-write is done. Runs in the TWI interrupt.
+static void rmw_read_handler(uint32_t result, void *p_context) {
+  rmw_t *p_rmw = (rmw_t *)p_context;
+
+  if (result == NRF_SUCCESS) {
+    int i = shadow_index(p_rmw->reg);
+    // a write queued after the read is newer than what was read
+    if (!(m_shadow_valid & (1 << i))) {
+      m_shadow[i] = p_rmw->current & ~shadow_regs[i].strobe_mask;
+      m_shadow_valid |= 1 << i;
+    }
+    result = mpu6050_register_write_async(p_rmw->reg, (m_shadow[i] & ~p_rmw->mask) | (p_rmw->value & p_rmw->mask),
+                                          p_rmw->handler, p_rmw->p_context);
+  }
+  if (result != NRF_SUCCESS && p_rmw->handler != NULL) {
+    txn_sched_post(p_rmw->handler, p_rmw->p_context, result);
+  }
+  p_rmw->busy = false;
+}
+
+// Read the register first, rmw_read_handler() queues the write.
+static uint32_t rmw_start(uint8_t register_address, uint8_t mask, uint8_t value,
+                          mpu6050_evt_handler_t handler, void *p_context) {
+  rmw_t *p_rmw = NULL;
+  mpu6050_txn_t txn;
+
+  CRITICAL_REGION_ENTER();
+  for (int k = 0; k < RMW_COUNT; k++) {
+    if (!m_rmw[k].busy) {
+      p_rmw       = &m_rmw[k];
+      p_rmw->busy = true;
+      break;
+    }
+  }
+  CRITICAL_REGION_EXIT();
+  if (p_rmw == NULL) {
+    return NRF_ERROR_NO_MEM;
+  }
+  p_rmw->reg       = register_address;
+  p_rmw->mask      = mask;
+  p_rmw->value     = value;
+  p_rmw->handler   = handler;
+  p_rmw->p_context = p_context;
+
+  txn_read_init(&txn, register_address, &p_rmw->current, 1);
+  txn.irq_handler   = rmw_read_handler;
+  txn.p_context     = p_rmw;
+  uint32_t ret_code = txn_enqueue(&txn);
+  if (ret_code != NRF_SUCCESS) {
+    p_rmw->busy = false;
+  }
   return ret_code;
 }
 
+uint32_t mpu6050_register_update_async(uint8_t register_address, uint8_t mask, uint8_t value,
+                                       mpu6050_evt_handler_t handler, void *p_context) {
+  uint8_t current;
+  bool known;
+
+  int i = shadow_index(register_address);
+  if (i < 0) {
+    return NRF_ERROR_INVALID_PARAM;
+  }
+  CRITICAL_REGION_ENTER();
+  known   = (m_shadow_valid & (1 << i)) != 0;
+  current = m_shadow[i];
+  CRITICAL_REGION_EXIT();
+  if (!known) {
+    return rmw_start(register_address, mask, value, handler, p_context);
+  }
+  return mpu6050_register_write_async(register_address, (current & ~mask) | (value & mask), handler, p_context);
+}
+
+void mpu6050_bus_stats_get(mpu6050_bus_stats_t *p_stats) {
+  CRITICAL_REGION_ENTER();
+  *p_stats = m_bus_stats;
+  CRITICAL_REGION_EXIT();
+}
+
+uint32_t mpu6050_register_read(uint8_t register_address, uint8_t *destination, uint8_t number_of_bytes) {
+  mpu6050_txn_t txn;
+
+  txn_read_init(&txn, register_address, destination, number_of_bytes);
+  return txn_run(&txn);
+}
+
+uint32_t mpu6050_register_write_async(uint8_t register_address, uint8_t value,
+                                      mpu6050_evt_handler_t handler, void *p_context) {
+  mpu6050_txn_t txn;
+
+  txn_write_init(&txn, register_address, value);
+  txn.handler   = handler;
+  txn.p_context = p_context;
+  return txn_enqueue(&txn);
+}
+
+uint32_t mpu6050_register_read_async(uint8_t register_address, uint8_t *destination, uint8_t number_of_bytes,
+                                     mpu6050_evt_handler_t handler, void *p_context) {
+  mpu6050_txn_t txn;
+
+  txn_read_init(&txn, register_address, destination, number_of_bytes);
+  txn.handler   = handler;
+  txn.p_context = p_context;
+  return txn_enqueue(&txn);
+}
+
 uint32_t mpu6050_read_acceleration(uint8_t *dest) {
   return mpu6050_register_read(ACCEL_XOUT_H, dest, 6);
 }
 
+uint32_t mpu6050_read_acceleration_async(uint8_t *dest, mpu6050_evt_handler_t handler, void *p_context) {
+  return mpu6050_register_read_async(ACCEL_XOUT_H, dest, 6, handler, p_context);
+}
+
+uint32_t mpu6050_read_motion_async(uint8_t *dest, mpu6050_evt_handler_t handler, void *p_context) {
+  return mpu6050_register_read_async(ACCEL_XOUT_H, dest, MPU6050_MOTION_SIZE, handler, p_context);
+}
+
+static void fifo_read_done(mpu6050_fifo_read_t *p_read, uint32_t result) {
+  if (result != NRF_SUCCESS) {
+    p_read->count = 0;
+  }
+  txn_sched_post(p_read->handler, p_read->p_context, result);
+}
+
+static void fifo_data_handler(uint32_t result, void *p_context) {
+  fifo_read_done((mpu6050_fifo_read_t *)p_context, result);
+}
+
+// FIFO_COUNT arrived, queue the burst read (or a resync) right behind it. Runs in the TWI interrupt.
+static void fifo_count_handler(uint32_t result, void *p_context) {
+  mpu6050_fifo_read_t *p_read = (mpu6050_fifo_read_t *)p_context;
+  mpu6050_txn_t txn;
+
+  if (result != NRF_SUCCESS) {
+    fifo_read_done(p_read, result);
+    return;
+  }
+
+  uint16_t bytes = uint16_big_decode(p_read->count_raw);
+  if (bytes >= MPU6050_FIFO_SIZE || (bytes % MPU6050_SAMPLE_SIZE) != 0) {
+    // The FIFO overwrote its oldest bytes, so sample frames are no longer aligned. Drop everything.
+    p_read->overflow = true;
+    p_read->count    = 0;
+    txn_write_init(&txn, USER_CTRL, USER_FIFO_EN | USER_FIFO_RESET);
+  } else {
+    p_read->count = MIN(bytes / MPU6050_SAMPLE_SIZE, p_read->max_samples);
+    if (p_read->count == 0) {
+      fifo_read_done(p_read, NRF_SUCCESS);
+      return;
+    }
+    txn_read_init(&txn, FIFO_R_W, p_read->p_data, p_read->count * MPU6050_SAMPLE_SIZE);
+  }
+
+  txn.irq_handler = fifo_data_handler;
+  txn.p_context   = p_read;
+  result          = txn_enqueue(&txn);
+  if (result != NRF_SUCCESS) {
+    fifo_read_done(p_read, result);
+  }
+}
+
+// PWR_MGMT_1 while awake. Cycle mode is accelerometer only, the gyro and the temperature sensor
+// need continuous mode, and so does the FIFO which is filled at the SMPLRT_DIV rate.
+static uint8_t pwr_mgmt_1_awake(void) {
+  uint8_t value = (m_channels & MPU6050_CHANNEL_TEMP) ? 0 : TEMP_DIS;
+
+  if (m_channels & MPU6050_CHANNEL_GYRO) {
+    return value | CLKSEL_PllGyroX; // the gyro PLL is the more accurate clock
+  }
+  if (m_fifo_enabled || (m_channels & MPU6050_CHANNEL_TEMP)) {
+    return value | CLKSEL_INTER8M;
+  }
+  return value | CLKSEL_PllGyroX | CYCLE;
+}
+
+uint32_t mpu6050_fifo_enable(bool enable) {
+  uint32_t ret_code;
+
+  m_fifo_enabled = enable;
+  if (!enable) {
+    ret_code = mpu6050_register_write_async(USER_CTRL, 0, NULL, NULL);
+    if (ret_code != NRF_SUCCESS) {
+      return ret_code;
+    }
+    ret_code = mpu6050_register_write_async(FIFO_EN, 0, NULL, NULL);
+    if (ret_code != NRF_SUCCESS || !m_awake) {
+      return ret_code;
+    }
+    // back to cycle mode unless a channel needs continuous mode
+    return mpu6050_register_write_async(PWR_MGMT_1, pwr_mgmt_1_awake(), NULL, NULL);
+  }
+
+  if (m_awake) {
+    ret_code = mpu6050_register_write_async(PWR_MGMT_1, pwr_mgmt_1_awake(), NULL, NULL);
+    if (ret_code != NRF_SUCCESS) {
+      return ret_code;
+    }
+  }
+  ret_code = mpu6050_register_write_async(FIFO_EN, ACCEL_FIFO_EN, NULL, NULL);
+  if (ret_code != NRF_SUCCESS) {
+    return ret_code;
+  }
+  return mpu6050_register_write_async(USER_CTRL, USER_FIFO_EN | USER_FIFO_RESET, NULL, NULL);
+}
+
+uint32_t mpu6050_fifo_read_async(mpu6050_fifo_read_t *p_read, mpu6050_evt_handler_t handler, void *p_context) {
+  mpu6050_txn_t txn;
+
+  if (p_read->max_samples > MPU6050_FIFO_MAX_BURST) {
+    return NRF_ERROR_INVALID_PARAM;
+  }
+
+  p_read->handler   = handler;
+  p_read->p_context = p_context;
+  p_read->count     = 0;
+  p_read->overflow  = false;
+
+  txn_read_init(&txn, FIFO_COUNTH, p_read->count_raw, sizeof(p_read->count_raw));
+  txn.irq_handler = fifo_count_handler;
+  txn.p_context   = p_read;
+  return txn_enqueue(&txn);
+}
+
+uint32_t mpu6050_int_enable(uint8_t int_mask) {
+  // INT pin is active high, push-pull, and held until INT_STATUS is read.
+  uint32_t ret_code = mpu6050_register_write_async(INT_PIN_CFG, LATCH_INT_EN, NULL, NULL);
+  if (ret_code != NRF_SUCCESS) {
+    return ret_code;
+  }
+  return mpu6050_register_write_async(INT_ENABLE, int_mask, NULL, NULL);
+}
+
+uint32_t mpu6050_int_status_read_async(uint8_t *p_status, mpu6050_evt_handler_t handler, void *p_context) {
+  return mpu6050_register_read_async(INT_STATUS, p_status, 1, handler, p_context);
+}
+
+bool mpu6050_int_pin_check(uint32_t pin) {
+  uint8_t status;
+  bool low;
+  bool high;
+
+  // No interrupt pending: the pin must sit low against a pull-up...
+  if (mpu6050_register_write(INT_ENABLE, 0) != NRF_SUCCESS ||
+      mpu6050_register_write(INT_PIN_CFG, LATCH_INT_EN) != NRF_SUCCESS ||
+      mpu6050_register_read(INT_STATUS, &status, 1) != NRF_SUCCESS) {
+    return false;
+  }
+  nrf_gpio_cfg_input(pin, NRF_GPIO_PIN_PULLUP);
+  nrf_delay_us(10);
+  low = nrf_gpio_pin_read(pin) == 0;
+
+  // ...and high against a pull-down once it is active low.
+  nrf_gpio_cfg_input(pin, NRF_GPIO_PIN_PULLDOWN);
+  if (mpu6050_register_write(INT_PIN_CFG, LATCH_INT_EN | INT_LEVEL_LOW) != NRF_SUCCESS) {
+    return false;
+  }
+  nrf_delay_us(10);
+  high = nrf_gpio_pin_read(pin) != 0;
+
+  nrf_gpio_cfg_default(pin);
+  if (mpu6050_register_write(INT_PIN_CFG, LATCH_INT_EN) != NRF_SUCCESS) {
+    return false;
+  }
+  return low && high;
+}
+
+uint32_t mpu6050_motion_detect_config(uint8_t threshold, uint8_t duration) {
+  uint32_t ret_code;
+
+  // Motion is detected on the high pass filtered acceleration, so gravity alone does not trigger it.
+  ret_code = mpu6050_register_write_async(ACCEL_CONFIG, ACCEL_FS_2g | ACCEL_HPF_0_63HZ, NULL, NULL);
+  if (ret_code != NRF_SUCCESS) {
+    return ret_code;
+  }
+  ret_code = mpu6050_register_write_async(MOT_THR, threshold, NULL, NULL);
+  if (ret_code != NRF_SUCCESS) {
+    return ret_code;
+  }
+  ret_code = mpu6050_register_write_async(MOT_DUR, duration, NULL, NULL);
+  if (ret_code != NRF_SUCCESS) {
+    return ret_code;
+  }
+  return mpu6050_register_write_async(MOT_DETECT_CTRL, ACCEL_ON_DELAY_3MS, NULL, NULL);
+}
+
+uint32_t mpu6050_set_sample_rate_div(uint8_t div) {
+  return mpu6050_register_write_async(SMPLRT_DIV, div, NULL, NULL);
+}
+
+// DLPF settings, widest first. The DLPF also sets the 1 kHz base rate SMPLRT_DIV divides.
+static const uint8_t dlpf_table[] = {DLPF_184HZ, DLPF_94HZ, DLPF_44HZ, DLPF_21HZ, DLPF_10HZ, DLPF_5HZ};
+
+uint32_t mpu6050_set_sample_period(uint16_t period_ms) {
+  uint32_t ret_code;
+
+  if (period_ms < 1 || period_ms > MPU6050_MAX_SAMPLE_PERIOD) {
+    return NRF_ERROR_INVALID_PARAM;
+  }
+
+  // Widest bandwidth below Nyquist, or the narrowest one there is.
+  uint16_t rate_hz = 1000 / period_ms;
+  uint8_t dlpf     = DLPF_5HZ;
+  for (unsigned i = 0; i < sizeof(dlpf_table) / sizeof(dlpf_table[0]); i++) {
+    if (MPU6050_DLPF_BANDWIDTH(dlpf_table[i]) * 2 <= rate_hz) {
+      dlpf = dlpf_table[i];
+      break;
+    }
+  }
+
+  // Slowest cycle mode wake-up which still keeps up with the rate.
+  MPU6050_WAKEUP_FREQ wake;
+  if (rate_hz <= 1) {
+    wake = MPU6050_WAKEUP_1_25;
+  } else if (rate_hz <= 5) {
+    wake = MPU6050_WAKEUP_5;
+  } else if (rate_hz <= 20) {
+    wake = MPU6050_WAKEUP_20;
+  } else {
+    wake = MPU6050_WAKEUP_40;
+  }
+
+  ret_code = mpu6050_register_write_async(SMPLRT_DIV, (uint8_t)(period_ms - 1), NULL, NULL);
+  if (ret_code != NRF_SUCCESS) {
+    return ret_code;
+  }
+  ret_code = mpu6050_register_write_async(CONFIG, dlpf, NULL, NULL);
+  if (ret_code != NRF_SUCCESS) {
+    return ret_code;
+  }
+  return mpu6050_set_wake_up_freq(wake);
+}
+
 uint32_t mpu6050_enter_sleep() {
-  return mpu6050_register_write(PWR_MGMT_1, SLEEP);
+  m_awake = false;
+  return mpu6050_register_write_async(PWR_MGMT_1, SLEEP, NULL, NULL);
 }
 uint32_t mpu6050_wake_up() {
-  return mpu6050_register_write(PWR_MGMT_1, CLKSEL_PllGyroX | TEMP_DIS | CYCLE);
+  m_awake           = true;
+  uint32_t ret_code = mpu6050_register_write_async(PWR_MGMT_1, pwr_mgmt_1_awake(), NULL, NULL);
+  if (ret_code != NRF_SUCCESS || !m_fifo_enabled) {
+    return ret_code;
+  }
+  // Samples left from before sleep are stale.
+  return mpu6050_register_write_async(USER_CTRL, USER_FIFO_EN | USER_FIFO_RESET, NULL, NULL);
+}
+
+uint32_t mpu6050_channels_set(uint8_t channels) {
+  m_channels = channels | MPU6050_CHANNEL_ACCEL;
+
+  uint32_t ret_code = mpu6050_register_update_async(PWR_MGMT_2, gyroscope_STBY,
+                                                    (m_channels & MPU6050_CHANNEL_GYRO) ? 0 : gyroscope_STBY, NULL, NULL);
+  if (ret_code != NRF_SUCCESS || !m_awake) {
+    return ret_code;
+  }
+  return mpu6050_register_write_async(PWR_MGMT_1, pwr_mgmt_1_awake(), NULL, NULL);
+}
+
+mpu6050_power_t mpu6050_power_get(void) {
+  if (!m_awake) {
+    return MPU6050_POWER_SLEEP;
+  }
+  uint8_t pwr_mgmt_1 = pwr_mgmt_1_awake();
+  if (pwr_mgmt_1 & CYCLE) {
+    return MPU6050_POWER_CYCLE;
+  }
+  return (m_channels & MPU6050_CHANNEL_GYRO) ? MPU6050_POWER_GYRO : MPU6050_POWER_ACCEL;
 }
 
 uint32_t mpu6050_set_wake_up_freq(MPU6050_WAKEUP_FREQ freq) {
-  return mpu6050_register_write(PWR_MGMT_2, gyroscope_STBY | ((uint8_t)(freq & 0x3) << 6));
+  return mpu6050_register_update_async(PWR_MGMT_2, LP_WAKE_CTRL_MASK, (uint8_t)(freq & 0x3) << 6, NULL, NULL);
 }
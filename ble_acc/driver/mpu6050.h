@@ -58,6 +58,80 @@ typedef enum {
   MPU6050_WAKEUP_40,
 } MPU6050_WAKEUP_FREQ;
 
+/**
+ * @brief Completion handler of an asynchronous transaction. Called from app_scheduler.
+ *
+ * @param[in] result    NRF_SUCCESS, or the error reported by the TWI driver.
+ * @param[in] p_context Context given when the transaction was queued.
+ */
+typedef void (*mpu6050_evt_handler_t)(uint32_t result, void *p_context);
+
+/**
+ * @brief Event passed to app_scheduler when an asynchronous transaction completes.
+ */
+typedef struct {
+  mpu6050_evt_handler_t handler;
+  void *p_context;
+  uint32_t result;
+} mpu6050_sched_evt_t;
+
+#define MPU6050_SCHED_EVENT_SIZE sizeof(mpu6050_sched_evt_t)
+#define MPU6050_TXN_QUEUE_SIZE 8 /**< Max number of queued TWI transactions, each completes with at most one scheduler event. */
+
+#define MPU6050_SAMPLE_SIZE 6    /**< Bytes per acceleration sample, {X_H, X_L, Y_H, Y_L, Z_H, Z_L}. */
+#define MPU6050_FIFO_SIZE 1024   /**< Size of the MPU6050 FIFO in bytes. */
+#define MPU6050_FIFO_MAX_BURST 42 /**< Max samples per burst read, TWI transfer length is 8 bit. */
+#define MPU6050_MAX_SAMPLE_PERIOD 256 /**< Longest sample period in ms, SMPLRT_DIV is 8 bit. */
+#define MPU6050_CYCLE_MIN_PERIOD 25   /**< Shortest sample period in ms cycle mode delivers, LP_WAKE_CTRL tops out at 40 Hz. */
+#define MPU6050_BURST_WRITE_MAX 4     /**< Max consecutive registers written in one transaction. */
+#define MPU6050_MOTION_SIZE 14        /**< {ACCEL X, Y, Z, TEMP, GYRO X, Y, Z}, big endian int16 each. */
+#define MPU6050_MOTION_TEMP_OFFSET 6  /**< Offset of TEMP_OUT_H in the motion burst. */
+#define MPU6050_MOTION_GYRO_OFFSET 8  /**< Offset of GYRO_XOUT_H in the motion burst. */
+
+/**
+ * @brief Sensor channels, powered on by mpu6050_channels_set(). The accelerometer is always on,
+ *        motion detection needs it.
+ */
+typedef enum {
+  MPU6050_CHANNEL_ACCEL = 0x01,
+  MPU6050_CHANNEL_GYRO  = 0x02,
+  MPU6050_CHANNEL_TEMP  = 0x04,
+} mpu6050_channel_t;
+
+/**
+ * @brief Power mode the driver put the sensor in, from the least to the most current.
+ */
+typedef enum {
+  MPU6050_POWER_SLEEP, /**< Sleep mode. */
+  MPU6050_POWER_CYCLE, /**< Accelerometer only low power mode, waking up at the LP_WAKE_CTRL rate. */
+  MPU6050_POWER_ACCEL, /**< Continuous, gyroscope in standby. */
+  MPU6050_POWER_GYRO,  /**< Continuous with the gyroscope running. */
+} mpu6050_power_t;
+
+/**
+ * @brief TWI bus usage since boot.
+ */
+typedef struct {
+  uint32_t transactions; /**< Transactions put on the bus. */
+  uint32_t bytes;        /**< Bytes transferred, register addresses included. */
+  uint32_t elided;       /**< Writes skipped because the register already held the value. */
+  uint32_t errors;       /**< Transactions which failed. */
+  uint32_t asleep_reads; /**< Reads put on the bus while the driver had the sensor asleep, nothing should ask. */
+} mpu6050_bus_stats_t;
+
+/**
+ * @brief State of one FIFO drain. Must stay valid until the completion handler runs.
+ */
+typedef struct {
+  uint8_t *p_data;     /**< Buffer for max_samples * MPU6050_SAMPLE_SIZE bytes. Set by caller. */
+  uint8_t max_samples; /**< Max samples to drain at once. Set by caller. */
+  uint8_t count;       /**< Samples stored in p_data, oldest first. */
+  bool overflow;       /**< FIFO overflowed and was reset, samples were lost. */
+  uint8_t count_raw[2];
+  mpu6050_evt_handler_t handler;
+  void *p_context;
+} mpu6050_fifo_read_t;
+
 /** @file
 * @brief MPU6050 gyro/accelerometer driver.
 *
@@ -78,6 +152,11 @@ typedef enum {
  */
 bool mpu6050_init(nrf_drv_twi_t *p_twi, uint8_t device_address);
 
+/**
+ * @brief TWI event handler. Pass it to nrf_drv_twi_init() for the instance given to mpu6050_init().
+ */
+void mpu6050_twi_evt_handler(nrf_drv_twi_evt_t const *p_event, void *p_context);
+
 /**
   @brief Function for writing a MPU6050 register contents over TWI.
   @param[in]  register_address Register address to start writing to
@@ -87,6 +166,16 @@ bool mpu6050_init(nrf_drv_twi_t *p_twi, uint8_t device_address);
 */
 uint32_t mpu6050_register_write(uint8_t register_address, const uint8_t value);
 
+/**
+  @brief Function for writing consecutive MPU6050 registers in one TWI transaction.
+  @param[in] register_address First register to write
+  @param[in] p_values Values, one per register
+  @param[in] count Number of registers, 1 to MPU6050_BURST_WRITE_MAX
+  @retval NRF_SUCCESS Registers written
+  @retval NRF_ERROR_INVALID_LENGTH count out of range
+*/
+uint32_t mpu6050_register_burst_write(uint8_t register_address, uint8_t const *p_values, uint8_t count);
+
 /**
   @brief Function for reading MPU6050 register contents over TWI.
   Reads one or more consecutive registers.
@@ -98,6 +187,62 @@ uint32_t mpu6050_register_write(uint8_t register_address, const uint8_t value);
 */
 uint32_t mpu6050_register_read(uint8_t register_address, uint8_t *destination, uint8_t number_of_bytes);
 
+/**
+  @brief Function for queueing a MPU6050 register write without waiting for the bus.
+  @param[in] register_address Register address to start writing to
+  @param[in] value Value to write to register
+  @param[in] handler Completion handler, may be NULL
+  @param[in] p_context Passed to handler
+  @retval NRF_SUCCESS Write queued
+  @retval NRF_ERROR_NO_MEM Transaction queue is full, or completions wait for room in app_scheduler
+*/
+uint32_t mpu6050_register_write_async(uint8_t register_address, uint8_t value,
+                                      mpu6050_evt_handler_t handler, void *p_context);
+
+/**
+  @brief Function for changing some bits of a configuration register, without reading it over the bus.
+  Uses the driver's copy of the last value written, and reads the register first if there is none.
+  A write which changes nothing is skipped.
+  @param[in] register_address Register address
+  @param[in] mask Bits to change
+  @param[in] value New value of the bits in mask
+  @param[in] handler Completion handler, may be NULL
+  @param[in] p_context Passed to handler
+  @retval NRF_SUCCESS Write queued or skipped
+  @retval NRF_ERROR_INVALID_PARAM Register is not a shadowed configuration register
+  @retval NRF_ERROR_NO_MEM Transaction queue is full, too many reads for unknown registers pending, or
+                           completions wait for room in app_scheduler
+*/
+uint32_t mpu6050_register_update_async(uint8_t register_address, uint8_t mask, uint8_t value,
+                                       mpu6050_evt_handler_t handler, void *p_context);
+
+/**
+  @brief Function for posting the completions app_scheduler had no room for. They are kept in
+  order and no transaction is queued until they are posted. Call from the main loop after
+  app_sched_execute().
+  @retval true Completions were posted, app_sched_execute() has work
+*/
+bool mpu6050_sched_flush(void);
+
+/**
+  @brief Function for reading the TWI bus counters.
+*/
+void mpu6050_bus_stats_get(mpu6050_bus_stats_t *p_stats);
+
+/**
+  @brief Function for queueing a MPU6050 register read without waiting for the bus.
+  destination must stay valid until handler is called.
+  @param[in]  register_address Register address to start reading from
+  @param[in]  number_of_bytes Number of bytes to read
+  @param[out] destination Pointer to a data buffer where read data will be stored
+  @param[in]  handler Completion handler, may be NULL
+  @param[in]  p_context Passed to handler
+  @retval NRF_SUCCESS Read queued
+  @retval NRF_ERROR_NO_MEM Transaction queue is full, or completions wait for room in app_scheduler
+*/
+uint32_t mpu6050_register_read_async(uint8_t register_address, uint8_t *destination, uint8_t number_of_bytes,
+                                     mpu6050_evt_handler_t handler, void *p_context);
+
 /**
   @brief Function for reading and verifying MPU6050 product ID.
   @retval true Product ID is what was expected
@@ -107,10 +252,99 @@ bool mpu6050_verify_product_id(void);
 
 uint32_t mpu6050_read_acceleration(uint8_t *dest);
 
+uint32_t mpu6050_read_acceleration_async(uint8_t *dest, mpu6050_evt_handler_t handler, void *p_context);
+
+/**
+  @brief Function for reading acceleration, temperature and rotation rate in one 14 byte burst from ACCEL_XOUT_H.
+  Channels which are powered off read their last value.
+  @param[out] dest Buffer for MPU6050_MOTION_SIZE bytes, valid until handler is called
+  @param[in] handler Completion handler
+  @param[in] p_context Passed to handler
+*/
+uint32_t mpu6050_read_motion_async(uint8_t *dest, mpu6050_evt_handler_t handler, void *p_context);
+
+/**
+  @brief Function for powering the gyroscope and temperature sensor on or off.
+  Without them the sensor runs in accelerometer only low power (cycle) mode. Takes effect at
+  mpu6050_wake_up() while the sensor sleeps.
+  @param[in] channels Bitwise OR of mpu6050_channel_t
+*/
+uint32_t mpu6050_channels_set(uint8_t channels);
+
+/**
+  @brief Function for reading the power mode written last, see mpu6050_power_t.
+*/
+mpu6050_power_t mpu6050_power_get(void);
+
+/**
+  @brief Function for collecting acceleration samples in the MPU6050 FIFO.
+  While enabled the sensor runs in continuous mode and samples at the SMPLRT_DIV rate. Disabling it
+  returns an accelerometer-only sensor to cycle mode. Enabling it again drops the samples left.
+  @param[in] enable Enable or disable the FIFO
+*/
+uint32_t mpu6050_fifo_enable(bool enable);
+
+/**
+  @brief Function for draining the FIFO in one burst read.
+  Reads FIFO_COUNT, then up to p_read->max_samples samples. Samples beyond that stay in the FIFO.
+  If the FIFO overflowed it is reset and p_read->overflow is set.
+  @param[in,out] p_read Drain state and destination buffer
+  @param[in] handler Completion handler
+  @param[in] p_context Passed to handler
+*/
+uint32_t mpu6050_fifo_read_async(mpu6050_fifo_read_t *p_read, mpu6050_evt_handler_t handler, void *p_context);
+
+/**
+  @brief Function for selecting the interrupts routed to the INT pin.
+  The pin is active high and stays high until INT_STATUS is read.
+  @param[in] int_mask Bitwise OR of MOT_INT, FIFO_OFLOW_INT and DATA_RDY_INT
+*/
+uint32_t mpu6050_int_enable(uint8_t int_mask);
+
+/**
+  @brief Function for reading INT_STATUS, which also releases the INT pin.
+  @param[out] p_status INT_STATUS value
+  @param[in] handler Completion handler
+  @param[in] p_context Passed to handler
+*/
+uint32_t mpu6050_int_status_read_async(uint8_t *p_status, mpu6050_evt_handler_t handler, void *p_context);
+
+/**
+  @brief Function for checking that a GPIO is wired to the INT output, by flipping its polarity.
+  @details Blocking. Clears INT_ENABLE and any pending interrupt, re-enable them afterwards.
+  @param[in] pin GPIO the INT output should be connected to
+  @retval true The pin follows INT
+  @retval false The pin does not follow INT, or the bus failed
+*/
+bool mpu6050_int_pin_check(uint32_t pin);
+
+/**
+  @brief Function for configuring the motion detection interrupt.
+  @param[in] threshold MOT_THR, 2 mg per LSB
+  @param[in] duration MOT_DUR, 1 ms per LSB
+*/
+uint32_t mpu6050_motion_detect_config(uint8_t threshold, uint8_t duration);
+
+/**
+  @brief Function for setting SMPLRT_DIV. Sample rate = 1 kHz / (1 + div) with the DLPF enabled.
+*/
+uint32_t mpu6050_set_sample_rate_div(uint8_t div);
+
+/**
+  @brief Function for setting the sample period.
+  Sets SMPLRT_DIV, the widest DLPF bandwidth below Nyquist, and the slowest cycle mode
+  wake-up frequency at or above the sample rate.
+  @param[in] period_ms Sample period, 1 to MPU6050_MAX_SAMPLE_PERIOD ms
+*/
+uint32_t mpu6050_set_sample_period(uint16_t period_ms);
+
+// Power state changes are queued and do not wait for the bus. Writes that change nothing are skipped.
 uint32_t mpu6050_enter_sleep();
 
 uint32_t mpu6050_wake_up();
 
+uint32_t mpu6050_set_wake_up_freq(MPU6050_WAKEUP_FREQ freq);
+
 /**
  *@}
  **/
@@ -6,6 +6,12 @@ typedef enum {
   CONFIG,
   GYRO_CONFIG,
   ACCEL_CONFIG,
+  MOT_THR      = 0x1F,
+  MOT_DUR,
+  FIFO_EN      = 0x23,
+  INT_PIN_CFG  = 0x37,
+  INT_ENABLE,
+  INT_STATUS   = 0x3A,
   ACCEL_XOUT_H = 0x3B,
   ACCEL_XOUT_L,
   ACCEL_YOUT_H,
@@ -23,9 +29,15 @@ typedef enum {
   GYRO_ZOUT_H,
   GYRO_ZOUT_L,
 
+  MOT_DETECT_CTRL = 0x69,
+  USER_CTRL  = 0x6A,
   PWR_MGMT_1 = 0x6B,
   PWR_MGMT_2,
 
+  FIFO_COUNTH = 0x72,
+  FIFO_COUNTL,
+  FIFO_R_W,
+
 } mpu_reg_address;
 
 //  Digital Low Pass Filter
@@ -38,6 +50,12 @@ typedef enum {
 #define DLPF_260HZ (0)
 #define DLPF_RESERVE (7)
 
+// Accelerometer bandwidth of a DLPF setting in Hz, 0 for the reserved one
+#define MPU6050_DLPF_BANDWIDTH(dlpf)                                                          \
+  ((dlpf) == DLPF_260HZ ? 260 : (dlpf) == DLPF_184HZ ? 184 : (dlpf) == DLPF_94HZ ? 94 :       \
+   (dlpf) == DLPF_44HZ ? 44 : (dlpf) == DLPF_21HZ ? 21 : (dlpf) == DLPF_10HZ ? 10 :           \
+   (dlpf) == DLPF_5HZ ? 5 : 0)
+
 #define SAMPLE_50HZ (19)
 #define SAMPLE_125HZ (7)
 
@@ -45,11 +63,43 @@ typedef enum {
 #define ACCEL_FS_4g (8)
 #define ACCEL_FS_8g (0x10)
 #define ACCEL_FS_16g (0x18)
+#define ACCEL_FS_MASK (0x18) // AFS_SEL field
+
+// ACCEL_CONFIG high pass filter, used by motion detection
+#define ACCEL_HPF_5HZ (1)
+#define ACCEL_HPF_2_5HZ (2)
+#define ACCEL_HPF_1_25HZ (3)
+#define ACCEL_HPF_0_63HZ (4)
+#define ACCEL_HPF_HOLD (7)
 
 #define GYRO_FS_250 (0)
 #define GYRO_FS_500 (8)
-#define GYRO_FS_1000 (10)
-#define GYRO_FS_2000 (18)
+#define GYRO_FS_1000 (0x10)
+#define GYRO_FS_2000 (0x18)
+#define GYRO_FS_MASK (0x18) // FS_SEL field
+
+// INT_PIN_CFG
+#define INT_LEVEL_LOW (0x80)
+#define INT_OPEN_DRAIN (0x40)
+#define LATCH_INT_EN (0x20)
+#define INT_RD_CLEAR (0x10)
+
+// INT_ENABLE / INT_STATUS
+#define MOT_INT (0x40)
+#define FIFO_OFLOW_INT (0x10)
+#define DATA_RDY_INT (0x01)
+
+// MOT_DETECT_CTRL
+#define ACCEL_ON_DELAY_3MS (0x30)
+
+// FIFO_EN
+#define ACCEL_FIFO_EN (0x08)
+
+// USER_CTRL
+#define USER_FIFO_EN (0x40)
+#define USER_FIFO_RESET (0x04)
+#define USER_I2C_MST_RESET (0x02)
+#define USER_SIG_COND_RESET (0x01)
 
 // PWR_MGMT_1
 //  it is highly recommended that the device be configured to use one of the gyroscopes (or an external clock source)
@@ -61,6 +111,7 @@ typedef enum {
 #define TEMP_DIS (8)
 #define CYCLE (0x20)
 #define SLEEP (0x40)
+#define DEVICE_RESET (0x80)
 
 #define WAKEUP (0x00)
 
@@ -70,6 +121,7 @@ typedef enum {
 #define LP_WAKE_CTRL_5 (0x40)
 #define LP_WAKE_CTRL_20 (0x80)
 #define LP_WAKE_CTRL_40 (0xC0)
+#define LP_WAKE_CTRL_MASK (0xC0)
 
 
 #endif
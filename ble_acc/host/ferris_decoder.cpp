@@ -0,0 +1,57 @@
+#include "ferris_decoder.hpp"
+
+namespace ferris {
+
+decoder::decoder() : m_stats() {
+  reset();
+}
+
+void decoder::reset() {
+  ferris_codec_decoder_reset(&m_dec);
+  m_seq_valid  = false;
+  m_next_seq   = 0;
+  m_time_valid = false;
+  m_time       = 0;
+}
+
+size_t decoder::feed(uint8_t const *p_data, size_t len, std::vector<sample> &out) {
+  m_stats.packets++;
+  m_stats.bytes += len;
+
+  if (len >= FERRIS_CODEC_HEADER_SIZE) {
+    uint8_t seq = p_data[0] & FERRIS_CODEC_SEQ_MASK;
+    if (m_seq_valid) {
+      m_stats.packets_lost += (seq - m_next_seq) & FERRIS_CODEC_SEQ_MASK;
+    }
+    m_seq_valid = true;
+    m_next_seq  = (seq + 1) & FERRIS_CODEC_SEQ_MASK;
+  }
+
+  int count = len > UINT16_MAX ? -1 : ferris_codec_decode(&m_dec, p_data, (uint16_t)len, m_buf, UINT8_MAX);
+  if (count < 0) {
+    m_stats.packets_dropped++;
+    return 0;
+  }
+
+  out.reserve(out.size() + count);
+  for (int i = 0; i < count; i++) {
+    ferris_codec_sample_t const &in = m_buf[i];
+    sample s;
+
+    if (m_time_valid) {
+      m_time += (uint16_t)(in.timestamp - (uint16_t)m_time);
+    } else {
+      m_time       = in.timestamp;
+      m_time_valid = true;
+    }
+    s.time   = m_time;
+    s.acc[0] = in.acc[0];
+    s.acc[1] = in.acc[1];
+    s.acc[2] = in.acc[2];
+    out.push_back(s);
+  }
+  m_stats.samples += count;
+  return count;
+}
+
+} // namespace ferris
@@ -0,0 +1,63 @@
+#ifndef FERRIS_DECODER_HPP
+#define FERRIS_DECODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ferris_codec.h"
+
+/** @file
+ * @brief Host side decoder of the compressed acceleration characteristic.
+ * Wraps ferris_codec_decode() with what a client needs on top: the 16 bit timestamps are
+ * unwrapped into a 64 bit time line and lost packets are counted from the SEQ gaps.
+ * Timestamps wrap every 64 s, an interruption longer than that shifts the time line by a
+ * multiple of 64 s. Not thread safe, use one decoder per connection.
+ */
+
+namespace ferris {
+
+struct sample {
+  uint64_t time; /**< Capture time in 1/1024 s, unwrapped, starting from the first 16 bit timestamp. */
+  int16_t acc[3];
+};
+
+struct decoder_stats {
+  uint64_t packets;         /**< Packets fed. */
+  uint64_t packets_dropped; /**< Packets discarded while waiting for a keyframe, or malformed. */
+  uint64_t packets_lost;    /**< Packets missing from the SEQ numbers, wraps of 128 are not seen. */
+  uint64_t samples;         /**< Samples decoded. */
+  uint64_t bytes;           /**< Bytes fed. */
+};
+
+class decoder {
+ public:
+  decoder();
+
+  /**
+   * @brief Forget the stream, the next packet must be a keyframe. Call on reconnection.
+   *        The statistics are kept.
+   */
+  void reset();
+
+  /**
+   * @brief Decode one notification and append its samples to out.
+   * @return Number of samples appended, 0 if the packet was dropped.
+   */
+  size_t feed(uint8_t const *p_data, size_t len, std::vector<sample> &out);
+
+  decoder_stats const &stats() const { return m_stats; }
+
+ private:
+  ferris_codec_decoder_t m_dec;
+  ferris_codec_sample_t m_buf[UINT8_MAX];
+  decoder_stats m_stats;
+  bool m_seq_valid;
+  uint8_t m_next_seq;
+  bool m_time_valid;
+  uint64_t m_time; /**< Unwrapped time of the last sample. */
+};
+
+} // namespace ferris
+
+#endif
@@ -5,6 +5,7 @@
 #include "app_scheduler.h"
 #include "app_timer.h"
 #include "app_util_platform.h"
+#include "fstorage.h"
 #include "ble_advdata.h"
 #include "ble_advertising.h"
 #include "ble_bas.h"
@@ -13,9 +14,11 @@
 #include "ble_hci.h"
 #include "ble_srv_common.h"
 #include "softdevice_handler.h"
+#include "softdevice_handler_appsh.h"
 
 #include "nrf_delay.h"
 #include "nrf_drv_adc.h"
+#include "nrf_drv_gpiote.h"
 #include "nrf_drv_twi.h"
 #include "nrf_gpio.h"
 
@@ -23,16 +26,19 @@
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 
+#include "driver/battery.h"
 #include "driver/mpu6050.h"
+#include "driver/mpu_reg.h"
+#include "services/ferris_energy.h"
+#include "services/ferris_profile.h"
 #include "services/ferris_service.h"
+#include "services/ferris_time.h"
 
 typedef __uint8_t uint8_t;
 typedef __uint16_t uint16_t;
 typedef __uint32_t uint32_t;
 typedef __uint64_t uint64_t;
 
-const uint16_t battery_level_voltage[] = {569, 606, 642, 676, 703, 722, 732, 740, 747, 753, 759, 764, 769, 773, 776, 780, 783, 785, 788, 790, 792, 794, 796, 798, 800, 801, 803, 804, 805, 807, 808, 809, 810, 811, 812, 813, 814, 815, 816, 817, 818, 819, 820, 820, 821, 822, 823, 823, 824, 825, 825, 826, 827, 827, 828, 829, 829, 830, 830, 831, 831, 832, 833, 833, 834, 834, 835, 835, 836, 836, 837, 837, 838, 838, 839, 839, 840, 840, 841, 842, 842, 843, 843, 844, 844, 844, 845, 845, 845, 845, 846, 846, 846, 847, 847, 848, 849, 850, 851, 853, 876, 907, 937, 967, 996, 1023};
-
 const int LED_R = 17;
 const int LED_B = 19;
 const int LED_G = 18;
@@ -44,13 +50,40 @@ const int CENTRAL_LINK_COUNT    = 0; /**< Number of central links used by the ap
                                         remember to adjust the RAM settings*/
 const int PERIPHERAL_LINK_COUNT = 1; /**< Number of peripheral links used by the application. When changing this number
                                         remember to adjust the RAM settings*/
+#define ATTR_TAB_SIZE 0xC00          /**< GATT attribute table, the default 0x580 does not hold the ferris service with its
+                                        user descriptions. When changing this number remember to adjust the RAM settings */
 
 // TWI config
 #define TWI_INSTANCE_ID 0 // we are using TWI1
 const int TWI_SCL_PIN = 10;
 const int TWI_SDA_PIN = 9;
-
-#define ADC_BUFFER_SIZE 8
+const int MPU6050_INT_PIN = 8; // SENSOR_PRO board, checked by mpu6050_int_pin_check() at boot
+
+#define BATTERY_PERIOD_BUSY_MS 2000       /**< Battery measurement period under radio load, when the cell sags the most. */
+#define BATTERY_PERIOD_CONNECTED_MS 10000 /**< Battery measurement period while connected or acquiring. */
+#define BATTERY_PERIOD_IDLE_MS 60000      /**< Battery measurement period while nothing happens, below the 512 s RTC1 wrap. */
+#define BATTERY_BUSY_PACKETS 20           /**< Notifications since the last measurement that make the radio busy. */
+
+#define ACC_FIFO_ENABLED 1                 /**< Collect samples in the MPU6050 FIFO and drain them in bursts. */
+#define ACC_FIFO_BURST_SAMPLES 20          /**< Samples drained per timer tick at most. */
+#define ACC_FIFO_DRAIN_SAMPLES 10          /**< Samples collected in the FIFO between two drains. */
+#if ACC_FIFO_ENABLED
+#define ACC_MIN_SAMPLE_INTERVAL 4          /**< Shortest sample_interval in ms (250 Hz). */
+#else
+#define ACC_MIN_SAMPLE_INTERVAL MPU6050_CYCLE_MIN_PERIOD /**< Without the FIFO the accelerometer stays in cycle mode. */
+#endif
+#define ACC_MAX_SAMPLE_INTERVAL 10000      /**< Longest sample_interval in ms. */
+#define ACC_MOTION_THRESHOLD 20            /**< MOT_THR, 2 mg per LSB. */
+#define ACC_MOTION_DURATION 40             /**< MOT_DUR, in ms. */
+#define ACC_IDLE_TIMEOUT APP_TIMER_TICKS(5000, APP_TIMER_PRESCALER) /**< Time without motion before acquisition stops. */
+#define ACC_IDLE_POLL_MS 2000                                        /**< Acceleration check while idle, for motion too slow for MOT_INT. */
+#define ACC_RETRY_MS 20                                              /**< Delay before a sensor write that did not fit the bus queue is tried again. */
+#define ACC_IDLE_DRIFT 290                                           /**< Change of an axis that counts as motion, 2 g LSB (about 1 degree of tilt). */
+#define ACC_OFFLINE_LOG 1                                            /**< Keep motion detection on while disconnected and log samples to flash. */
+#ifndef ACC_BROADCAST
+#define ACC_BROADCAST 0 /**< Put the latest sample and the battery level in the advertising data. */
+#endif
+#define ACC_MOTION_CHANNELS (MPU6050_CHANNEL_GYRO | MPU6050_CHANNEL_TEMP) /**< Channels read with the 14 byte motion burst. */
 
 #define APP_FEATURE_NOT_SUPPORTED BLE_GATT_STATUS_ATTERR_APP_BEGIN + 2 /**< Reply when unsupported features are requested. */
 
@@ -62,6 +95,10 @@ const int TWI_SDA_PIN = 9;
 #define APP_ADV_FAST_TIMEOUT 30        /**< The duration of the fast advertising period (in seconds). */
 #define APP_ADV_SLOW_TIMEOUT 48* 3600 /**< The advertising timeout in units of seconds. */
 
+#define BROADCAST_COMPANY_ID 0x0059   /**< Company identifier of the manufacturer specific data, Nordic Semiconductor. */
+#define BROADCAST_SLOW_INTERVAL 1600  /**< Slow advertising interval in broadcast mode (1 second), how fresh a scanner sees the data. */
+#define BROADCAST_PAYLOAD_SIZE 7      /**< {SEQ, X[11:4], X[3:0] Y[11:8], Y[7:0], Z[11:4], Z[3:0] 0, BATTERY}. */
+
 // Low frequency clock source to be used by the SoftDevice
 #define NRF_CLOCK_LFCLKSRC                                            \
   {                                                                   \
@@ -69,13 +106,26 @@ const int TWI_SDA_PIN = 9;
     .xtal_accuracy = NRF_CLOCK_LF_XTAL_ACCURACY_20_PPM                \
   }
 
+// Interrupt handlers only capture their data and put an event in app_scheduler, the main loop does the work.
+#define SCHED_MAX_EVENT_DATA_SIZE MAX(MAX(APP_TIMER_SCHED_EVENT_DATA_SIZE, BLE_STACK_HANDLER_SCHED_EVT_SIZE), \
+                                      MAX(MAX(MPU6050_SCHED_EVENT_SIZE, FERRIS_SCHED_EVENT_SIZE),        \
+                                          MAX(sizeof(nrf_adc_value_t), sizeof(uint32_t)))) /**< Maximum size of scheduler events. */
+#define SCHED_TIMER_EVENTS 7                                                     /**< accel, accel poll, accel retry, battery, conn_params, conn_ctrl and the ferris batch deadline timer. */
+#define SCHED_OTHER_EVENTS 5                                                     /**< SoftDevice, ADC burst, MPU6050 INT, ferris batch deadline and sample_interval change. */
+#define SCHED_QUEUE_SIZE (SCHED_TIMER_EVENTS + MPU6050_TXN_QUEUE_SIZE + SCHED_OTHER_EVENTS) /**< One event of each source, and a TWI completion per queued transaction. */
+
 #define APP_TIMER_PRESCALER 0     /**< Value of the RTC1 PRESCALER register. */
-#define APP_TIMER_OP_QUEUE_SIZE 4 /**< Size of timer operation queues. */
+#define APP_TIMER_OP_QUEUE_SIZE 8 /**< Size of timer operation queues. */
 
 #define MIN_CONN_INTERVAL MSEC_TO_UNITS(100, UNIT_1_25_MS) /**< Minimum acceptable connection interval (0.1 seconds). */
 #define MAX_CONN_INTERVAL MSEC_TO_UNITS(200, UNIT_1_25_MS) /**< Maximum acceptable connection interval (0.2 second). */
 #define SLAVE_LATENCY 0                                    /**< Slave latency. */
 #define CONN_SUP_TIMEOUT MSEC_TO_UNITS(4000, UNIT_10_MS)   /**< Connection supervisory timeout (4 seconds). */
+#define BULK_CONN_INTERVAL MSEC_TO_UNITS(7.5, UNIT_1_25_MS) /**< Connection interval during a bulk transfer of the offline log. */
+
+#define CONN_CTRL_PERIOD_MS 5000       /**< The notification rate is measured over this period. */
+#define CONN_CTRL_HOLDOFF_PERIODS 6    /**< Periods between two renegotiations, unless the queues back up. */
+#define CONN_CTRL_BACKLOG_SAMPLES (FERRIS_TX_QUEUE_SIZE / 2) /**< Queued samples that make the controller speed up right away. */
 
 #define FIRST_CONN_PARAMS_UPDATE_DELAY APP_TIMER_TICKS(5000, APP_TIMER_PRESCALER) /**< Time from initiating event (connect or start of notification) to first time sd_ble_gap_conn_param_update is called (5 seconds). */
 #define NEXT_CONN_PARAMS_UPDATE_DELAY APP_TIMER_TICKS(30000, APP_TIMER_PRESCALER) /**< Time between each call to sd_ble_gap_conn_param_update after the first call (30 seconds). */
@@ -85,19 +135,70 @@ static ble_uuid_t m_adv_uuids[] = {
     {BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_TYPE_BLE}}; /**< Universally unique service identifiers. */
 
 static uint32_t last_error_code;
+#if ACC_BROADCAST
+// Manufacturer specific data in broadcast mode: sequence number, the upper 12 bits of each axis, battery level in %.
+static uint8_t m_broadcast_payload[BROADCAST_PAYLOAD_SIZE];
+static ble_advdata_manuf_data_t m_broadcast_manuf = {
+    .company_identifier = BROADCAST_COMPANY_ID,
+    .data               = {.size = sizeof(m_broadcast_payload), .p_data = m_broadcast_payload},
+};
+#endif
 static uint16_t m_conn_handle = BLE_CONN_HANDLE_INVALID; /**< Handle of the current connection. */
+static bool m_advertising;                                /**< Advertising, for the energy accounting. */
+static ferris_energy_t m_energy;                          /**< Diagnostics, refreshed with the battery. */
+#if FERRIS_PROFILE_ENABLED
+static ferris_profile_t m_profile; /**< Sample path timing, refreshed with the battery. */
+#endif
 static ble_bas_t m_bas;
 static ferris_service_t m_ferris;
 static nrf_drv_twi_t m_twi = NRF_DRV_TWI_INSTANCE(TWI_INSTANCE_ID);
 
-// ADC for battery
-static nrf_drv_adc_channel_t battery_adc_channel = NRF_DRV_ADC_DEFAULT_CHANNEL(NRF_ADC_CONFIG_INPUT_DISABLED); //Get default ADC channel configuration;
-static nrf_adc_value_t battery_raw, adc_buffer[ADC_BUFFER_SIZE];
+// ADC for battery. The same input is enabled once per burst conversion, one scan converts them all back to back.
+static nrf_drv_adc_channel_t battery_adc_channels[BATTERY_BURST_SIZE];
+static nrf_adc_value_t battery_raw, adc_buffer[BATTERY_BURST_SIZE];
 static uint16_t battery_voltage;
+static battery_level_t battery_level;
+static battery_filter_t battery_filter;
+static uint32_t battery_last_packets; // tx_stats.packets_sent at the last measurement
 static uint8_t acc_data[6];
+#if ACC_FIFO_ENABLED
+STATIC_ASSERT(ACC_FIFO_BURST_SAMPLES <= MPU6050_FIFO_MAX_BURST);
+static uint8_t acc_fifo_buffer[ACC_FIFO_BURST_SAMPLES * MPU6050_SAMPLE_SIZE];
+static mpu6050_fifo_read_t acc_fifo_read = {.p_data = acc_fifo_buffer, .max_samples = ACC_FIFO_BURST_SAMPLES};
+static bool acc_fifo_busy;
+static uint8_t acc_motion[MPU6050_MOTION_SIZE]; // gyro and temperature are read apart from the FIFO
+static bool acc_motion_busy;
+#else
+static uint8_t acc_sample[MPU6050_MOTION_SIZE]; // TWI destination, copied to acc_data once the read completes
+static uint32_t acc_sample_tick;                // capture time of acc_sample, taken at the INT edge
+#endif
+static uint8_t acc_int_status;
+static bool acc_int_wired;           // MPU6050_INT_PIN passed the boot check, the idle check polls otherwise
+static volatile bool acc_int_missed; // an INT_STATUS read was dropped, the latched pin may be stuck high
+static uint8_t acc_channels = MPU6050_CHANNEL_ACCEL; // sensor channels a client is subscribed to
+static bool acc_demand;          // something consumes samples, the sensor sleeps otherwise
+static bool acc_mode_pending;     // the sensor mode for acc_active did not fit the bus queue yet
+static bool acc_retry_pending;    // accel_retry_timer runs
+static bool acc_rate_pending;     // sample_interval was written and is not applied yet
+static bool acc_active;          // acquisition running, the wheel moved recently
+static uint32_t acc_motion_tick; // time of the last motion, ferris_time_now()
+static int16_t acc_still[3];     // acceleration where the wheel last moved
+static uint8_t acc_poll[MPU6050_SAMPLE_SIZE]; // acceleration read by the idle check
+static bool acc_poll_busy;
+
+// Acquisition rate, set from the sample_interval characteristic by accel_rate_apply()
+static uint32_t acc_period_ticks;   // sensor sample period
+static uint32_t acc_interval_ticks; // reported sample interval, acc_decimation sensor samples
+static uint32_t acc_drain_ticks;    // FIFO drain timer period
+static uint8_t acc_decimation;      // forward every n-th sensor sample
+static uint8_t acc_decimation_count;
+static uint32_t acc_last_sample_tick; // capture time of the last forwarded sample
 // Define timer
 APP_TIMER_DEF(accel_timer_id);   /**<  acceleration timer. */
 APP_TIMER_DEF(battery_timer_id); /**<  battery timer. */
+APP_TIMER_DEF(conn_ctrl_timer_id); /**<  connection parameter controller timer. */
+APP_TIMER_DEF(accel_poll_timer_id); /**<  idle acceleration check timer. */
+APP_TIMER_DEF(accel_retry_timer_id); /**<  sensor configuration retry timer. */
 
 void check_error(volatile uint32_t err_code) {
   if (err_code) {
@@ -122,8 +223,11 @@ void check_error(volatile uint32_t err_code) {
 static void on_adv_evt(ble_adv_evt_t ble_adv_evt) {
   switch (ble_adv_evt) {
   case BLE_ADV_EVT_FAST:
+  case BLE_ADV_EVT_SLOW:
+    m_advertising = true;
     break; // BLE_ADV_EVT_FAST
   case BLE_ADV_EVT_IDLE:
+    m_advertising = false;
     nrf_gpio_pin_set(LED_B);
     break; // BLE_ADV_EVT_IDLE
   default:
@@ -131,35 +235,90 @@ static void on_adv_evt(ble_adv_evt_t ble_adv_evt) {
   }
 }
 
+// Advertising and scan response data. In broadcast mode the sensor data pushes the name into the scan response.
+static void advdata_build(ble_advdata_t *p_advdata, ble_advdata_t *p_srdata) {
+  memset(p_advdata, 0, sizeof(*p_advdata));
+  memset(p_srdata, 0, sizeof(*p_srdata));
+
+  p_advdata->include_appearance = true;
+  p_advdata->flags              = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+#if ACC_BROADCAST
+  p_advdata->p_manuf_specific_data = &m_broadcast_manuf;
+  p_srdata->name_type               = BLE_ADVDATA_FULL_NAME;
+  p_srdata->uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
+  p_srdata->uuids_complete.p_uuids  = m_adv_uuids;
+#else
+  p_advdata->name_type               = BLE_ADVDATA_FULL_NAME;
+  p_advdata->uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
+  p_advdata->uuids_complete.p_uuids  = m_adv_uuids;
+#endif
+}
+
 /**@brief Function for initializing the Advertising functionality.
  */
 static void advertising_init(void) {
   uint32_t err_code;
 
   ble_advdata_t advdata;
+  ble_advdata_t srdata;
   ble_adv_modes_config_t options;
 
   // Build advertising data struct to pass into @ref ble_advertising_init.
-  memset(&advdata, 0, sizeof(advdata));
-
-  advdata.name_type               = BLE_ADVDATA_FULL_NAME;
-  advdata.include_appearance      = true;
-  advdata.flags                   = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
-  advdata.uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
-  advdata.uuids_complete.p_uuids  = m_adv_uuids;
+  advdata_build(&advdata, &srdata);
 
   memset(&options, 0, sizeof(options));
   options.ble_adv_fast_enabled  = true;
   options.ble_adv_fast_interval = APP_ADV_FAST_INTERVAL;
   options.ble_adv_fast_timeout  = APP_ADV_FAST_TIMEOUT;
   options.ble_adv_slow_enabled  = true;
+#if ACC_BROADCAST
+  // the broadcast is the product, it must not run out
+  options.ble_adv_slow_interval = BROADCAST_SLOW_INTERVAL;
+  options.ble_adv_slow_timeout  = BLE_GAP_ADV_TIMEOUT_GENERAL_UNLIMITED;
+#else
   options.ble_adv_slow_interval = APP_ADV_SLOW_INTERVAL;
   options.ble_adv_slow_timeout  = APP_ADV_SLOW_TIMEOUT;
+#endif
 
-  err_code = ble_advertising_init(&advdata, NULL, &options, on_adv_evt, NULL);
+  err_code = ble_advertising_init(&advdata, &srdata, &options, on_adv_evt, NULL);
   check_error(err_code);
 }
 
+#if ACC_BROADCAST
+/**
+ * @brief Refresh the advertising data from m_broadcast_payload. The SoftDevice swaps the data in
+ *        place, advertising keeps running.
+ */
+static void broadcast_refresh(void) {
+  ble_advdata_t advdata;
+  ble_advdata_t srdata;
+
+  if (m_conn_handle != BLE_CONN_HANDLE_INVALID) {
+    return; // not advertising
+  }
+  m_broadcast_payload[6] = battery_level.level;
+  advdata_build(&advdata, &srdata);
+  check_error(ble_advdata_set(&advdata, &srdata));
+}
+
+// Put a new sample in the broadcast, the sequence number tells a scanner it is new.
+static void broadcast_sample(uint8_t const *p_sample) {
+  int16_t axis[3];
+
+  for (int i = 0; i < 3; i++) {
+    axis[i] = (int16_t)((p_sample[2 * i] << 8) | p_sample[2 * i + 1]) >> 4;
+  }
+  uint8_t *p = m_broadcast_payload;
+  p[0]++;
+  p[1] = axis[0] >> 4;
+  p[2] = (axis[0] << 4) | ((axis[1] >> 8) & 0x0F);
+  p[3] = axis[1];
+  p[4] = axis[2] >> 4;
+  p[5] = axis[2] << 4;
+  broadcast_refresh();
+}
+#endif
+
 static void on_ble_evt(ble_evt_t *p_ble_evt) {
   uint32_t err_code = NRF_SUCCESS;
 
@@ -168,6 +327,7 @@ static void on_ble_evt(ble_evt_t *p_ble_evt) {
 #ifdef DEBUG
     nrf_gpio_pin_set(LED_G);
 #endif
+    m_conn_handle = BLE_CONN_HANDLE_INVALID;
     ble_advertising_start(BLE_ADV_MODE_SLOW);
     break; // BLE_GAP_EVT_DISCONNECTED
 
@@ -234,21 +394,35 @@ static void on_ble_evt(ble_evt_t *p_ble_evt) {
     break;
   }
 }
+uint32_t accel_timer_start(void);
+static void accel_activate(void);
+static void accel_deactivate(void);
+static void accel_demand_update(void);
+static void accel_int_status_read(void);
+static void accel_mode_update(void);
+static void accel_retry_later(void);
+static void accel_rate_apply(void);
+static void accel_int_retry(void);
+static void ferris_evt_handler(ferris_service_t *p_ferris_service, ferris_evt_t *p_evt);
+static void conn_ctrl_on_ble_evt(ble_evt_t *p_ble_evt);
+
 static void mpu6050_on_ble_evt(ble_evt_t *p_ble_evt) {
   switch (p_ble_evt->header.evt_id) {
   case BLE_GAP_EVT_DISCONNECTED:
-    mpu6050_enter_sleep();
+    accel_deactivate();
+    accel_demand_update();
     break;
 
   case BLE_GAP_EVT_CONNECTED:
-    mpu6050_wake_up();
+    // nothing is subscribed yet, the offline log or the broadcast stop consuming
+    accel_demand_update();
     break;
   }
 }
 
 /**@brief Function for dispatching a BLE stack event to all modules with a BLE stack event handler.
  *
- * @details This function is called from the BLE Stack event interrupt handler after a BLE stack
+ * @details This function is called from the scheduler in the main loop after a BLE stack
  *          event has been received.
  *
  * @param[in] p_ble_evt  Bluetooth stack event.
@@ -271,6 +445,16 @@ static void ble_evt_dispatch(ble_evt_t *p_ble_evt) {
 
   // sensors
   mpu6050_on_ble_evt(p_ble_evt);
+
+  conn_ctrl_on_ble_evt(p_ble_evt);
+}
+
+/**@brief Function for dispatching a system event to the modules that use them.
+ *
+ * @param[in] sys_evt  System event.
+ */
+static void sys_evt_dispatch(uint32_t sys_evt) {
+  fs_sys_event_handler(sys_evt);
 }
 
 /**@brief Function for initializing the BLE stack.
@@ -283,22 +467,25 @@ static void ble_stack_init(void) {
   nrf_clock_lf_cfg_t clock_lf_cfg = NRF_CLOCK_LFCLKSRC;
 
   // Initialize the SoftDevice handler module.
-  SOFTDEVICE_HANDLER_INIT(&clock_lf_cfg, NULL);
+  SOFTDEVICE_HANDLER_APPSH_INIT(&clock_lf_cfg, true);
 
   ble_enable_params_t ble_enable_params;
   err_code = softdevice_enable_get_default_config(CENTRAL_LINK_COUNT, PERIPHERAL_LINK_COUNT, &ble_enable_params);
   check_error(err_code);
 
-  // Check the ram settings against the used number of links
-  CHECK_RAM_START_ADDR(CENTRAL_LINK_COUNT, PERIPHERAL_LINK_COUNT);
+  ble_enable_params.gatts_enable_params.attr_tab_size = ATTR_TAB_SIZE;
 
-  // Enable BLE stack.
+  // Enable BLE stack. Fails with NO_MEM, and logs the RAM start it needs, if the RAM settings are too low.
   err_code = softdevice_enable(&ble_enable_params);
   check_error(err_code);
 
   // Register with the SoftDevice handler module for BLE events.
   err_code = softdevice_ble_evt_handler_set(ble_evt_dispatch);
   check_error(err_code);
+
+  // Register with the SoftDevice handler module for system events, fstorage needs the flash events.
+  err_code = softdevice_sys_evt_handler_set(sys_evt_dispatch);
+  check_error(err_code);
 }
 
 /**@brief Function for the GAP initialization.
@@ -357,18 +544,169 @@ static void services_init(void) {
   ferris_service_init_t ferris_init;
   ferris_init.p_acceleration_data = acc_data;
   ferris_init.p_battery_voltage   = &battery_voltage;
+  ferris_init.p_energy            = &m_energy;
+#if FERRIS_PROFILE_ENABLED
+  ferris_init.p_profile = &m_profile;
+#else
+  ferris_init.p_profile = NULL;
+#endif
+  ferris_init.evt_handler         = ferris_evt_handler;
+  ferris_init.log_enabled         = ACC_OFFLINE_LOG;
 
   err_code = ferris_service_init(&m_ferris, &ferris_init);
   check_error(err_code);
 }
 
+/**
+ * @brief Connection parameter tiers, fastest first.
+ *
+ * @details The controller picks the slowest tier whose min_packets the notification rate reaches,
+ *          so the radio only wakes up as often as there is something to send. CONN_TIER_BULK is
+ *          only used while the offline log is downloaded.
+ */
+typedef struct {
+  uint16_t min_packets; /**< Notifications per CONN_CTRL_PERIOD_MS that call for this tier. */
+  ble_gap_conn_params_t params;
+} conn_tier_t;
+
+enum {
+  CONN_TIER_BULK = 0,
+  CONN_TIER_FAST,
+  CONN_TIER_MEDIUM,
+  CONN_TIER_DEFAULT,
+  CONN_TIER_IDLE,
+  CONN_TIER_COUNT,
+};
+
+static const conn_tier_t conn_tiers[CONN_TIER_COUNT] = {
+    [CONN_TIER_BULK]    = {UINT16_MAX, {BULK_CONN_INTERVAL, BULK_CONN_INTERVAL, 0, CONN_SUP_TIMEOUT}},
+    [CONN_TIER_FAST]    = {100, {MSEC_TO_UNITS(15, UNIT_1_25_MS), MSEC_TO_UNITS(30, UNIT_1_25_MS), 0, CONN_SUP_TIMEOUT}},
+    [CONN_TIER_MEDIUM]  = {25, {MSEC_TO_UNITS(50, UNIT_1_25_MS), MSEC_TO_UNITS(100, UNIT_1_25_MS), 0, CONN_SUP_TIMEOUT}},
+    [CONN_TIER_DEFAULT] = {5, {MIN_CONN_INTERVAL, MAX_CONN_INTERVAL, SLAVE_LATENCY, CONN_SUP_TIMEOUT}},
+    // (1 + latency) * max interval * 2 must stay below the supervision timeout
+    [CONN_TIER_IDLE]    = {0, {MSEC_TO_UNITS(200, UNIT_1_25_MS), MSEC_TO_UNITS(400, UNIT_1_25_MS), 4, MSEC_TO_UNITS(6000, UNIT_10_MS)}},
+};
+
+static uint8_t conn_tier;         // tier last asked for
+static uint8_t conn_tier_refused; // bit mask of tiers the central refused on this connection
+static uint8_t conn_holdoff;      // periods until the next renegotiation
+static bool conn_preferred_stale; // ble_conn_params still prefers the tier of the last connection
+static bool conn_bulk;            // a bulk transfer is running
+static uint32_t conn_last_packets;
+
+static void conn_tier_apply(uint8_t tier) {
+  ble_gap_conn_params_t conn_params = conn_tiers[tier].params;
+
+  // Updates ble_conn_params, which calls sd_ble_gap_conn_param_update and retries on our behalf.
+  uint32_t err_code = ble_conn_params_change_conn_params(&conn_params);
+  if (err_code == NRF_ERROR_BUSY || err_code == NRF_ERROR_INVALID_STATE || err_code == BLE_ERROR_INVALID_CONN_HANDLE) {
+    return; // a procedure is running or the link just went down, the next period tries again
+  }
+  check_error(err_code);
+  conn_tier    = tier;
+  conn_holdoff = CONN_CTRL_HOLDOFF_PERIODS;
+}
+
+// Pick the tier for the last period. Speeding up may skip tiers, slowing down goes one tier at a time.
+static void conn_ctrl_update(bool urgent) {
+  uint32_t packets  = m_ferris.tx_stats.packets_sent - conn_last_packets;
+  conn_last_packets = m_ferris.tx_stats.packets_sent;
+
+  uint8_t tier = CONN_TIER_FAST;
+  while (packets < conn_tiers[tier].min_packets) {
+    tier++;
+  }
+  if (tier > conn_tier) {
+    tier = conn_tier + 1;
+  }
+
+  // samples waiting for the radio, the interval is too long whatever the rate says
+  if (m_ferris.acc_queue_count >= CONN_CTRL_BACKLOG_SAMPLES || m_ferris.batch_count >= FERRIS_BATCH_RING_SIZE / 2) {
+    tier   = MIN(tier, MAX(conn_tier, CONN_TIER_FAST + 1) - 1);
+    urgent = true;
+  }
+
+  while (tier < CONN_TIER_IDLE && (conn_tier_refused & (1 << tier))) {
+    tier++;
+  }
+  if (tier == conn_tier || (conn_tier_refused & (1 << tier)) || (conn_holdoff > 0 && !urgent)) {
+    return;
+  }
+  conn_tier_apply(tier);
+}
+
+static void conn_ctrl_timeout_handler(void *p_context) {
+  if (conn_holdoff > 0) {
+    conn_holdoff--;
+  }
+  if (!conn_bulk) {
+    conn_ctrl_update(false);
+  }
+}
+
+// Ask for the shortest interval while the backlog drains, and go back to the rate driven tier after.
+static void conn_ctrl_bulk_set(bool active) {
+  conn_bulk = active;
+  if (m_conn_handle == BLE_CONN_HANDLE_INVALID) {
+    return;
+  }
+  if (active) {
+    // The central may refuse, the transfer then runs at the current interval.
+    if (!(conn_tier_refused & (1 << CONN_TIER_BULK))) {
+      conn_tier_apply(CONN_TIER_BULK);
+    }
+  } else if (conn_tier == CONN_TIER_BULK) {
+    conn_tier_apply(CONN_TIER_DEFAULT);
+  }
+}
+
+// Called when ble_conn_params gave up on the parameters. Returns true if they were a controller
+// tier, which is then not asked for again on this connection.
+static bool conn_ctrl_refused(void) {
+  if (m_conn_handle == BLE_CONN_HANDLE_INVALID || conn_tier == CONN_TIER_DEFAULT) {
+    return false;
+  }
+  conn_tier_refused |= 1 << conn_tier;
+  conn_tier_apply(CONN_TIER_DEFAULT);
+  return true;
+}
+
+static void conn_ctrl_on_ble_evt(ble_evt_t *p_ble_evt) {
+  switch (p_ble_evt->header.evt_id) {
+  case BLE_GAP_EVT_CONNECTED:
+    // ble_conn_params negotiates the default tier first, leave it time for that
+    conn_tier         = CONN_TIER_DEFAULT;
+    conn_tier_refused = 0;
+    conn_holdoff      = CONN_CTRL_HOLDOFF_PERIODS;
+    conn_last_packets = m_ferris.tx_stats.packets_sent;
+    if (conn_preferred_stale) {
+      // it would negotiate the tier of the last connection, now there is a link to tell it
+      conn_preferred_stale = false;
+      conn_tier_apply(CONN_TIER_DEFAULT);
+    }
+    check_error(app_timer_start(conn_ctrl_timer_id, APP_TIMER_TICKS(CONN_CTRL_PERIOD_MS, APP_TIMER_PRESCALER), NULL));
+    break;
+
+  case BLE_GAP_EVT_DISCONNECTED:
+    check_error(app_timer_stop(conn_ctrl_timer_id));
+    conn_bulk = false;
+    if (conn_tier != CONN_TIER_DEFAULT) {
+      // No link to update any more, only the PPCP characteristic for the next central.
+      // ble_conn_params has already dropped its handle and is told on the next connection.
+      conn_tier            = CONN_TIER_DEFAULT;
+      conn_preferred_stale = true;
+      check_error(sd_ble_gap_ppcp_set(&conn_tiers[CONN_TIER_DEFAULT].params));
+    }
+    break;
+  }
+}
+
 /**@brief Function for handling the Connection Parameters Module.
  *
  * @details This function will be called for all events in the Connection Parameters Module which
  *          are passed to the application.
- *          @note All this function does is to disconnect. This could have been done by simply
- *                setting the disconnect_on_fail config parameter, but instead we use the event
- *                handler mechanism to demonstrate its use.
+ *          @note A refused controller tier falls back to the default parameters, only a refused
+ *                default disconnects.
  *
  * @param[in] p_evt  Event received from the Connection Parameters Module.
  */
@@ -376,6 +714,9 @@ static void on_conn_params_evt(ble_conn_params_evt_t *p_evt) {
   uint32_t err_code;
 
   if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED) {
+    if (conn_ctrl_refused()) {
+      return;
+    }
     err_code = sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
     APP_ERROR_CHECK(err_code);
   }
@@ -412,37 +753,84 @@ static void conn_params_init(void) {
 /**@brief Function for the Power manager.
  */
 static void power_manage(void) {
+  // radio and sensor only change state while the CPU runs, so their state at sleep is exact enough
+  if (m_conn_handle != BLE_CONN_HANDLE_INVALID) {
+    ferris_energy_state_set(FERRIS_ENERGY_RADIO_CONNECTED);
+  } else {
+    ferris_energy_state_set(m_advertising ? FERRIS_ENERGY_RADIO_ADVERTISING : FERRIS_ENERGY_RADIO_IDLE);
+  }
+  ferris_energy_state_set((ferris_energy_state_t)(FERRIS_ENERGY_SENSOR_SLEEP + mpu6050_power_get()));
+
+  ferris_energy_state_set(FERRIS_ENERGY_CPU_SLEEP);
   uint32_t err_code = sd_app_evt_wait();
+  ferris_energy_state_set(FERRIS_ENERGY_CPU_RUN);
+  ferris_energy_count(FERRIS_ENERGY_WAKEUPS, 1);
   check_error(err_code);
 }
 
+/**@brief Refresh the diagnostics characteristics and print them on RTT, if logging is enabled. */
+static void diagnostics_refresh(void) {
+  mpu6050_bus_stats_t bus;
+
+  mpu6050_bus_stats_get(&bus);
+  ferris_energy_counter_set(FERRIS_ENERGY_TWI_TRANSACTIONS, bus.transactions);
+  ferris_energy_counter_set(FERRIS_ENERGY_TWI_BYTES, bus.bytes);
+  ferris_energy_counter_set(FERRIS_ENERGY_TWI_ASLEEP_READS, bus.asleep_reads);
+  ferris_energy_counter_set(FERRIS_ENERGY_HVX, m_ferris.tx_stats.packets_sent);
+  ferris_energy_snapshot(&m_energy);
+
+  NRF_LOG_INFO("cpu ms run %u sleep %u, wakeups %u\r\n", m_energy.state_ms[FERRIS_ENERGY_CPU_RUN],
+               m_energy.state_ms[FERRIS_ENERGY_CPU_SLEEP], m_energy.counters[FERRIS_ENERGY_WAKEUPS]);
+  NRF_LOG_INFO("radio ms adv %u conn %u, hvx %u\r\n", m_energy.state_ms[FERRIS_ENERGY_RADIO_ADVERTISING],
+               m_energy.state_ms[FERRIS_ENERGY_RADIO_CONNECTED], m_energy.counters[FERRIS_ENERGY_HVX]);
+  NRF_LOG_INFO("sensor ms cycle %u accel %u gyro %u\r\n", m_energy.state_ms[FERRIS_ENERGY_SENSOR_CYCLE],
+               m_energy.state_ms[FERRIS_ENERGY_SENSOR_ACCEL], m_energy.state_ms[FERRIS_ENERGY_SENSOR_GYRO]);
+  NRF_LOG_INFO("twi %u transactions %u bytes, charge %u uAh\r\n", m_energy.counters[FERRIS_ENERGY_TWI_TRANSACTIONS],
+               m_energy.counters[FERRIS_ENERGY_TWI_BYTES], m_energy.charge_uah);
+
+#if FERRIS_PROFILE_ENABLED
+  ferris_profile_summary(&m_profile);
+  for (int i = 0; i < FERRIS_PROFILE_STAGE_COUNT; i++) {
+    ferris_profile_summary_t const *p_stage = &m_profile.stages[i];
+    NRF_LOG_INFO("stage %d us min %u p50 %u p90 %u max %u\r\n", i, p_stage->min_us, p_stage->p50_us,
+                 p_stage->p90_us, p_stage->max_us);
+  }
+#endif
+}
+
 void update_battery(uint16_t raw) {
-  uint8_t level = 0;
-  while(level < sizeof(battery_level_voltage) / sizeof(uint16_t) && battery_level_voltage[level] <= raw) {
-    level ++;
-  };
-  ble_bas_battery_level_update(&m_bas, level);
-  battery_voltage = raw * 3600.0 / 1024;
+  uint16_t filtered = battery_filter_update(&battery_filter, raw);
+
+  if (battery_level_update(&battery_level, battery_filtered_to_raw(filtered))) {
+    ble_bas_battery_level_update(&m_bas, battery_level.level);
+#if ACC_BROADCAST
+    broadcast_refresh();
+#endif
+  }
+  battery_voltage = battery_filtered_to_mv(filtered);
 }
 
+// Start a burst of BATTERY_BURST_SIZE conversions, adc_event_handler gets them all at once.
 void battery_adc_sample() {
   uint32_t err_code;
-  err_code = nrf_drv_adc_buffer_convert(adc_buffer, ADC_BUFFER_SIZE);
+  err_code = nrf_drv_adc_buffer_convert(adc_buffer, BATTERY_BURST_SIZE);
   check_error(err_code);
+  nrf_drv_adc_sample();
+  ferris_energy_count(FERRIS_ENERGY_ADC_BURSTS, 1);
+}
+
+static void battery_sched_handler(void *p_event_data, uint16_t event_size) {
+  battery_raw = *(nrf_adc_value_t *)p_event_data;
+  update_battery(battery_raw);
 }
 
 /**
- * @brief ADC interrupt handler.
+ * @brief ADC interrupt handler. Reduces the burst to its median, the filter and the BLE update run from the main loop.
  */
 static void adc_event_handler(nrf_drv_adc_evt_t const *p_event) {
   if (p_event->type == NRF_DRV_ADC_EVT_DONE) {
-    int sum = 0;
-    for (int i = 0; i < p_event->data.done.size; i++) {
-      sum += p_event->data.done.p_buffer[i];
-    }
-    sum /= p_event->data.done.size;
-    battery_raw = sum;
-    update_battery(sum);
+    nrf_adc_value_t raw = battery_burst_median(p_event->data.done.p_buffer, p_event->data.done.size);
+    app_sched_event_put(&raw, sizeof(raw), battery_sched_handler);
   }
 }
 
@@ -456,27 +844,10 @@ static void adc_config(void) {
   ret_code = nrf_drv_adc_init(&config, adc_event_handler);
   check_error(ret_code);
 
-  nrf_drv_adc_channel_enable(&battery_adc_channel);
-}
-
-/**
- * @brief TWI events handler.
- */
-/*
-void twi_handler(nrf_drv_twi_evt_t const *p_event, void *p_context) {
-  switch (p_event->type) {
-  case NRF_DRV_TWI_EVT_DONE:
-    // if (p_event->xfer_desc.type == NRF_DRV_TWI_XFER_RX)
-    // {
-    //     data_handler(m_sample);
-    // }
-    // m_xfer_done = true;
-    break;
-  default:
-    break;
+  for (int i = 0; i < BATTERY_BURST_SIZE; i++) {
+    nrf_drv_adc_channel_enable(&battery_adc_channels[i]);
   }
 }
-*/
 
 /**
  * @brief UART initialization.
@@ -492,43 +863,532 @@ void twi_init(void) {
       .clear_bus_init     = true,
   };
 
-  // when event_handler == NULL, enable blocking mode
-  err_code = nrf_drv_twi_init(&m_twi, &twi_config, NULL, NULL);
+  // transfers are non-blocking, the mpu6050 driver queues them and completes them from the TWI interrupt
+  err_code = nrf_drv_twi_init(&m_twi, &twi_config, mpu6050_twi_evt_handler, NULL);
   check_error(err_code);
 
   nrf_drv_twi_enable(&m_twi);
 }
 
+/**
+ * @brief Start acquisition after motion. Stopped again by accel_idle_check().
+ */
+static void accel_activate(void) {
+  acc_motion_tick = ferris_time_now();
+  if (acc_active || !acc_demand) {
+    return;
+  }
+  acc_active = true;
+  accel_mode_update();
+#if ACC_FIFO_ENABLED
+  check_error(accel_timer_start());
+#else
+  if (!acc_int_wired) {
+    check_error(accel_timer_start());
+  }
+#endif
+}
+
+static void accel_deactivate(void) {
+  if (!acc_active) {
+    return;
+  }
+  acc_active = false;
+#if ACC_FIFO_ENABLED
+  check_error(app_timer_stop(accel_timer_id));
+#else
+  if (!acc_int_wired) {
+    check_error(app_timer_stop(accel_timer_id));
+  }
+#endif
+  accel_mode_update();
+#if ACC_OFFLINE_LOG
+  if (m_conn_handle == BLE_CONN_HANDLE_INVALID) {
+    // close the motion episode, the next one starts with a keyframe
+    ferris_log_flush();
+  }
+#endif
+}
+
+// Who consumes samples: clients of acceleration, gyro or temperature, the offline log and the broadcast.
+static bool accel_demand(void) {
+  if (acc_channels & ACC_MOTION_CHANNELS) {
+    return true;
+  }
+#if ACC_BROADCAST
+  if (m_conn_handle == BLE_CONN_HANDLE_INVALID) {
+    return true;
+  }
+#endif
+  return ferris_acceleration_wanted(&m_ferris);
+}
+
+/**
+ * @brief Keep the sensor asleep and off the bus unless something consumes samples.
+ *
+ * @details Called whenever a consumer may have come or gone. With demand the sensor runs in
+ *          motion detection and acquisition starts at once, the idle check stops it again if
+ *          the wheel stands still. Without demand not even motion wakes us up.
+ */
+static void accel_demand_update(void) {
+  bool demand = accel_demand();
+  uint32_t err_code;
+
+  if (demand == acc_demand) {
+    return;
+  }
+  if (demand) {
+    err_code = mpu6050_wake_up();
+    if (err_code == NRF_ERROR_NO_MEM) {
+      accel_retry_later();
+      return;
+    }
+    check_error(err_code);
+    acc_demand = true;
+    check_error(app_timer_start(accel_poll_timer_id, APP_TIMER_TICKS(ACC_IDLE_POLL_MS, APP_TIMER_PRESCALER), NULL));
+    // Send an initial sample, and release the INT pin in case it was latched before sleep.
+    accel_activate();
+    accel_int_status_read();
+  } else {
+    accel_deactivate();
+    err_code = mpu6050_enter_sleep();
+    if (err_code == NRF_ERROR_NO_MEM) {
+      accel_retry_later();
+      return;
+    }
+    check_error(err_code);
+    acc_demand = false;
+    check_error(app_timer_stop(accel_poll_timer_id));
+  }
+}
+
+/**
+ * @brief Put the sensor in the mode acc_active asks for.
+ *
+ * @details While acquiring, the subscribed channels are powered and samples are collected in
+ *          the FIFO, which needs continuous mode. While idle only the accelerometer runs, in
+ *          cycle mode for motion detection, at a fraction of the current.
+ */
+static void accel_mode_update(void) {
+  uint32_t err_code = mpu6050_channels_set(acc_active ? acc_channels : MPU6050_CHANNEL_ACCEL);
+#if ACC_FIFO_ENABLED
+  if (err_code == NRF_SUCCESS) {
+    err_code = mpu6050_fifo_enable(acc_active);
+  }
+#else
+  if (err_code == NRF_SUCCESS && acc_int_wired) {
+    err_code = mpu6050_int_enable(acc_active ? (MOT_INT | DATA_RDY_INT) : MOT_INT);
+  }
+#endif
+  acc_mode_pending = (err_code == NRF_ERROR_NO_MEM);
+  if (acc_mode_pending) {
+    accel_retry_later();
+    return;
+  }
+  check_error(err_code);
+}
+
+/**
+ * @brief A sensor write did not fit the bus queue. The configuration is applied again once the
+ *        queue had time to drain, the driver skips the writes which already went through.
+ */
+static void accel_retry_later(void) {
+  if (acc_retry_pending) {
+    return;
+  }
+  acc_retry_pending = true;
+  check_error(app_timer_start(accel_retry_timer_id, APP_TIMER_TICKS(ACC_RETRY_MS, APP_TIMER_PRESCALER), NULL));
+}
+
+static void accel_retry_timeout_handler(void *p_context) {
+  acc_retry_pending = false;
+  if (acc_rate_pending) {
+    accel_rate_apply();
+  }
+  if (acc_mode_pending) {
+    accel_mode_update();
+  }
+  accel_demand_update();
+}
+
+// True if the sample tilted away from where the wheel last moved, which then becomes the new reference.
+static bool accel_moved(uint8_t const *p_sample) {
+  int16_t acc[3];
+  bool moved = false;
+
+  for (int axis = 0; axis < 3; axis++) {
+    acc[axis]  = (int16_t)uint16_big_decode(p_sample + axis * 2);
+    int32_t d  = acc[axis] - acc_still[axis];
+    moved     |= (d > ACC_IDLE_DRIFT || d < -ACC_IDLE_DRIFT);
+  }
+  if (moved) {
+    memcpy(acc_still, acc, sizeof(acc_still));
+  }
+  return moved;
+}
+
+// MOT_INT sees acceleration through a 0.63 Hz high pass and misses a slowly turning wheel,
+// so the tilt of the samples counts as motion too.
+static void accel_idle_check(uint32_t now) {
+  if (acc_int_missed) {
+    accel_int_retry();
+  }
+  if (accel_moved(acc_data)) {
+    acc_motion_tick = now;
+  } else if (now - acc_motion_tick >= ACC_IDLE_TIMEOUT) {
+    accel_deactivate();
+  }
+}
+
+static void accel_poll_handler(uint32_t result, void *p_context) {
+  acc_poll_busy = false;
+  check_error(result);
+  if (acc_demand && !acc_active && accel_moved(acc_poll)) {
+    accel_activate();
+  }
+}
+
+// While idle the tilt is checked now and then, for a wheel that starts turning too slowly for MOT_INT.
+static void accel_poll_timeout_handler(void *p_context) {
+  // LOTOHI sensing sees no further edge while the latched pin stays high
+  if (acc_int_missed || (acc_int_wired && !acc_active && nrf_drv_gpiote_in_is_set(MPU6050_INT_PIN))) {
+    accel_int_retry();
+  }
+  if (acc_active || acc_poll_busy) {
+    return;
+  }
+  uint32_t err_code = mpu6050_read_acceleration_async(acc_poll, accel_poll_handler, NULL);
+  acc_poll_busy     = (err_code == NRF_SUCCESS);
+  if (err_code != NRF_ERROR_NO_MEM) { // try again next period
+    check_error(err_code);
+  }
+}
+
+/**
+ * @brief Apply sample_interval: retune the sensor and restart the acquisition timer.
+ *
+ * @details The sensor runs at the requested interval when it fits SMPLRT_DIV, otherwise at an
+ *          integer fraction of it and only every acc_decimation-th sample is forwarded.
+ */
+static void accel_rate_apply(void) {
+  uint16_t interval = m_ferris.sample_interval;
+
+  interval = MAX(ACC_MIN_SAMPLE_INTERVAL, MIN(interval, ACC_MAX_SAMPLE_INTERVAL));
+  uint16_t decimation = CEIL_DIV(interval, MPU6050_MAX_SAMPLE_PERIOD);
+  uint16_t period     = interval / decimation;
+
+  // Read back what is applied
+  m_ferris.sample_interval = period * decimation;
+
+  uint32_t err_code = mpu6050_set_sample_period(period);
+  acc_rate_pending  = (err_code == NRF_ERROR_NO_MEM);
+  if (acc_rate_pending) {
+    accel_retry_later();
+    return;
+  }
+  check_error(err_code);
+
+  acc_decimation       = decimation;
+  acc_decimation_count = 0;
+  acc_period_ticks     = APP_TIMER_TICKS(period, APP_TIMER_PRESCALER);
+  acc_interval_ticks   = acc_period_ticks * decimation;
+  acc_drain_ticks      = MAX(acc_period_ticks * MIN(ACC_FIFO_DRAIN_SAMPLES, ACC_FIFO_BURST_SAMPLES), APP_TIMER_MIN_TIMEOUT_TICKS);
+
+#if ACC_FIFO_ENABLED
+  if (acc_active) {
+    // samples already in the FIFO were taken at the old rate
+    accel_mode_update();
+    check_error(app_timer_stop(accel_timer_id));
+    check_error(accel_timer_start());
+  }
+#else
+  if (acc_active && !acc_int_wired) {
+    check_error(app_timer_stop(accel_timer_id));
+    check_error(accel_timer_start());
+  }
+#endif
+}
+
+static void accel_rate_sched_handler(void *p_event_data, uint16_t event_size) {
+  accel_rate_apply();
+}
+
+static void ferris_evt_handler(ferris_service_t *p_ferris_service, ferris_evt_t *p_evt) {
+  switch (p_evt->evt_type) {
+  case FERRIS_EVT_SAMPLE_INTERVAL_UPDATED:
+    if (app_sched_event_put(NULL, 0, accel_rate_sched_handler) != NRF_SUCCESS) {
+      acc_rate_pending = true;
+      accel_retry_later();
+    }
+    break;
+
+  case FERRIS_EVT_BULK_STARTED:
+    conn_ctrl_bulk_set(true);
+    break;
+
+  case FERRIS_EVT_BULK_STOPPED:
+    conn_ctrl_bulk_set(false);
+    break;
+
+  case FERRIS_EVT_CHANNELS_UPDATED:
+    acc_channels = MPU6050_CHANNEL_ACCEL;
+    if (p_ferris_service->gyro_notification) {
+      acc_channels |= MPU6050_CHANNEL_GYRO;
+    }
+    if (p_ferris_service->temp_notification) {
+      acc_channels |= MPU6050_CHANNEL_TEMP;
+    }
+    if (acc_active) {
+      accel_mode_update();
+    }
+    accel_demand_update();
+    break;
+
+  case FERRIS_EVT_DEMAND_UPDATED:
+    accel_demand_update();
+    break;
+  }
+}
+
+#if ACC_FIFO_ENABLED
+static void accel_read_handler(uint32_t result, void *p_context) {
+  FERRIS_PROFILE_END(FERRIS_PROFILE_READ);
+  acc_fifo_busy = false;
+  check_error(result);
+  if (acc_fifo_read.overflow) {
+    NRF_LOG_WARNING("MPU6050 FIFO overflow, resynced\r\n");
+  }
+
+  // The newest sample was taken about now, the others one sample period apart before it.
+  uint32_t now = ferris_time_now();
+  bool sampled = false;
+  for (int i = 0; i < acc_fifo_read.count; i++) {
+    if (++acc_decimation_count < acc_decimation) {
+      continue;
+    }
+    acc_decimation_count = 0;
+    memcpy(acc_data, acc_fifo_buffer + i * MPU6050_SAMPLE_SIZE, sizeof(acc_data));
+    FERRIS_PROFILE_BEGIN(FERRIS_PROFILE_SEND);
+    ferris_acceleration_send(&m_ferris, now - (acc_fifo_read.count - 1 - i) * acc_period_ticks);
+    FERRIS_PROFILE_END(FERRIS_PROFILE_SEND);
+    sampled = true;
+  }
+  FERRIS_PROFILE_END(FERRIS_PROFILE_SAMPLE);
+#if ACC_BROADCAST
+  // only the newest sample of a burst would make it on air
+  if (sampled) {
+    broadcast_sample(acc_data);
+  }
+#else
+  (void)sampled;
+#endif
+  accel_idle_check(now);
+}
+
+static void accel_motion_handler(uint32_t result, void *p_context) {
+  acc_motion_busy = false;
+  check_error(result);
+  ferris_motion_send(&m_ferris, acc_motion + MPU6050_MOTION_GYRO_OFFSET, acc_motion + MPU6050_MOTION_TEMP_OFFSET);
+}
+#else
+static void accel_read_handler(uint32_t result, void *p_context);
+
+// One burst for all subscribed channels, acceleration alone otherwise.
+static uint32_t accel_sample_read(void) {
+  uint32_t err_code;
+
+  if (acc_channels & ACC_MOTION_CHANNELS) {
+    err_code = mpu6050_read_motion_async(acc_sample, accel_read_handler, NULL);
+  } else {
+    err_code = mpu6050_read_acceleration_async(acc_sample, accel_read_handler, NULL);
+  }
+  if (err_code == NRF_SUCCESS) {
+    FERRIS_PROFILE_BEGIN(FERRIS_PROFILE_READ);
+    FERRIS_PROFILE_BEGIN(FERRIS_PROFILE_SAMPLE);
+  }
+  return err_code;
+}
+
+static void accel_read_handler(uint32_t result, void *p_context) {
+  FERRIS_PROFILE_END(FERRIS_PROFILE_READ);
+  check_error(result);
+
+  // the sample is as old as the INT edge, not as old as the bus transfers behind it
+  uint32_t elapsed = acc_sample_tick - acc_last_sample_tick;
+  // DATA_RDY follows the cycle mode wake-up, which can be faster than sample_interval
+  if (elapsed + acc_period_ticks / 2 >= acc_interval_ticks) {
+    acc_last_sample_tick = acc_sample_tick;
+    memcpy(acc_data, acc_sample, sizeof(acc_data));
+    FERRIS_PROFILE_BEGIN(FERRIS_PROFILE_SEND);
+    ferris_acceleration_send(&m_ferris, acc_sample_tick);
+    FERRIS_PROFILE_END(FERRIS_PROFILE_SEND);
+    if (acc_channels & ACC_MOTION_CHANNELS) {
+      ferris_motion_send(&m_ferris, acc_sample + MPU6050_MOTION_GYRO_OFFSET, acc_sample + MPU6050_MOTION_TEMP_OFFSET);
+    }
+#if ACC_BROADCAST
+    broadcast_sample(acc_data);
+#endif
+  }
+  FERRIS_PROFILE_END(FERRIS_PROFILE_SAMPLE);
+  accel_idle_check(ferris_time_now());
+}
+#endif
+
+static void accel_int_status_handler(uint32_t result, void *p_context) {
+  check_error(result);
+
+  if (acc_int_status & MOT_INT) {
+    accel_activate();
+  }
+#if !ACC_FIFO_ENABLED
+  if ((acc_int_status & DATA_RDY_INT) && acc_active) {
+    uint32_t err_code = accel_sample_read();
+    if (err_code != NRF_ERROR_NO_MEM) { // skip this sample if the bus is backed up
+      check_error(err_code);
+    }
+  }
+#endif
+}
+
+/**
+ * @brief Read INT_STATUS, which tells motion from data ready and releases the pin.
+ *
+ * @details A read that does not fit the bus queue is retried by the idle checks, the latched
+ *          pin would stay high and never raise another edge otherwise.
+ */
+static void accel_int_status_read(void) {
+  acc_int_missed    = false;
+  uint32_t err_code = mpu6050_int_status_read_async(&acc_int_status, accel_int_status_handler, NULL);
+  if (err_code == NRF_ERROR_NO_MEM) {
+    acc_int_missed = true;
+    return;
+  }
+  check_error(err_code);
+}
+
+static void accel_int_retry(void) {
+#if !ACC_FIFO_ENABLED
+  acc_sample_tick = ferris_time_now(); // the edge time is lost
+#endif
+  accel_int_status_read();
+}
+
+static void mpu6050_int_sched_handler(void *p_event_data, uint16_t event_size) {
+#if !ACC_FIFO_ENABLED
+  acc_sample_tick = *(uint32_t *)p_event_data;
+#endif
+  accel_int_status_read();
+}
+
+// GPIOTE interrupt, the status read is queued from the main loop. The edge is the capture time
+// of a DATA_RDY sample, the main loop may get to it much later.
+static void mpu6050_int_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action) {
+  uint32_t tick = ferris_time_now();
+  if (app_sched_event_put(&tick, sizeof(tick), mpu6050_int_sched_handler) != NRF_SUCCESS) {
+    acc_int_missed = true;
+  }
+}
+
+static void mpu6050_int_init(void) {
+  uint32_t err_code;
+
+  if (!nrf_drv_gpiote_is_init()) {
+    err_code = nrf_drv_gpiote_init();
+    check_error(err_code);
+  }
+
+  nrf_drv_gpiote_in_config_t config = GPIOTE_CONFIG_IN_SENSE_LOTOHI(false);
+  err_code                          = nrf_drv_gpiote_in_init(MPU6050_INT_PIN, &config, mpu6050_int_handler);
+  check_error(err_code);
+
+  nrf_drv_gpiote_in_event_enable(MPU6050_INT_PIN, true);
+}
+
 void accel_timeout_handler(void *p_context) {
 #ifdef DEBUG
   nrf_gpio_pin_toggle(LED_R);
 #endif
 
-  check_error(mpu6050_read_acceleration(acc_data));
+  if (!acc_active) { // a tick queued before the timer was stopped
+    return;
+  }
+#if ACC_FIFO_ENABLED
+  if (acc_fifo_busy) { // previous drain still on the bus
+    return;
+  }
+  uint32_t err_code = mpu6050_fifo_read_async(&acc_fifo_read, accel_read_handler, NULL);
+  acc_fifo_busy     = (err_code == NRF_SUCCESS);
+  if (acc_fifo_busy) {
+    FERRIS_PROFILE_BEGIN(FERRIS_PROFILE_READ);
+    FERRIS_PROFILE_BEGIN(FERRIS_PROFILE_SAMPLE);
+  }
+  if (err_code == NRF_SUCCESS && (acc_channels & ACC_MOTION_CHANNELS) && !acc_motion_busy) {
+    // gyro and temperature once per drain
+    err_code        = mpu6050_read_motion_async(acc_motion, accel_motion_handler, NULL);
+    acc_motion_busy = (err_code == NRF_SUCCESS);
+  }
+#else
+  acc_sample_tick   = ferris_time_now();
+  uint32_t err_code = accel_sample_read();
+#endif
+  if (err_code != NRF_ERROR_NO_MEM) { // skip this tick if the bus is backed up
+    check_error(err_code);
+  }
+}
+/**
+ * @brief Time to the next battery measurement. The cell sags under TX current, so it is watched
+ *        closely while the radio is busy and rarely while the device sits still.
+ */
+static uint32_t battery_period_ticks(void) {
+  uint32_t packets     = m_ferris.tx_stats.packets_sent - battery_last_packets;
+  battery_last_packets = m_ferris.tx_stats.packets_sent;
 
-  ferris_acceleration_send(&m_ferris);
+  if (m_conn_handle != BLE_CONN_HANDLE_INVALID) {
+    if (packets >= BATTERY_BUSY_PACKETS || m_ferris.bulk_active) {
+      return APP_TIMER_TICKS(BATTERY_PERIOD_BUSY_MS, APP_TIMER_PRESCALER);
+    }
+    return APP_TIMER_TICKS(BATTERY_PERIOD_CONNECTED_MS, APP_TIMER_PRESCALER);
+  }
+  if (acc_active) {
+    return APP_TIMER_TICKS(BATTERY_PERIOD_CONNECTED_MS, APP_TIMER_PRESCALER);
+  }
+  return APP_TIMER_TICKS(BATTERY_PERIOD_IDLE_MS, APP_TIMER_PRESCALER);
 }
+
 void battery_timeout_handler(void *p_context) {
+  // keeps counting RTC1 wraps while nothing else asks for the time
+  ferris_time_now();
   if (!nrf_drv_adc_is_busy()) {
     battery_adc_sample();
   }
-  nrf_drv_adc_sample();
+  check_error(app_timer_start(battery_timer_id, battery_period_ticks(), NULL));
+  diagnostics_refresh();
 }
 
 void init_timer() {
   uint32_t err_code;
   err_code = app_timer_create(&accel_timer_id, APP_TIMER_MODE_REPEATED, accel_timeout_handler);
   check_error(err_code);
-  err_code = app_timer_create(&battery_timer_id, APP_TIMER_MODE_REPEATED, battery_timeout_handler);
+  err_code = app_timer_create(&battery_timer_id, APP_TIMER_MODE_SINGLE_SHOT, battery_timeout_handler);
+  check_error(err_code);
+  err_code = app_timer_create(&conn_ctrl_timer_id, APP_TIMER_MODE_REPEATED, conn_ctrl_timeout_handler);
+  check_error(err_code);
+  err_code = app_timer_create(&accel_poll_timer_id, APP_TIMER_MODE_REPEATED, accel_poll_timeout_handler);
+  check_error(err_code);
+  err_code = app_timer_create(&accel_retry_timer_id, APP_TIMER_MODE_SINGLE_SHOT, accel_retry_timeout_handler);
   check_error(err_code);
 }
 
 uint32_t accel_timer_start(void) {
-  return app_timer_start(accel_timer_id, APP_TIMER_TICKS(200, 0), NULL);
+#if ACC_FIFO_ENABLED
+  return app_timer_start(accel_timer_id, acc_drain_ticks, NULL);
+#else
+  return app_timer_start(accel_timer_id, acc_interval_ticks, NULL); // INT pin not wired, sample on time
+#endif
 }
 
 uint32_t battery_timer_start(void) {
-  return app_timer_start(battery_timer_id, APP_TIMER_TICKS(2000, 0), NULL);
+  return app_timer_start(battery_timer_id, battery_period_ticks(), NULL);
 }
 
 int main(void) {
@@ -543,15 +1403,21 @@ int main(void) {
   }
 
   // enable adc
-  battery_adc_channel.config.config.resolution = NRF_ADC_CONFIG_RES_10BIT;
-  battery_adc_channel.config.config.input      = NRF_ADC_CONFIG_SCALING_SUPPLY_ONE_THIRD;
-  battery_adc_channel.config.config.reference  = NRF_ADC_CONFIG_REF_VBG;
+  for (int i = 0; i < BATTERY_BURST_SIZE; i++) {
+    nrf_drv_adc_channel_t channel = NRF_DRV_ADC_DEFAULT_CHANNEL(NRF_ADC_CONFIG_INPUT_DISABLED);
+    channel.config.config.resolution = NRF_ADC_CONFIG_RES_10BIT;
+    channel.config.config.input      = NRF_ADC_CONFIG_SCALING_SUPPLY_ONE_THIRD;
+    channel.config.config.reference  = NRF_ADC_CONFIG_REF_VBG;
+    battery_adc_channels[i]          = channel;
+  }
   adc_config();
 
   err_code = NRF_LOG_INIT(NULL);
   check_error(err_code);
 
-  APP_TIMER_INIT(APP_TIMER_PRESCALER, APP_TIMER_OP_QUEUE_SIZE, false);
+  APP_SCHED_INIT(SCHED_MAX_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
+  APP_TIMER_INIT(APP_TIMER_PRESCALER, APP_TIMER_OP_QUEUE_SIZE, true);
+  ferris_energy_init();
 
   // Initialize SoftDevice.
   ble_stack_init();
@@ -572,7 +1438,7 @@ int main(void) {
   check_error(err_code);
 
   // Battery ADC
-  nrf_drv_adc_sample_convert(&battery_adc_channel, &battery_raw);
+  nrf_drv_adc_sample_convert(&battery_adc_channels[0], &battery_raw);
   update_battery(battery_raw);
 
   // init twi
@@ -583,15 +1449,32 @@ int main(void) {
   while (!mpu6050_init(&m_twi, mpu6050_device_address)) {
     nrf_gpio_pin_toggle(LED_G);
   }
-  mpu6050_enter_sleep();
+  accel_rate_apply();
+  err_code = mpu6050_motion_detect_config(ACC_MOTION_THRESHOLD, ACC_MOTION_DURATION);
+  check_error(err_code);
+  acc_int_wired = mpu6050_int_pin_check(MPU6050_INT_PIN);
+  if (!acc_int_wired) {
+    NRF_LOG_ERROR("MPU6050 INT not on pin %d, polling for motion\r\n", MPU6050_INT_PIN);
+  }
+  err_code = mpu6050_int_enable(MOT_INT);
+  check_error(err_code);
 
   err_code = mpu6050_read_acceleration(acc_data);
   check_error(err_code);
+  // asleep until accel_demand_update() finds a consumer
+  err_code = mpu6050_enter_sleep();
+  check_error(err_code);
 
-  // init timer
+  // init timer, the accel timer is started on motion
   init_timer();
-  err_code = accel_timer_start();
+#if FERRIS_PROFILE_ENABLED
+  err_code = ferris_profile_init();
   check_error(err_code);
+#endif
+  if (acc_int_wired) {
+    mpu6050_int_init();
+  }
+  accel_demand_update();
 
   err_code = battery_timer_start();
   check_error(err_code);
@@ -603,6 +1486,9 @@ int main(void) {
 
   while (true) {
     app_sched_execute();
-    power_manage();
+    // completions which found the scheduler full go in now that it is empty, no sleeping on them
+    if (!mpu6050_sched_flush()) {
+      power_manage();
+    }
   }
 }
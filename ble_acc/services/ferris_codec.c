@@ -0,0 +1,206 @@
+#include <string.h>
+
+#include "ferris_codec.h"
+
+#define WIDTH_BITS 5 // bit width fields, 0 to 16
+
+typedef struct {
+  uint8_t *p_buf;
+  uint32_t pos; // in bits
+} bit_writer_t;
+
+typedef struct {
+  uint8_t const *p_buf;
+  uint32_t pos; // in bits
+  uint32_t end; // in bits
+} bit_reader_t;
+
+static void bits_put(bit_writer_t *p_bw, uint16_t value, uint8_t width) {
+  while (width--) {
+    if ((value >> width) & 1) {
+      p_bw->p_buf[p_bw->pos >> 3] |= 0x80 >> (p_bw->pos & 7);
+    }
+    p_bw->pos++;
+  }
+}
+
+static bool bits_get(bit_reader_t *p_br, uint8_t width, uint16_t *p_value) {
+  if (p_br->pos + width > p_br->end) {
+    return false;
+  }
+  uint16_t value = 0;
+  while (width--) {
+    value = (value << 1) | ((p_br->p_buf[p_br->pos >> 3] >> (7 - (p_br->pos & 7))) & 1);
+    p_br->pos++;
+  }
+  *p_value = value;
+  return true;
+}
+
+static uint8_t bit_width(uint16_t value) {
+  uint8_t width = 0;
+  while (value) {
+    width++;
+    value >>= 1;
+  }
+  return width;
+}
+
+static uint16_t zigzag(int16_t delta) {
+  return (uint16_t)(((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15));
+}
+
+static int16_t unzigzag(uint16_t value) {
+  return (int16_t)((value >> 1) ^ (uint16_t)(-(int16_t)(value & 1)));
+}
+
+static void key_encode(ferris_codec_sample_t const *p_sample, uint8_t *p_out) {
+  p_out[0] = (uint8_t)(p_sample->timestamp);
+  p_out[1] = (uint8_t)(p_sample->timestamp >> 8);
+  for (int i = 0; i < 3; i++) {
+    p_out[2 + i * 2] = (uint8_t)((uint16_t)p_sample->acc[i] >> 8);
+    p_out[3 + i * 2] = (uint8_t)(p_sample->acc[i]);
+  }
+}
+
+static void key_decode(uint8_t const *p_in, ferris_codec_sample_t *p_sample) {
+  p_sample->timestamp = (uint16_t)(p_in[0] | (p_in[1] << 8));
+  for (int i = 0; i < 3; i++) {
+    p_sample->acc[i] = (int16_t)((p_in[2 + i * 2] << 8) | p_in[3 + i * 2]);
+  }
+}
+
+void ferris_codec_encoder_reset(ferris_codec_encoder_t *p_enc) {
+  p_enc->need_key          = true;
+  p_enc->packets_since_key = 0;
+}
+
+uint8_t ferris_codec_encode(ferris_codec_encoder_t const *p_enc, ferris_codec_sample_t const *p_samples, uint8_t count,
+                            uint8_t *p_out, uint16_t max_len, uint16_t *p_len, bool *p_full) {
+  bool key = p_enc->need_key || p_enc->packets_since_key >= FERRIS_CODEC_KEYFRAME_INTERVAL - 1;
+  ferris_codec_sample_t prev = p_enc->last;
+  bit_writer_t bw;
+  uint8_t n = 0;
+
+  *p_len  = 0;
+  *p_full = false;
+  if (count == 0 || max_len < FERRIS_CODEC_HEADER_SIZE + FERRIS_CODEC_KEY_SIZE) {
+    return 0;
+  }
+
+  memset(p_out, 0, max_len);
+  p_out[0] = (key ? FERRIS_CODEC_KEY_FLAG : 0) | (p_enc->seq & FERRIS_CODEC_SEQ_MASK);
+  bw.p_buf = p_out;
+  bw.pos   = FERRIS_CODEC_HEADER_SIZE * 8;
+
+  if (key) {
+    key_encode(&p_samples[0], p_out + FERRIS_CODEC_HEADER_SIZE);
+    bw.pos += FERRIS_CODEC_KEY_SIZE * 8;
+    prev = p_samples[0];
+    n    = 1;
+  }
+
+  for (; n < count; n++) {
+    ferris_codec_sample_t const *p_sample = &p_samples[n];
+    uint16_t dt                           = (uint16_t)(p_sample->timestamp - prev.timestamp);
+    uint16_t z[3];
+    uint8_t wt = bit_width(dt);
+    uint8_t wa = 0;
+
+    for (int i = 0; i < 3; i++) {
+      z[i] = zigzag((int16_t)(uint16_t)(p_sample->acc[i] - prev.acc[i]));
+      if (bit_width(z[i]) > wa) {
+        wa = bit_width(z[i]);
+      }
+    }
+
+    if (n == UINT8_MAX || bw.pos + WIDTH_BITS + wt + WIDTH_BITS + 3 * wa > (uint32_t)max_len * 8) {
+      *p_full = true;
+      break;
+    }
+
+    bits_put(&bw, wt, WIDTH_BITS);
+    bits_put(&bw, dt, wt);
+    bits_put(&bw, wa, WIDTH_BITS);
+    for (int i = 0; i < 3; i++) {
+      bits_put(&bw, z[i], wa);
+    }
+    prev = *p_sample;
+  }
+
+  p_out[1] = n;
+  *p_len   = (bw.pos + 7) / 8;
+  return n;
+}
+
+void ferris_codec_encoder_commit(ferris_codec_encoder_t *p_enc, ferris_codec_sample_t const *p_last) {
+  if (p_enc->need_key || p_enc->packets_since_key >= FERRIS_CODEC_KEYFRAME_INTERVAL - 1) {
+    p_enc->need_key          = false;
+    p_enc->packets_since_key = 0;
+  } else {
+    p_enc->packets_since_key++;
+  }
+  p_enc->seq  = (p_enc->seq + 1) & FERRIS_CODEC_SEQ_MASK;
+  p_enc->last = *p_last;
+}
+
+void ferris_codec_decoder_reset(ferris_codec_decoder_t *p_dec) {
+  memset(p_dec, 0, sizeof(*p_dec));
+}
+
+int ferris_codec_decode(ferris_codec_decoder_t *p_dec, uint8_t const *p_in, uint16_t len,
+                        ferris_codec_sample_t *p_out, uint8_t max_samples) {
+  if (len < FERRIS_CODEC_HEADER_SIZE) {
+    p_dec->synced = false;
+    return -1;
+  }
+
+  bool key      = (p_in[0] & FERRIS_CODEC_KEY_FLAG) != 0;
+  uint8_t seq   = p_in[0] & FERRIS_CODEC_SEQ_MASK;
+  uint8_t count = p_in[1];
+
+  if (!key && (!p_dec->synced || seq != p_dec->expected_seq)) {
+    // lost packet, wait for the next keyframe
+    p_dec->synced = false;
+    return -1;
+  }
+  if (count > max_samples || (key && (count == 0 || len < FERRIS_CODEC_HEADER_SIZE + FERRIS_CODEC_KEY_SIZE))) {
+    p_dec->synced = false;
+    return -1;
+  }
+
+  ferris_codec_sample_t prev = p_dec->last;
+  bit_reader_t br            = {.p_buf = p_in, .pos = FERRIS_CODEC_HEADER_SIZE * 8, .end = (uint32_t)len * 8};
+  uint8_t n                  = 0;
+
+  if (key) {
+    key_decode(p_in + FERRIS_CODEC_HEADER_SIZE, &prev);
+    p_out[0] = prev;
+    br.pos += FERRIS_CODEC_KEY_SIZE * 8;
+    n = 1;
+  }
+
+  for (; n < count; n++) {
+    uint16_t wt, dt, wa, z;
+
+    if (!bits_get(&br, WIDTH_BITS, &wt) || wt > 16 || !bits_get(&br, wt, &dt) ||
+        !bits_get(&br, WIDTH_BITS, &wa) || wa > 16) {
+      p_dec->synced = false;
+      return -1;
+    }
+    prev.timestamp += dt;
+    for (int i = 0; i < 3; i++) {
+      if (!bits_get(&br, wa, &z)) {
+        p_dec->synced = false;
+        return -1;
+      }
+      prev.acc[i] = (int16_t)(uint16_t)(prev.acc[i] + unzigzag(z));
+    }
+    p_out[n] = prev;
+  }
+
+  p_dec->last         = prev;
+  p_dec->synced       = true;
+  p_dec->expected_seq = (seq + 1) & FERRIS_CODEC_SEQ_MASK;
+  return n;
+}
@@ -0,0 +1,96 @@
+#ifndef FERRIS_CODEC_H
+#define FERRIS_CODEC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @file
+ * @brief Delta codec for the acceleration stream.
+ *
+ * Packet layout:
+ *   byte 0    {KEY:1, SEQ:7}, KEY set on keyframes, SEQ counts packets mod 128.
+ *   byte 1    number of samples in the packet.
+ *   keyframe  first sample verbatim: {T_L, T_H, X_H, X_L, Y_H, Y_L, Z_H, Z_L}.
+ *   then      delta samples, bit packed MSB first:
+ *             {WT:5, dT:WT, WA:5, zigzag(dX):WA, zigzag(dY):WA, zigzag(dZ):WA}
+ *
+ * Deltas are taken mod 2^16 against the previous sample, which for the first sample of a
+ * delta packet is the last sample of the previous packet. A decoder that sees a SEQ gap
+ * drops packets until the next keyframe.
+ *
+ * The codec does not depend on the SDK, so the decoder can be built on the host, host/ferris_decoder.hpp
+ * wraps it for clients.
+ */
+
+#define FERRIS_CODEC_HEADER_SIZE 2
+#define FERRIS_CODEC_KEY_SIZE 8
+#define FERRIS_CODEC_KEY_FLAG 0x80
+#define FERRIS_CODEC_SEQ_MASK 0x7F
+#define FERRIS_CODEC_KEYFRAME_INTERVAL 16 /**< A keyframe is sent at least every this many packets. */
+
+typedef struct {
+  uint16_t timestamp; /**< Capture time in 1/1024 s. */
+  int16_t acc[3];
+} ferris_codec_sample_t;
+
+typedef struct {
+  uint8_t seq;               /**< SEQ of the next packet. */
+  uint8_t packets_since_key; /**< Delta packets sent since the last keyframe. */
+  bool need_key;             /**< Next packet must be a keyframe. */
+  ferris_codec_sample_t last; /**< Last sample sent. */
+} ferris_codec_encoder_t;
+
+typedef struct {
+  uint8_t expected_seq;
+  bool synced;                /**< A keyframe was seen and no packet was lost since. */
+  ferris_codec_sample_t last;
+} ferris_codec_decoder_t;
+
+/**
+ * @brief Make the next packet a keyframe. Call when a client subscribes.
+ */
+void ferris_codec_encoder_reset(ferris_codec_encoder_t *p_enc);
+
+/**
+ * @brief Encode as many samples as fit into one packet. Does not change the encoder state.
+ *
+ * @param[in]  p_enc     Encoder.
+ * @param[in]  p_samples Samples, oldest first.
+ * @param[in]  count     Number of samples.
+ * @param[out] p_out     Packet buffer.
+ * @param[in]  max_len   Size of p_out, at least FERRIS_CODEC_HEADER_SIZE + FERRIS_CODEC_KEY_SIZE.
+ * @param[out] p_len     Packet length.
+ * @param[out] p_full    Set when the packet has no room for another sample.
+ *
+ * @return Number of samples encoded.
+ */
+uint8_t ferris_codec_encode(ferris_codec_encoder_t const *p_enc, ferris_codec_sample_t const *p_samples, uint8_t count,
+                            uint8_t *p_out, uint16_t max_len, uint16_t *p_len, bool *p_full);
+
+/**
+ * @brief Advance the encoder after the packet from ferris_codec_encode() was sent.
+ *
+ * @param[in] p_last Last sample in the sent packet.
+ */
+void ferris_codec_encoder_commit(ferris_codec_encoder_t *p_enc, ferris_codec_sample_t const *p_last);
+
+void ferris_codec_decoder_reset(ferris_codec_decoder_t *p_dec);
+
+/**
+ * @brief Decode one packet.
+ *
+ * @return Number of samples written to p_out, or -1 if the packet was dropped because the
+ *         decoder is waiting for a keyframe or the packet is malformed.
+ */
+int ferris_codec_decode(ferris_codec_decoder_t *p_dec, uint8_t const *p_in, uint16_t len,
+                        ferris_codec_sample_t *p_out, uint8_t max_samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,113 @@
+#include "ferris_energy.h"
+#include "ferris_time.h"
+
+#define TICKS_PER_SECOND_SHIFT 15 // FERRIS_TIME_TICKS_PER_SECOND is 2^15
+#define NC_PER_UAH 3600000ULL
+
+typedef enum {
+  DOMAIN_CPU,
+  DOMAIN_RADIO,
+  DOMAIN_SENSOR,
+  DOMAIN_COUNT,
+} domain_t;
+
+static const uint8_t state_domain[FERRIS_ENERGY_STATE_COUNT] = {
+    DOMAIN_CPU, DOMAIN_CPU,
+    DOMAIN_RADIO, DOMAIN_RADIO, DOMAIN_RADIO,
+    DOMAIN_SENSOR, DOMAIN_SENSOR, DOMAIN_SENSOR, DOMAIN_SENSOR};
+
+// Average current in each state, uA. Radio states exclude the packets, see counter_charge_nc.
+static const uint16_t state_current_ua[FERRIS_ENERGY_STATE_COUNT] = {
+    2600, // CPU running from flash, DC/DC on
+    4,    // System ON, RTC1 running, RAM retained
+    0,    // radio off
+    60,   // advertising at the slow interval, three channels per event
+    25,   // empty connection events at the default parameters
+    5,    // MPU6050 sleep
+    70,   // accelerometer low power mode, 20 Hz wake-ups
+    500,  // accelerometer continuous
+    3800, // accelerometer and gyroscope
+};
+
+// Charge of one event, nC.
+static const uint16_t counter_charge_nc[FERRIS_ENERGY_COUNTER_COUNT] = {
+    50,   // HFCLK start and SoftDevice entry after a wake-up
+    20,   // TWI start, address and stop
+    10,   // one byte at 400 kHz with the TWI peripheral on
+    3000, // a notification on air, TX at 0 dBm and the RX of the acknowledgement
+    500,  // 8 conversions with the bandgap on
+    0,    // counted in the TWI transactions already
+};
+
+static struct {
+  uint8_t state;
+  uint32_t since; // ferris_time_now() of the last change
+} m_domains[DOMAIN_COUNT];
+
+static uint32_t m_seconds[FERRIS_ENERGY_STATE_COUNT];
+static uint16_t m_ticks[FERRIS_ENERGY_STATE_COUNT]; // below one second
+static uint32_t m_counters[FERRIS_ENERGY_COUNTER_COUNT];
+
+static void state_close(domain_t domain, uint32_t now) {
+  uint8_t state    = m_domains[domain].state;
+  uint32_t elapsed = now - m_domains[domain].since + m_ticks[state];
+
+  m_seconds[state] += elapsed >> TICKS_PER_SECOND_SHIFT;
+  m_ticks[state]          = elapsed & (FERRIS_TIME_TICKS_PER_SECOND - 1);
+  m_domains[domain].since = now;
+}
+
+void ferris_energy_init(void) {
+  uint32_t now = ferris_time_now();
+
+  for (int i = 0; i < FERRIS_ENERGY_STATE_COUNT; i++) {
+    m_seconds[i] = 0;
+    m_ticks[i]   = 0;
+  }
+  for (int i = 0; i < FERRIS_ENERGY_COUNTER_COUNT; i++) {
+    m_counters[i] = 0;
+  }
+  m_domains[DOMAIN_CPU].state    = FERRIS_ENERGY_CPU_RUN;
+  m_domains[DOMAIN_RADIO].state  = FERRIS_ENERGY_RADIO_IDLE;
+  m_domains[DOMAIN_SENSOR].state = FERRIS_ENERGY_SENSOR_SLEEP;
+  for (int i = 0; i < DOMAIN_COUNT; i++) {
+    m_domains[i].since = now;
+  }
+}
+
+void ferris_energy_state_set(ferris_energy_state_t state) {
+  domain_t domain = (domain_t)state_domain[state];
+
+  if (m_domains[domain].state == state) {
+    return;
+  }
+  state_close(domain, ferris_time_now());
+  m_domains[domain].state = state;
+}
+
+void ferris_energy_count(ferris_energy_counter_t counter, uint32_t n) {
+  m_counters[counter] += n;
+}
+
+void ferris_energy_counter_set(ferris_energy_counter_t counter, uint32_t value) {
+  m_counters[counter] = value;
+}
+
+void ferris_energy_snapshot(ferris_energy_t *p_energy) {
+  uint32_t now    = ferris_time_now();
+  uint64_t charge = 0; // nC, 1 uA for 1 ms is 1 nC
+
+  for (int i = 0; i < DOMAIN_COUNT; i++) {
+    state_close((domain_t)i, now);
+  }
+  for (int i = 0; i < FERRIS_ENERGY_STATE_COUNT; i++) {
+    // 1000 / 32768 == 125 / 4096
+    p_energy->state_ms[i] = m_seconds[i] * 1000 + (((uint32_t)m_ticks[i] * 125) >> 12);
+    charge += (uint64_t)p_energy->state_ms[i] * state_current_ua[i];
+  }
+  for (int i = 0; i < FERRIS_ENERGY_COUNTER_COUNT; i++) {
+    p_energy->counters[i] = m_counters[i];
+    charge += (uint64_t)m_counters[i] * counter_charge_nc[i];
+  }
+  p_energy->charge_uah = (uint32_t)(charge / NC_PER_UAH);
+}
@@ -0,0 +1,81 @@
+#ifndef FERRIS_ENERGY_H
+#define FERRIS_ENERGY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @file
+ * @brief Where the charge goes: time spent in each power state and counts of the costly events.
+ *
+ * Each domain (CPU, radio, sensor) is in exactly one state at a time. The application reports
+ * state changes with ferris_energy_state_set(), the time in between is measured with
+ * ferris_time_now(). Interrupts taken while the CPU sleeps are counted as sleep.
+ *
+ * The charge estimate multiplies every state time and event count by a figure from the
+ * nRF51422 and MPU6050 datasheets. It is meant to compare firmware builds on the same board,
+ * not to predict the life of a particular cell.
+ */
+
+typedef enum {
+  FERRIS_ENERGY_CPU_RUN,
+  FERRIS_ENERGY_CPU_SLEEP, /**< In sd_app_evt_wait(). */
+  FERRIS_ENERGY_RADIO_IDLE,
+  FERRIS_ENERGY_RADIO_ADVERTISING,
+  FERRIS_ENERGY_RADIO_CONNECTED,
+  FERRIS_ENERGY_SENSOR_SLEEP, /**< The sensor states follow the order of mpu6050_power_t. */
+  FERRIS_ENERGY_SENSOR_CYCLE,
+  FERRIS_ENERGY_SENSOR_ACCEL,
+  FERRIS_ENERGY_SENSOR_GYRO,
+  FERRIS_ENERGY_STATE_COUNT,
+} ferris_energy_state_t;
+
+typedef enum {
+  FERRIS_ENERGY_WAKEUPS,          /**< Returns from sd_app_evt_wait(). */
+  FERRIS_ENERGY_TWI_TRANSACTIONS, /**< Sensor bus transactions. */
+  FERRIS_ENERGY_TWI_BYTES,        /**< Sensor bus bytes, register addresses included. */
+  FERRIS_ENERGY_HVX,              /**< Notifications accepted by the SoftDevice. */
+  FERRIS_ENERGY_ADC_BURSTS,       /**< Battery measurements. */
+  FERRIS_ENERGY_TWI_ASLEEP_READS, /**< Sensor reads while the sensor sleeps, 0 unless acquisition gating is broken. */
+  FERRIS_ENERGY_COUNTER_COUNT,
+} ferris_energy_counter_t;
+
+/**@brief Diagnostics, readable by the client as they are laid out here (little endian). */
+typedef struct {
+  uint32_t state_ms[FERRIS_ENERGY_STATE_COUNT];  /**< Time in each state since boot, by ferris_energy_state_t, wraps after 49 days. */
+  uint32_t counters[FERRIS_ENERGY_COUNTER_COUNT]; /**< Events since boot, by ferris_energy_counter_t. */
+  uint32_t charge_uah;                            /**< Estimated charge drawn since boot. */
+} ferris_energy_t;
+
+/**
+ * @brief Start accounting, every domain in its first state. Call once the app_timer runs.
+ */
+void ferris_energy_init(void);
+
+/**
+ * @brief Enter a state, the time since the last change of its domain goes to the old state.
+ */
+void ferris_energy_state_set(ferris_energy_state_t state);
+
+/**
+ * @brief Add events.
+ */
+void ferris_energy_count(ferris_energy_counter_t counter, uint32_t n);
+
+/**
+ * @brief Set a counter kept by another module.
+ */
+void ferris_energy_counter_set(ferris_energy_counter_t counter, uint32_t value);
+
+/**
+ * @brief Close the intervals of all domains and fill p_energy, charge estimate included.
+ */
+void ferris_energy_snapshot(ferris_energy_t *p_energy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
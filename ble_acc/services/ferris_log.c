@@ -0,0 +1,304 @@
+#include <string.h>
+
+#include "app_util.h"
+#include "fstorage.h"
+#include "nrf_error.h"
+#include "ferris_log.h"
+
+#define LOG_PAGE_HEADER_SIZE 4
+#define LOG_ERASED_LEN 0xFF
+
+typedef enum {
+  LOG_OP_ERASE = 1,
+  LOG_OP_HEADER,
+  LOG_OP_RECORD,
+} log_op_t;
+
+// One record as written to flash, fstorage writes whole words.
+typedef union {
+  struct {
+    uint8_t len;
+    uint8_t type;
+    uint8_t data[FERRIS_LOG_RECORD_MAX];
+  } r;
+  uint32_t words[CEIL_DIV(2 + FERRIS_LOG_RECORD_MAX, 4)];
+} log_record_t;
+
+static void fs_evt_handler(fs_evt_t const *const evt, fs_ret_t result);
+
+FS_REGISTER_CFG(fs_config_t ferris_log_fs_config) = {
+    .callback  = fs_evt_handler,
+    .num_pages = FERRIS_LOG_PAGES,
+    .priority  = 0xFE,
+};
+
+static uint32_t m_head_seq;     // page being written, 0 before the first page
+static uint16_t m_write_offset; // bytes written to the head page
+static uint32_t m_tail_seq;     // oldest page still in flash
+static uint32_t m_checkpoint;
+static uint32_t m_page_header; // fstorage source of the page header being written
+static bool m_busy;            // a flash operation is in progress
+static uint32_t m_dropped;     // records lost because the queue was full
+
+static log_record_t m_queue[FERRIS_LOG_QUEUE_SIZE];
+static uint8_t m_queue_head;
+static uint8_t m_queue_count;
+
+static ferris_codec_encoder_t m_enc;
+static ferris_codec_sample_t m_pending[FERRIS_LOG_PENDING_SIZE];
+static uint8_t m_pending_count;
+
+static uint32_t const *page_addr(uint32_t seq) {
+  return ferris_log_fs_config.p_start_addr + (seq % FERRIS_LOG_PAGES) * FS_PAGE_SIZE_WORDS;
+}
+
+static bool page_is_erased(uint32_t const *p_page) {
+  for (int i = 0; i < FS_PAGE_SIZE_WORDS; i++) {
+    if (p_page[i] != 0xFFFFFFFF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static uint16_t record_size(uint8_t len) {
+  return CEIL_DIV(2 + len, 4) * 4;
+}
+
+// Start the next flash operation, one at a time.
+static void log_process(void) {
+  fs_ret_t ret;
+
+  if (m_busy || m_queue_count == 0) {
+    return;
+  }
+
+  log_record_t *p_rec = &m_queue[m_queue_head];
+  uint16_t size       = record_size(p_rec->r.len);
+
+  if (m_head_seq == 0 || m_write_offset + size > FS_PAGE_SIZE) {
+    // move on to the next page, erasing the oldest one once the ring is full
+    uint32_t seq           = m_head_seq + 1;
+    uint32_t const *p_page = page_addr(seq);
+    if (!page_is_erased(p_page)) {
+      ret = fs_erase(&ferris_log_fs_config, p_page, 1, (void *)LOG_OP_ERASE);
+    } else {
+      m_page_header = seq;
+      ret           = fs_store(&ferris_log_fs_config, p_page, &m_page_header, 1, (void *)LOG_OP_HEADER);
+    }
+  } else {
+    ret = fs_store(&ferris_log_fs_config, page_addr(m_head_seq) + m_write_offset / 4,
+                   p_rec->words, size / 4, (void *)LOG_OP_RECORD);
+  }
+  // on FS_ERR_QUEUE_FULL the next record or completion tries again
+  m_busy = (ret == FS_SUCCESS);
+}
+
+static void fs_evt_handler(fs_evt_t const *const evt, fs_ret_t result) {
+  m_busy = false;
+
+  switch ((log_op_t)(uintptr_t)evt->p_context) {
+  case LOG_OP_ERASE:
+    // the erased page held head + 1 - FERRIS_LOG_PAGES
+    if (result == FS_SUCCESS && m_head_seq + 1 > FERRIS_LOG_PAGES && m_head_seq + 1 - FERRIS_LOG_PAGES >= m_tail_seq) {
+      m_tail_seq = m_head_seq + 2 - FERRIS_LOG_PAGES;
+    }
+    break;
+
+  case LOG_OP_HEADER:
+    if (result == FS_SUCCESS) {
+      m_head_seq     = m_page_header;
+      m_write_offset = LOG_PAGE_HEADER_SIZE;
+    }
+    break;
+
+  case LOG_OP_RECORD:
+    if (result == FS_SUCCESS) {
+      m_write_offset += record_size(m_queue[m_queue_head].r.len);
+    } else {
+      m_dropped++;
+    }
+    m_queue_head = (m_queue_head + 1) % FERRIS_LOG_QUEUE_SIZE;
+    m_queue_count--;
+    break;
+  }
+
+  log_process();
+}
+
+static log_record_t *queue_alloc(void) {
+  if (m_queue_count == FERRIS_LOG_QUEUE_SIZE) {
+    m_dropped++;
+    return NULL;
+  }
+  log_record_t *p_rec = &m_queue[(m_queue_head + m_queue_count) % FERRIS_LOG_QUEUE_SIZE];
+  memset(p_rec, 0xFF, sizeof(*p_rec));
+  return p_rec;
+}
+
+static void queue_commit(void) {
+  m_queue_count++;
+  log_process();
+}
+
+// Scan one page. Returns the offset after its last record.
+static uint16_t page_scan(uint32_t seq) {
+  uint8_t const *p_page = (uint8_t const *)page_addr(seq);
+  uint16_t offset       = LOG_PAGE_HEADER_SIZE;
+
+  while (offset + 2 <= FS_PAGE_SIZE && p_page[offset] != LOG_ERASED_LEN) {
+    uint8_t len = p_page[offset];
+    if (len > FERRIS_LOG_RECORD_MAX) {
+      // corrupted, never write behind it
+      return FS_PAGE_SIZE;
+    }
+    if (p_page[offset + 1] == FERRIS_LOG_REC_CHECKPOINT && len == 4) {
+      m_checkpoint = MAX(m_checkpoint, uint32_decode(p_page + offset + 2));
+    }
+    offset += record_size(len);
+  }
+  return offset;
+}
+
+uint32_t ferris_log_init(void) {
+  if (fs_init() != FS_SUCCESS) {
+    return NRF_ERROR_INTERNAL;
+  }
+
+  m_head_seq = 0;
+  for (uint32_t i = 0; i < FERRIS_LOG_PAGES; i++) {
+    uint32_t seq = ferris_log_fs_config.p_start_addr[i * FS_PAGE_SIZE_WORDS];
+    if (seq != 0xFFFFFFFF && seq > m_head_seq) {
+      m_head_seq = seq;
+    }
+  }
+
+  m_tail_seq     = m_head_seq + 1;
+  m_write_offset = FS_PAGE_SIZE;
+  m_checkpoint   = 0;
+  for (uint32_t seq = (m_head_seq > FERRIS_LOG_PAGES ? m_head_seq - FERRIS_LOG_PAGES + 1 : 1); seq <= m_head_seq; seq++) {
+    if (page_addr(seq)[0] != seq) {
+      continue;
+    }
+    if (seq < m_tail_seq) {
+      m_tail_seq = seq;
+    }
+    uint16_t offset = page_scan(seq);
+    if (seq == m_head_seq) {
+      m_write_offset = offset;
+    }
+  }
+
+  m_busy          = false;
+  m_queue_head    = 0;
+  m_queue_count   = 0;
+  m_pending_count = 0;
+  memset(&m_enc, 0, sizeof(m_enc));
+  ferris_codec_encoder_reset(&m_enc);
+  return NRF_SUCCESS;
+}
+
+// Move pending samples into records. Without force only full records are written.
+static uint32_t log_encode(bool force) {
+  uint32_t err_code = NRF_SUCCESS;
+
+  while (m_pending_count > 0) {
+    uint8_t data[FERRIS_LOG_RECORD_MAX];
+    uint16_t len;
+    bool full;
+
+    uint8_t n = ferris_codec_encode(&m_enc, m_pending, m_pending_count, data, sizeof(data), &len, &full);
+    if (n == 0 || (!full && !force && m_pending_count < FERRIS_LOG_PENDING_SIZE)) {
+      break;
+    }
+
+    // A dropped record still advances the encoder, the SEQ gap makes the decoder wait for a keyframe.
+    log_record_t *p_rec = queue_alloc();
+    if (p_rec != NULL) {
+      p_rec->r.len  = len;
+      p_rec->r.type = FERRIS_LOG_REC_DATA;
+      memcpy(p_rec->r.data, data, len);
+      queue_commit();
+    } else {
+      err_code = NRF_ERROR_NO_MEM;
+    }
+    ferris_codec_encoder_commit(&m_enc, &m_pending[n - 1]);
+    m_pending_count -= n;
+    memmove(m_pending, m_pending + n, m_pending_count * sizeof(m_pending[0]));
+  }
+  return err_code;
+}
+
+uint32_t ferris_log_append(ferris_codec_sample_t const *p_sample) {
+  m_pending[m_pending_count++] = *p_sample;
+  return log_encode(false);
+}
+
+uint32_t ferris_log_flush(void) {
+  uint32_t err_code = log_encode(true);
+  ferris_codec_encoder_reset(&m_enc);
+  return err_code;
+}
+
+bool ferris_log_read(uint32_t pos, ferris_log_entry_t *p_entry) {
+  pos = MAX(pos, ferris_log_begin());
+
+  while (true) {
+    uint32_t seq    = pos / FS_PAGE_SIZE;
+    uint16_t offset = pos % FS_PAGE_SIZE;
+
+    if (offset < LOG_PAGE_HEADER_SIZE) {
+      offset = LOG_PAGE_HEADER_SIZE;
+      pos    = seq * FS_PAGE_SIZE + offset;
+    }
+    if (seq > m_head_seq || (seq == m_head_seq && offset >= m_write_offset)) {
+      return false;
+    }
+
+    uint32_t const *p_page = page_addr(seq);
+    uint8_t const *p_rec   = (uint8_t const *)p_page + offset;
+    if (p_page[0] != seq || offset + 2 > FS_PAGE_SIZE || p_rec[0] > FERRIS_LOG_RECORD_MAX) {
+      // end of this page
+      pos = (seq + 1) * FS_PAGE_SIZE + LOG_PAGE_HEADER_SIZE;
+      continue;
+    }
+
+    uint32_t next = pos + record_size(p_rec[0]);
+    if (p_rec[1] == FERRIS_LOG_REC_DATA) {
+      p_entry->pos  = pos;
+      p_entry->next = next;
+      p_entry->len  = p_rec[0];
+      memcpy(p_entry->data, p_rec + 2, p_rec[0]);
+      return true;
+    }
+    pos = next;
+  }
+}
+
+uint32_t ferris_log_begin(void) {
+  return m_tail_seq * FS_PAGE_SIZE + LOG_PAGE_HEADER_SIZE;
+}
+
+uint32_t ferris_log_end(void) {
+  if (m_head_seq == 0) {
+    return 0;
+  }
+  return m_head_seq * FS_PAGE_SIZE + MIN(m_write_offset, FS_PAGE_SIZE);
+}
+
+uint32_t ferris_log_checkpoint_set(uint32_t pos) {
+  log_record_t *p_rec = queue_alloc();
+  if (p_rec == NULL) {
+    return NRF_ERROR_NO_MEM;
+  }
+  m_checkpoint  = pos;
+  p_rec->r.len  = 4;
+  p_rec->r.type = FERRIS_LOG_REC_CHECKPOINT;
+  uint32_encode(pos, p_rec->r.data);
+  queue_commit();
+  return NRF_SUCCESS;
+}
+
+uint32_t ferris_log_checkpoint_get(void) {
+  return m_checkpoint;
+}
@@ -0,0 +1,82 @@
+#ifndef FERRIS_LOG_H
+#define FERRIS_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ferris_codec.h"
+
+/** @file
+ * @brief Append-only flash log of compressed acceleration, written while no central is connected.
+ *
+ * The log is a ring of FERRIS_LOG_PAGES fstorage pages. Every page starts with a 32 bit page
+ * sequence number, followed by word aligned records:
+ *   byte 0    payload length, 0xFF marks the end of the written part of the page.
+ *   byte 1    record type.
+ *   payload   FERRIS_LOG_REC_DATA: one ferris_codec packet.
+ *             FERRIS_LOG_REC_CHECKPOINT: uint32 log position, little endian.
+ *
+ * When the ring is full the oldest page is erased, so every page wears at the same rate.
+ *
+ * A log position is page sequence * page size + offset in the page. It only grows, so a
+ * client can save the position of the last record it received and resume from there.
+ */
+
+#define FERRIS_LOG_PAGES 32         /**< Flash pages reserved for the log. */
+#define FERRIS_LOG_RECORD_MAX 16    /**< Max payload of a record, fits a bulk transfer frame. */
+#define FERRIS_LOG_QUEUE_SIZE 4     /**< Records waiting for the flash. */
+#define FERRIS_LOG_PENDING_SIZE 16  /**< Samples waiting to fill a record. */
+
+#define FERRIS_LOG_REC_DATA 0x01
+#define FERRIS_LOG_REC_CHECKPOINT 0x02
+
+typedef struct {
+  uint32_t pos;  /**< Position of the record. */
+  uint32_t next; /**< Position after the record. */
+  uint8_t len;
+  uint8_t data[FERRIS_LOG_RECORD_MAX];
+} ferris_log_entry_t;
+
+/**
+ * @brief Register the flash area and find the end of the log. Call after the SoftDevice is enabled.
+ */
+uint32_t ferris_log_init(void);
+
+/**
+ * @brief Add a sample. Samples are compressed and written once a record is full.
+ */
+uint32_t ferris_log_append(ferris_codec_sample_t const *p_sample);
+
+/**
+ * @brief Write the samples waiting for a record and start the next record with a keyframe.
+ */
+uint32_t ferris_log_flush(void);
+
+/**
+ * @brief Read the first data record at or after pos.
+ *
+ * @return false if there is no record after pos yet.
+ */
+bool ferris_log_read(uint32_t pos, ferris_log_entry_t *p_entry);
+
+/**
+ * @brief Position of the oldest record still in flash.
+ */
+uint32_t ferris_log_begin(void);
+
+/**
+ * @brief Position after the last record written to flash.
+ */
+uint32_t ferris_log_end(void);
+
+/**
+ * @brief Remember that the client has everything before pos. Stored in the log, so it survives a reset.
+ */
+uint32_t ferris_log_checkpoint_set(uint32_t pos);
+
+/**
+ * @brief Last checkpoint, where a download resumes.
+ */
+uint32_t ferris_log_checkpoint_get(void);
+
+#endif
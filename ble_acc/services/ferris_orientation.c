@@ -0,0 +1,44 @@
+#include "ferris_orientation.h"
+
+// Vectors are reduced to 1g = 4096 before the cross product and the product is reduced
+// again, so every term fits in int32 and the squared length fits in uint32. The second
+// reduction rounds, truncation biased the length low by half a unit per axis, which is a
+// percent of the squared length at the threshold.
+#define ACC_REDUCE_SHIFT 2
+#define CROSS_REDUCE_SHIFT 12
+#define CROSS_ROUND (1 << (CROSS_REDUCE_SHIFT - 1))
+
+static int16_t int16_big_decode(uint8_t const *p_value) {
+  return (int16_t)((p_value[0] << 8) | p_value[1]);
+}
+
+void ferris_orientation_decode(uint8_t const *p_value, int16_t *p_acc) {
+  for (int i = 0; i < 3; i++) {
+    p_acc[i] = int16_big_decode(p_value + i * 2);
+  }
+}
+
+uint32_t ferris_orientation_change(int16_t const U[3], int16_t const V[3]) {
+  int32_t u[3], v[3];
+  for (int i = 0; i < 3; i++) {
+    u[i] = U[i] >> ACC_REDUCE_SHIFT;
+    v[i] = V[i] >> ACC_REDUCE_SHIFT;
+  }
+  int32_t x = (u[1] * v[2] - u[2] * v[1] + CROSS_ROUND) >> CROSS_REDUCE_SHIFT;
+  int32_t y = (u[2] * v[0] - v[2] * u[0] + CROSS_ROUND) >> CROSS_REDUCE_SHIFT;
+  int32_t z = (u[0] * v[1] - u[1] * v[0] + CROSS_ROUND) >> CROSS_REDUCE_SHIFT;
+  return (uint32_t)(x * x) + (uint32_t)(y * y) + (uint32_t)(z * z);
+}
+
+void ferris_orientation_decode_float(uint8_t const *p_value, float *p_acc) {
+  for (int i = 0; i < 3; i++) {
+    p_acc[i] = ((float)int16_big_decode(p_value + i * 2)) / 32768 * 20;
+  }
+}
+
+float ferris_orientation_change_float(float const U[3], float const V[3]) {
+  float x = U[1] * V[2] - U[2] * V[1];
+  float y = U[2] * V[0] - V[2] * U[0];
+  float z = U[0] * V[1] - U[1] * V[0];
+  return x * x + y * y + z * z;
+}
@@ -0,0 +1,57 @@
+#ifndef FERRIS_ORIENTATION_H
+#define FERRIS_ORIENTATION_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @file
+ * @brief Orientation change between two acceleration samples, as the squared length of
+ *        their cross product, |U x V|^2 = |U|^2 |V|^2 sin^2(angle).
+ * The fixed point functions work on raw samples (1g = 16384 at +-2g) without soft-float
+ * calls. The float functions are the original implementation (1g = 10), kept for
+ * FERRIS_FIXED_POINT 0 and as the reference of the host equivalence test. The linker drops
+ * whichever pair the build does not call. Like the codec, this does not depend on the SDK.
+ */
+
+/**
+ * @brief Threshold of the first releases: the float path compared |U x V|^2 against
+ *        10 * 10 * sin(5 deg) = 8.7156. That is a squared length, so a report was triggered
+ *        above asin(sqrt(8.7156) / 100) = 1.7 deg, not 5 deg.
+ */
+#define FERRIS_ORIENTATION_THRESHOLD_FLOAT 8.7155742f
+
+/**
+ * @brief FERRIS_ORIENTATION_THRESHOLD_FLOAT for ferris_orientation_change(). One reduced
+ *        cross product unit is 1 / 40.96 of a float unit, so 8.7156 * 40.96 * 40.96.
+ */
+#define FERRIS_ORIENTATION_THRESHOLD 14622
+
+/**
+ * @brief Raw samples from {X_H, X_L, Y_H, Y_L, Z_H, Z_L}.
+ */
+void ferris_orientation_decode(uint8_t const *p_value, int16_t *p_acc);
+
+/**
+ * @brief |U x V|^2 of raw samples, on vectors reduced to 1g = 4096 (1 LSB = 1 / 16777216 g^2).
+ *        Every term fits in int32 and the sum in uint32 for any pair of samples.
+ */
+uint32_t ferris_orientation_change(int16_t const U[3], int16_t const V[3]);
+
+/**
+ * @brief Samples in m/s^2 (1g = 10, +-20 full scale) from {X_H, X_L, Y_H, Y_L, Z_H, Z_L}.
+ */
+void ferris_orientation_decode_float(uint8_t const *p_value, float *p_acc);
+
+/**
+ * @brief |U x V|^2 of samples from ferris_orientation_decode_float().
+ */
+float ferris_orientation_change_float(float const U[3], float const V[3]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+#include <string.h>
+
+#include "nrf_drv_timer.h"
+#include "ferris_profile.h"
+
+#define PROFILE_TIMER_INSTANCE 1 // TIMER0 belongs to the SoftDevice
+
+static const nrf_drv_timer_t m_timer = NRF_DRV_TIMER_INSTANCE(PROFILE_TIMER_INSTANCE);
+
+static uint8_t m_open; // bit per open stage, the timer runs while any is set
+static uint16_t m_start[FERRIS_PROFILE_STAGE_COUNT];
+static uint16_t m_ring[FERRIS_PROFILE_STAGE_COUNT][FERRIS_PROFILE_RING_SIZE];
+static uint32_t m_count[FERRIS_PROFILE_STAGE_COUNT];
+
+// No compare events are used, the driver wants a handler anyway.
+static void timer_event_handler(nrf_timer_event_t event_type, void *p_context) {
+}
+
+uint32_t ferris_profile_init(void) {
+  nrf_drv_timer_config_t config = NRF_DRV_TIMER_DEFAULT_CONFIG;
+
+  config.frequency = NRF_TIMER_FREQ_1MHz;
+  config.bit_width = NRF_TIMER_BIT_WIDTH_16;
+  m_open           = 0;
+  memset(m_count, 0, sizeof(m_count));
+  return nrf_drv_timer_init(&m_timer, &config, timer_event_handler);
+}
+
+void ferris_profile_begin(ferris_profile_stage_t stage) {
+  if (m_open == 0) {
+    nrf_drv_timer_clear(&m_timer);
+    nrf_drv_timer_enable(&m_timer);
+  }
+  m_open |= 1 << stage;
+  m_start[stage] = (uint16_t)nrf_drv_timer_capture(&m_timer, NRF_TIMER_CC_CHANNEL0);
+}
+
+void ferris_profile_end(ferris_profile_stage_t stage) {
+  if (!(m_open & (1 << stage))) {
+    return;
+  }
+  uint16_t duration = (uint16_t)nrf_drv_timer_capture(&m_timer, NRF_TIMER_CC_CHANNEL0) - m_start[stage];
+
+  m_ring[stage][m_count[stage] % FERRIS_PROFILE_RING_SIZE] = duration;
+  m_count[stage]++;
+  m_open &= ~(1 << stage);
+  if (m_open == 0) {
+    nrf_drv_timer_disable(&m_timer);
+  }
+}
+
+void ferris_profile_summary(ferris_profile_t *p_profile) {
+  uint16_t sorted[FERRIS_PROFILE_RING_SIZE];
+
+  memset(p_profile, 0, sizeof(*p_profile));
+  for (int stage = 0; stage < FERRIS_PROFILE_STAGE_COUNT; stage++) {
+    ferris_profile_summary_t *p_summary = &p_profile->stages[stage];
+    uint8_t n = m_count[stage] < FERRIS_PROFILE_RING_SIZE ? m_count[stage] : FERRIS_PROFILE_RING_SIZE;
+
+    p_summary->count = m_count[stage];
+    if (n == 0) {
+      continue;
+    }
+    // insertion sort, the ring is short
+    for (uint8_t i = 0; i < n; i++) {
+      uint16_t v = m_ring[stage][i];
+      uint8_t j  = i;
+      while (j > 0 && sorted[j - 1] > v) {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      sorted[j] = v;
+    }
+    p_summary->min_us = sorted[0];
+    p_summary->p50_us = sorted[(n - 1) * 50 / 100];
+    p_summary->p90_us = sorted[(n - 1) * 90 / 100];
+    p_summary->max_us = sorted[n - 1];
+  }
+}
@@ -0,0 +1,78 @@
+#ifndef FERRIS_PROFILE_H
+#define FERRIS_PROFILE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @file
+ * @brief Duration of the stages between a sensor read and the notification, in us.
+ *
+ * Stages are timed with TIMER1 at 1 MHz. The timer only runs while a stage is open, so a build
+ * with profiling costs nothing while the CPU sleeps between samples. TIMER1 is 16 bit on the
+ * nRF51, so a stage must finish within 65 ms to be measured right.
+ *
+ * Every stage keeps its last FERRIS_PROFILE_RING_SIZE durations for the summaries.
+ */
+
+#ifndef FERRIS_PROFILE_ENABLED
+#define FERRIS_PROFILE_ENABLED 1
+#endif
+
+#define FERRIS_PROFILE_RING_SIZE 32
+
+typedef enum {
+  FERRIS_PROFILE_READ,   /**< Sensor read issued to its completion handler: bus queue, TWI and scheduler. */
+  FERRIS_PROFILE_SEND,   /**< ferris_acceleration_send() of one sample. */
+  FERRIS_PROFILE_SAMPLE, /**< Sensor read issued to its last sample handed to the service. */
+  FERRIS_PROFILE_STAGE_COUNT,
+} ferris_profile_stage_t;
+
+typedef struct {
+  uint32_t count;  /**< Measurements since boot. */
+  uint16_t min_us; /**< Over the last FERRIS_PROFILE_RING_SIZE measurements. */
+  uint16_t p50_us;
+  uint16_t p90_us;
+  uint16_t max_us;
+} ferris_profile_summary_t;
+
+/**@brief Summaries, readable by the client as they are laid out here (little endian). */
+typedef struct {
+  ferris_profile_summary_t stages[FERRIS_PROFILE_STAGE_COUNT]; /**< By ferris_profile_stage_t. */
+} ferris_profile_t;
+
+#if FERRIS_PROFILE_ENABLED
+#define FERRIS_PROFILE_BEGIN(stage) ferris_profile_begin(stage)
+#define FERRIS_PROFILE_END(stage) ferris_profile_end(stage)
+#else
+#define FERRIS_PROFILE_BEGIN(stage) ((void)0)
+#define FERRIS_PROFILE_END(stage) ((void)0)
+#endif
+
+/**
+ * @brief Set up TIMER1, it stays stopped until a stage begins.
+ */
+uint32_t ferris_profile_init(void);
+
+/**
+ * @brief Open a stage, or restart it if it is open. Use FERRIS_PROFILE_BEGIN().
+ */
+void ferris_profile_begin(ferris_profile_stage_t stage);
+
+/**
+ * @brief Close a stage and record its duration, nothing if it is not open. Use FERRIS_PROFILE_END().
+ */
+void ferris_profile_end(ferris_profile_stage_t stage);
+
+/**
+ * @brief Summarize the recorded durations.
+ */
+void ferris_profile_summary(ferris_profile_t *p_profile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,8 +1,12 @@
 #include <string.h>
 
+#include "app_scheduler.h"
+#include "app_timer.h"
+#include "app_util.h"
 #include "ble.h"
 #include "ble_gatts.h"
 #include "ble_srv_common.h"
+#include "ferris_orientation.h"
 #include "ferris_service.h"
 
 const ble_uuid128_t ferris_uuid = {{0x9e, 0x5e, 0xaa, 0xf7, 0x4d, 0x9c, 0x47, 0xdc, 0x93, 0xad, 0x2a, 0xf9, 0x5b, 0x6b, 0x22, 0xa2}};
@@ -12,9 +16,36 @@ const uint16_t acc_data_len     = 6;
 const uint8_t char_acc_desc[]             = "Acceleration raw data, [-2G, 2G], in {X_H, X_L, Y_H, Y_L, Z_H, Z_L} format";
 const uint8_t char_sample_interval_desc[] = "Sample interval in ms.";
 const uint8_t char_battery_voltage_desc[] = "Battery voltage in mV.";
-
-// Acceleration characteristic
-uint32_t ferris_add_accel_char(ferris_service_t *p_ferris_service) {
+const uint8_t char_batch_desc[]           = "Batched acceleration, N * {T_L, T_H, X_H, X_L, Y_H, Y_L, Z_H, Z_L}, T in 1/1024 s";
+const uint8_t char_batch_size_desc[]      = "Samples per batch notification.";
+const uint8_t char_codec_desc[]           = "Delta compressed acceleration, see ferris_codec.h";
+const uint8_t char_tx_stats_desc[]        = "TX counters, {sent, acc dropped, batch dropped}, uint32 each.";
+const uint8_t char_log_desc[]             = "Offline log bulk data, {SEQ_L, SEQ_H, record}";
+const uint8_t char_bulk_cp_desc[]         = "Offline log bulk control point, see ferris_bulk_op_t";
+const uint8_t char_gyro_desc[]            = "Rotation rate raw data, [-250, 250] deg/s, in {X_H, X_L, Y_H, Y_L, Z_H, Z_L} format";
+const uint8_t char_policy_desc[]          = "Report suppression policy, see ferris_policy_t";
+const uint8_t char_tilt_desc[]            = "Wheel position and speed, {POSITION:4, RPM:2}, see ferris_tilt.h";
+const uint8_t char_temp_desc[]            = "Temperature raw data, raw / 340 + 36.53 C, in {T_H, T_L} format";
+const uint8_t char_acc_timed_desc[]       = "Timestamped acceleration, {T:4, X_H, X_L, Y_H, Y_L, Z_H, Z_L}, T in 1/32768 s";
+const uint8_t char_energy_desc[]          = "Power state diagnostics, see ferris_energy_t";
+const uint8_t char_profile_desc[]         = "Sample path timing in us, see ferris_profile_t";
+const uint8_t char_time_sync_desc[]       = "Time sync, write {T0:4}, notifies {T0:4, T1:4, T2:4}, see ferris_service.h";
+
+STATIC_ASSERT(sizeof(ferris_policy_t) == 16);
+
+#define BULK_FRAME_MAX_LEN (FERRIS_BULK_FRAME_HEADER_SIZE + FERRIS_LOG_RECORD_MAX)
+STATIC_ASSERT(BULK_FRAME_MAX_LEN <= BLE_GATT_ATT_MTU_DEFAULT - 3);
+
+static void policy_default(ferris_service_t *p_ferris_service);
+
+APP_TIMER_DEF(batch_timer_id); /**< Flushes a partial batch after FERRIS_BATCH_DEADLINE_MS. */
+
+// Add notify characteristic. The value lives in p_value, or in the stack when p_value is NULL.
+// A writable one accepts writes with and without response.
+uint32_t ferris_add_notify_characteristic(ferris_service_t *p_ferris_service, ble_gatts_char_handles_t *p_handles,
+                                          uint8_t *p_value, uint16_t value_len, uint16_t max_len,
+                                          uint16_t uuid, const uint8_t *char_user_desc, uint16_t char_user_desc_size,
+                                          bool writable) {
 
   uint32_t err_code;
 
@@ -32,18 +63,20 @@ uint32_t ferris_add_accel_char(ferris_service_t *p_ferris_service) {
 
   ble_gatts_char_md_t char_md;
   memset(&char_md, 0, sizeof(char_md));
-  char_md.char_props.read         = 1;
-  char_md.char_props.notify       = 1;
-  char_md.p_char_user_desc        = (uint8_t *)char_acc_desc;
-  char_md.char_user_desc_max_size = sizeof(char_acc_desc);
-  char_md.char_user_desc_size     = sizeof(char_acc_desc);
+  char_md.char_props.read          = 1;
+  char_md.char_props.notify        = 1;
+  char_md.char_props.write         = writable ? 1 : 0;
+  char_md.char_props.write_wo_resp = writable ? 1 : 0;
+  char_md.p_char_user_desc         = (uint8_t *)char_user_desc;
+  char_md.char_user_desc_max_size  = char_user_desc_size;
+  char_md.char_user_desc_size      = char_user_desc_size;
   char_md.p_cccd_md = &cccd_md;
 
   // characteristic uuid
 
   ble_uuid_t ble_uuid;
   ble_uuid.type = p_ferris_service->uuid_type;
-  ble_uuid.uuid = 0x6050;
+  ble_uuid.uuid = uuid;
 
   // characteristic attrs. such as permission
   ble_gatts_attr_md_t attr_md;
@@ -51,12 +84,16 @@ uint32_t ferris_add_accel_char(ferris_service_t *p_ferris_service) {
   memset(&attr_md, 0, sizeof(attr_md));
 
   BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
-  BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+  if (writable) {
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+  } else {
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+  }
 
-  attr_md.vloc    = BLE_GATTS_VLOC_USER;
+  attr_md.vloc    = (p_value != NULL) ? BLE_GATTS_VLOC_USER : BLE_GATTS_VLOC_STACK;
   attr_md.rd_auth = 0;
   attr_md.wr_auth = 0;
-  attr_md.vlen    = 0;
+  attr_md.vlen    = (value_len != max_len);
 
   // characteristic value
 
@@ -65,15 +102,23 @@ uint32_t ferris_add_accel_char(ferris_service_t *p_ferris_service) {
 
   attr_char_value.p_uuid    = &ble_uuid;
   attr_char_value.p_attr_md = &attr_md;
-  attr_char_value.init_len  = sizeof(uint8_t) * acc_data_len;
+  attr_char_value.init_len  = value_len;
   attr_char_value.init_offs = 0;
-  attr_char_value.max_len   = sizeof(uint8_t) * acc_data_len;
-  attr_char_value.p_value   = p_ferris_service->p_acceleration_data;
+  attr_char_value.max_len   = max_len;
+  attr_char_value.p_value   = p_value;
 
-  err_code = sd_ble_gatts_characteristic_add(p_ferris_service->service_handle, &char_md, &attr_char_value, &(p_ferris_service->acc_char_handle));
+  err_code = sd_ble_gatts_characteristic_add(p_ferris_service->service_handle, &char_md, &attr_char_value, p_handles);
   return err_code;
 }
 
+// Acceleration characteristic
+uint32_t ferris_add_accel_char(ferris_service_t *p_ferris_service) {
+  return ferris_add_notify_characteristic(p_ferris_service, &(p_ferris_service->acc_char_handle),
+                                          p_ferris_service->p_acceleration_data,
+                                          sizeof(uint8_t) * acc_data_len, sizeof(uint8_t) * acc_data_len,
+                                          0x6050, char_acc_desc, sizeof(char_acc_desc), false);
+}
+
 // Add normal value characteristic
 uint32_t ferris_add_normal_characteristic(ferris_service_t *p_ferris_service, ble_gatts_char_handles_t *p_handles,
                                           uint8_t *p_value, uint16_t value_len,
@@ -139,12 +184,439 @@ uint32_t ferris_add_normal_characteristic(ferris_service_t *p_ferris_service, bl
   return err_code;
 }
 
+// Samples per batch notification, limited by the ATT payload.
+static uint8_t batch_samples_per_packet(ferris_service_t *p_ferris_service) {
+  uint8_t max_samples = p_ferris_service->batch_max_len / FERRIS_BATCH_SAMPLE_SIZE;
+  return MAX(1, MIN(p_ferris_service->batch_size, max_samples));
+}
+
+static void batch_timer_update(ferris_service_t *p_ferris_service) {
+  if (p_ferris_service->batch_count == 0) {
+    if (p_ferris_service->batch_timer_running) {
+      app_timer_stop(batch_timer_id);
+      p_ferris_service->batch_timer_running = false;
+    }
+  } else if (!p_ferris_service->batch_timer_running) {
+    if (app_timer_start(batch_timer_id, APP_TIMER_TICKS(FERRIS_BATCH_DEADLINE_MS, 0), p_ferris_service) == NRF_SUCCESS) {
+      p_ferris_service->batch_timer_running = true;
+    }
+  }
+}
+
+// All SoftDevice TX buffers of the link, free or not.
+static uint8_t tx_packet_count(ferris_service_t *p_ferris_service) {
+#if (NRF_SD_BLE_API_VERSION == 3)
+  // no way to ask, learn the real count from BLE_ERROR_NO_TX_PACKETS
+  return UINT8_MAX;
+#else
+  uint8_t count;
+
+  if (sd_ble_tx_packet_count_get(p_ferris_service->conn_handle, &count) != NRF_SUCCESS) {
+    return 1;
+  }
+  return count;
+#endif
+}
+
+// Hand one notification to the SoftDevice and keep tx_free in step with its buffers.
+static uint32_t tx_notify(ferris_service_t *p_ferris_service, uint16_t handle, uint8_t *p_data, uint16_t len) {
+  ble_gatts_hvx_params_t hvx_params;
+
+  memset(&hvx_params, 0, sizeof(hvx_params));
+  hvx_params.handle = handle;
+  hvx_params.p_data = p_data;
+  hvx_params.p_len  = &len;
+  hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+
+  uint32_t err_code = sd_ble_gatts_hvx(p_ferris_service->conn_handle, &hvx_params);
+  if (err_code == NRF_SUCCESS) {
+    p_ferris_service->tx_stats.packets_sent++;
+    // on_tx_complete() gives the credit back, the SoftDevice reports every packet it frees
+    if (p_ferris_service->tx_free > 0) {
+      p_ferris_service->tx_free--;
+    }
+  } else if (err_code == BLE_ERROR_NO_TX_PACKETS) {
+    // our count was off, wait for the next BLE_EVT_TX_COMPLETE
+    p_ferris_service->tx_free = 0;
+  }
+  return err_code;
+}
+
+static void batch_pop(ferris_service_t *p_ferris_service, uint8_t n) {
+  p_ferris_service->batch_head = (p_ferris_service->batch_head + n) % FERRIS_BATCH_RING_SIZE;
+  p_ferris_service->batch_count -= n;
+  if (p_ferris_service->batch_count == 0) {
+    p_ferris_service->batch_deadline = false;
+  }
+}
+
+// Compress queued samples. A packet is sent once it is full, or with force whatever is queued.
+// Samples stay queued while the SoftDevice is out of buffers.
+static uint32_t codec_flush(ferris_service_t *p_ferris_service, bool force) {
+  static ferris_codec_sample_t samples[FERRIS_BATCH_RING_SIZE];
+  uint32_t err_code = NRF_SUCCESS;
+  uint8_t packet[FERRIS_BATCH_MAX_LEN];
+
+  while (p_ferris_service->batch_count > 0 && p_ferris_service->tx_free > 0) {
+    uint8_t count = p_ferris_service->batch_count;
+    uint16_t len;
+    bool full;
+
+    for (uint8_t i = 0; i < count; i++) {
+      ferris_batch_sample_t *p_sample = &p_ferris_service->batch_ring[(p_ferris_service->batch_head + i) % FERRIS_BATCH_RING_SIZE];
+      samples[i].timestamp            = p_sample->timestamp;
+      for (int axis = 0; axis < 3; axis++) {
+        samples[i].acc[axis] = (int16_t)uint16_big_decode(p_sample->acc + axis * 2);
+      }
+    }
+
+    uint8_t n = ferris_codec_encode(&p_ferris_service->codec, samples, count, packet,
+                                    p_ferris_service->batch_max_len, &len, &full);
+    if (n == 0 || (!full && !force)) {
+      break;
+    }
+
+    err_code = tx_notify(p_ferris_service, p_ferris_service->codec_char_handle.value_handle, packet, len);
+    if (err_code != NRF_SUCCESS) {
+      break;
+    }
+    ferris_codec_encoder_commit(&p_ferris_service->codec, &samples[n - 1]);
+    batch_pop(p_ferris_service, n);
+  }
+
+  batch_timer_update(p_ferris_service);
+  return err_code;
+}
+
+// Notify full batches. With force, or once the deadline passed, also notify what is left.
+// Samples stay queued while the SoftDevice is out of buffers.
+static uint32_t batch_flush(ferris_service_t *p_ferris_service, bool force) {
+  uint32_t err_code = NRF_SUCCESS;
+  uint8_t per_packet = batch_samples_per_packet(p_ferris_service);
+  uint8_t packet[FERRIS_BATCH_MAX_LEN];
+
+  force = force || p_ferris_service->batch_deadline;
+  if (p_ferris_service->codec_notification) {
+    return codec_flush(p_ferris_service, force);
+  }
+
+  while ((p_ferris_service->batch_count >= per_packet || (force && p_ferris_service->batch_count > 0)) &&
+         p_ferris_service->tx_free > 0) {
+    uint8_t n    = MIN(p_ferris_service->batch_count, per_packet);
+    uint16_t len = n * FERRIS_BATCH_SAMPLE_SIZE;
+
+    for (uint8_t i = 0; i < n; i++) {
+      ferris_batch_sample_t *p_sample = &p_ferris_service->batch_ring[(p_ferris_service->batch_head + i) % FERRIS_BATCH_RING_SIZE];
+      uint8_t *p_out                  = packet + i * FERRIS_BATCH_SAMPLE_SIZE;
+      uint16_encode(p_sample->timestamp, p_out);
+      memcpy(p_out + 2, p_sample->acc, sizeof(p_sample->acc));
+    }
+
+    err_code = tx_notify(p_ferris_service, p_ferris_service->batch_char_handle.value_handle, packet, len);
+    if (err_code != NRF_SUCCESS) {
+      break;
+    }
+    batch_pop(p_ferris_service, n);
+  }
+
+  batch_timer_update(p_ferris_service);
+  return err_code;
+}
+
+static void batch_reset(ferris_service_t *p_ferris_service) {
+  p_ferris_service->batch_head     = 0;
+  p_ferris_service->batch_count    = 0;
+  p_ferris_service->batch_deadline = false;
+  batch_timer_update(p_ferris_service);
+}
+
+static void batch_push(ferris_service_t *p_ferris_service, uint32_t timestamp) {
+  if (p_ferris_service->batch_count == FERRIS_BATCH_RING_SIZE) {
+    // drop the oldest sample
+    p_ferris_service->batch_head = (p_ferris_service->batch_head + 1) % FERRIS_BATCH_RING_SIZE;
+    p_ferris_service->batch_count--;
+    p_ferris_service->tx_stats.batch_dropped++;
+  }
+
+  ferris_batch_sample_t *p_sample = &p_ferris_service->batch_ring[(p_ferris_service->batch_head + p_ferris_service->batch_count) % FERRIS_BATCH_RING_SIZE];
+  p_sample->timestamp             = (uint16_t)(timestamp >> 5); // 32768 Hz ticks to 1/1024 s
+  memcpy(p_sample->acc, p_ferris_service->p_acceleration_data, sizeof(p_sample->acc));
+  p_ferris_service->batch_count++;
+}
+
+static void batch_deadline_handler(void *p_event_data, uint16_t event_size) {
+  ferris_service_t *p_ferris_service = *(ferris_service_t **)p_event_data;
+
+  if (p_ferris_service->conn_handle != BLE_CONN_HANDLE_INVALID &&
+      (p_ferris_service->batch_notification || p_ferris_service->codec_notification)) {
+    p_ferris_service->batch_deadline = p_ferris_service->batch_count > 0;
+    batch_flush(p_ferris_service, false);
+  }
+}
+
+// May run in the RTC1 interrupt (app_timer without scheduler), the flush is done from the main loop.
+static void batch_timeout_handler(void *p_context) {
+  ferris_service_t *p_ferris_service = (ferris_service_t *)p_context;
+
+  p_ferris_service->batch_timer_running = false;
+  app_sched_event_put(&p_ferris_service, sizeof(p_ferris_service), batch_deadline_handler);
+}
+
+static void acc_queue_reset(ferris_service_t *p_ferris_service) {
+  p_ferris_service->acc_queue_head  = 0;
+  p_ferris_service->acc_queue_count = 0;
+}
+
+static void acc_queue_push(ferris_service_t *p_ferris_service, uint32_t timestamp) {
+  if (p_ferris_service->acc_queue_count == FERRIS_TX_QUEUE_SIZE) {
+    // drop the oldest sample
+    p_ferris_service->acc_queue_head = (p_ferris_service->acc_queue_head + 1) % FERRIS_TX_QUEUE_SIZE;
+    p_ferris_service->acc_queue_count--;
+    p_ferris_service->tx_stats.acc_dropped++;
+  }
+
+  uint8_t tail = (p_ferris_service->acc_queue_head + p_ferris_service->acc_queue_count) % FERRIS_TX_QUEUE_SIZE;
+  uint32_encode(timestamp, p_ferris_service->acc_queue[tail]);
+  memcpy(p_ferris_service->acc_queue[tail] + 4, p_ferris_service->p_acceleration_data, acc_data_len);
+  p_ferris_service->acc_queue_count++;
+}
+
+static void ferris_evt_send(ferris_service_t *p_ferris_service, ferris_evt_type_t evt_type) {
+  if (p_ferris_service->evt_handler != NULL) {
+    ferris_evt_t evt = {.evt_type = evt_type};
+    p_ferris_service->evt_handler(p_ferris_service, &evt);
+  }
+}
+
+// Queue a control point response, it is sent before any data.
+static void bulk_respond(ferris_service_t *p_ferris_service, uint8_t const *p_rsp, uint8_t len) {
+  if (p_ferris_service->bulk_cp_notification) {
+    memcpy(p_ferris_service->bulk_rsp, p_rsp, len);
+    p_ferris_service->bulk_rsp_len = len;
+  }
+}
+
+static uint32_t bulk_rsp_flush(ferris_service_t *p_ferris_service) {
+  uint32_t err_code = NRF_SUCCESS;
+
+  if (p_ferris_service->bulk_rsp_len > 0 && p_ferris_service->tx_free > 0) {
+    err_code = tx_notify(p_ferris_service, p_ferris_service->bulk_cp_char_handle.value_handle,
+                         p_ferris_service->bulk_rsp, p_ferris_service->bulk_rsp_len);
+    if (err_code != BLE_ERROR_NO_TX_PACKETS) {
+      p_ferris_service->bulk_rsp_len = 0;
+    }
+  }
+  return err_code;
+}
+
+// Log position up to which the client has everything.
+static uint32_t bulk_acked_pos(ferris_service_t *p_ferris_service) {
+  if (p_ferris_service->bulk_acked == p_ferris_service->bulk_seq) {
+    return p_ferris_service->bulk_pos;
+  }
+  return p_ferris_service->bulk_window[p_ferris_service->bulk_acked % FERRIS_BULK_WINDOW];
+}
+
+static void bulk_stop(ferris_service_t *p_ferris_service, bool done) {
+  uint32_t pos = bulk_acked_pos(p_ferris_service);
+
+  p_ferris_service->bulk_active       = false;
+  p_ferris_service->bulk_resend_count = 0;
+  if (pos != ferris_log_checkpoint_get()) {
+    ferris_log_checkpoint_set(pos);
+  }
+  if (done) {
+    uint8_t rsp[5] = {FERRIS_BULK_RSP_DONE};
+    uint32_encode(pos, rsp + 1);
+    bulk_respond(p_ferris_service, rsp, sizeof(rsp));
+  }
+  ferris_evt_send(p_ferris_service, FERRIS_EVT_BULK_STOPPED);
+}
+
+static uint32_t bulk_send_frame(ferris_service_t *p_ferris_service, uint16_t seq, ferris_log_entry_t const *p_entry) {
+  uint8_t frame[BULK_FRAME_MAX_LEN];
+
+  uint16_encode(seq, frame);
+  memcpy(frame + FERRIS_BULK_FRAME_HEADER_SIZE, p_entry->data, p_entry->len);
+  return tx_notify(p_ferris_service, p_ferris_service->log_char_handle.value_handle,
+                   frame, FERRIS_BULK_FRAME_HEADER_SIZE + p_entry->len);
+}
+
+// Retransmit requested frames, then send new frames while the window is open.
+static uint32_t bulk_pump(ferris_service_t *p_ferris_service) {
+  uint32_t err_code = NRF_SUCCESS;
+  ferris_log_entry_t entry;
+
+  while (p_ferris_service->bulk_resend_count > 0 && p_ferris_service->tx_free > 0) {
+    uint16_t seq       = p_ferris_service->bulk_resend[0];
+    uint16_t in_flight = p_ferris_service->bulk_seq - p_ferris_service->bulk_acked;
+    if ((uint16_t)(seq - p_ferris_service->bulk_acked) < in_flight &&
+        ferris_log_read(p_ferris_service->bulk_window[seq % FERRIS_BULK_WINDOW], &entry)) {
+      err_code = bulk_send_frame(p_ferris_service, seq, &entry);
+      if (err_code != NRF_SUCCESS) {
+        return err_code;
+      }
+    }
+    p_ferris_service->bulk_resend_count--;
+    memmove(p_ferris_service->bulk_resend, p_ferris_service->bulk_resend + 1,
+            p_ferris_service->bulk_resend_count * sizeof(p_ferris_service->bulk_resend[0]));
+  }
+
+  while ((uint16_t)(p_ferris_service->bulk_seq - p_ferris_service->bulk_acked) < FERRIS_BULK_WINDOW &&
+         p_ferris_service->tx_free > 0) {
+    if (!ferris_log_read(p_ferris_service->bulk_pos, &entry)) {
+      break;
+    }
+    err_code = bulk_send_frame(p_ferris_service, p_ferris_service->bulk_seq, &entry);
+    if (err_code != NRF_SUCCESS) {
+      return err_code;
+    }
+    p_ferris_service->bulk_window[p_ferris_service->bulk_seq % FERRIS_BULK_WINDOW] = entry.pos;
+    p_ferris_service->bulk_seq++;
+    p_ferris_service->bulk_pos = entry.next;
+  }
+
+  if (p_ferris_service->bulk_seq == p_ferris_service->bulk_acked && !ferris_log_read(p_ferris_service->bulk_pos, &entry)) {
+    bulk_stop(p_ferris_service, true);
+  }
+  return err_code;
+}
+
+// Send the time sync response, T2 as close to the hand over as it gets.
+static uint32_t time_sync_flush(ferris_service_t *p_ferris_service) {
+  uint32_t err_code = NRF_SUCCESS;
+
+  if (p_ferris_service->time_sync_pending && p_ferris_service->tx_free > 0) {
+    uint32_encode(ferris_time_now(), p_ferris_service->time_sync_rsp + 8);
+    err_code = tx_notify(p_ferris_service, p_ferris_service->time_sync_char_handle.value_handle,
+                         p_ferris_service->time_sync_rsp, FERRIS_TIME_SYNC_RSP_SIZE);
+    if (err_code != BLE_ERROR_NO_TX_PACKETS) {
+      p_ferris_service->time_sync_pending = false;
+    }
+  }
+  return err_code;
+}
+
+// Send the oldest queued sample to the plain and the timestamped characteristic, whichever are subscribed.
+static uint32_t acc_queue_pop(ferris_service_t *p_ferris_service) {
+  uint8_t *p_entry  = p_ferris_service->acc_queue[p_ferris_service->acc_queue_head];
+  uint32_t err_code = NRF_SUCCESS;
+  bool sent         = false;
+
+  if (p_ferris_service->acc_timed_notification) {
+    err_code = tx_notify(p_ferris_service, p_ferris_service->acc_timed_char_handle.value_handle,
+                         p_entry, FERRIS_TIMED_SAMPLE_SIZE);
+    if (err_code == BLE_ERROR_NO_TX_PACKETS) {
+      return err_code;
+    }
+    sent = true;
+  }
+  if (p_ferris_service->acceleration_notification) {
+    err_code = tx_notify(p_ferris_service, p_ferris_service->acc_char_handle.value_handle,
+                         p_entry + 4, acc_data_len);
+    if (err_code == BLE_ERROR_NO_TX_PACKETS) {
+      if (!sent) {
+        return err_code;
+      }
+      // with half of the sample out, the other half is dropped rather than the first sent twice
+      p_ferris_service->tx_stats.acc_dropped++;
+    }
+  }
+  // other errors (e.g. notifications just disabled) would not go away by retrying
+  p_ferris_service->acc_queue_head = (p_ferris_service->acc_queue_head + 1) % FERRIS_TX_QUEUE_SIZE;
+  p_ferris_service->acc_queue_count--;
+  return err_code;
+}
+
+// Fill the free SoftDevice buffers: control point responses, single samples, batches, then the backlog.
+static uint32_t tx_pump(ferris_service_t *p_ferris_service) {
+  uint32_t err_code = NRF_SUCCESS;
+
+  err_code = bulk_rsp_flush(p_ferris_service);
+  if (err_code == BLE_ERROR_NO_TX_PACKETS) {
+    return err_code;
+  }
+  err_code = time_sync_flush(p_ferris_service);
+  if (err_code == BLE_ERROR_NO_TX_PACKETS) {
+    return err_code;
+  }
+
+  // a sample goes out whole or waits, so both characteristics see the same samples
+  uint8_t per_sample = (p_ferris_service->acceleration_notification ? 1 : 0) +
+                       (p_ferris_service->acc_timed_notification ? 1 : 0);
+  while (p_ferris_service->acc_queue_count > 0 && p_ferris_service->tx_free >= MAX(per_sample, 1)) {
+    err_code = acc_queue_pop(p_ferris_service);
+    if (err_code == BLE_ERROR_NO_TX_PACKETS) {
+      break;
+    }
+  }
+
+  if (p_ferris_service->batch_notification || p_ferris_service->codec_notification) {
+    uint32_t batch_err_code = batch_flush(p_ferris_service, false);
+    if (err_code == NRF_SUCCESS) {
+      err_code = batch_err_code;
+    }
+  }
+
+  // the backlog goes last, live data is more urgent
+  if (p_ferris_service->bulk_active) {
+    uint32_t bulk_err_code = bulk_pump(p_ferris_service);
+    if (err_code == NRF_SUCCESS) {
+      err_code = bulk_err_code;
+    }
+    // the transfer may have just finished
+    bulk_rsp_flush(p_ferris_service);
+  }
+  return err_code;
+}
+
 uint32_t ferris_service_init(ferris_service_t *p_ferris_service, ferris_service_init_t *p_ferris_service_init) {
   uint32_t err_code;
   p_ferris_service->p_acceleration_data       = p_ferris_service_init->p_acceleration_data;
   p_ferris_service->p_battery_voltage         = p_ferris_service_init->p_battery_voltage;
+  p_ferris_service->p_energy                  = p_ferris_service_init->p_energy;
+  p_ferris_service->p_profile                 = p_ferris_service_init->p_profile;
+  p_ferris_service->evt_handler               = p_ferris_service_init->evt_handler;
+  p_ferris_service->log_enabled               = p_ferris_service_init->log_enabled;
+  p_ferris_service->log_notification          = false;
+  p_ferris_service->bulk_cp_notification      = false;
+  p_ferris_service->bulk_active               = false;
+  p_ferris_service->bulk_rsp_len              = 0;
+  p_ferris_service->conn_handle               = BLE_CONN_HANDLE_INVALID;
   p_ferris_service->acceleration_notification = false;
+  p_ferris_service->acc_timed_notification    = false;
+  p_ferris_service->time_sync_notification    = false;
+  p_ferris_service->time_sync_pending         = false;
+  p_ferris_service->gyro_notification         = false;
+  p_ferris_service->temp_notification         = false;
+  p_ferris_service->tilt_notification         = false;
   p_ferris_service->sample_interval           = 200;
+  p_ferris_service->batch_notification        = false;
+  p_ferris_service->batch_size                = FERRIS_BATCH_MAX_LEN / FERRIS_BATCH_SAMPLE_SIZE;
+  p_ferris_service->batch_max_len             = BLE_GATT_ATT_MTU_DEFAULT - 3;
+  p_ferris_service->batch_head                = 0;
+  p_ferris_service->batch_count               = 0;
+  p_ferris_service->batch_timer_running       = false;
+  p_ferris_service->batch_deadline            = false;
+  p_ferris_service->codec_notification        = false;
+  p_ferris_service->tx_free                   = 0;
+  memset(&p_ferris_service->codec, 0, sizeof(p_ferris_service->codec));
+  memset(&p_ferris_service->tx_stats, 0, sizeof(p_ferris_service->tx_stats));
+  acc_queue_reset(p_ferris_service);
+  ferris_tilt_reset(&p_ferris_service->tilt);
+  policy_default(p_ferris_service);
+
+  err_code = app_timer_create(&batch_timer_id, APP_TIMER_MODE_SINGLE_SHOT, batch_timeout_handler);
+  if (err_code) {
+    return err_code;
+  }
+
+  if (p_ferris_service->log_enabled) {
+    err_code = ferris_log_init();
+    if (err_code) {
+      return err_code;
+    }
+  }
 
   // Add a Vendor Specific base UUID.
   // Other uuids (both service and charistracter) are based on this uuid.
@@ -169,6 +641,108 @@ uint32_t ferris_service_init(ferris_service_t *p_ferris_service, ferris_service_
     return err_code;
   }
 
+  // add timestamped acceleration
+  err_code = ferris_add_notify_characteristic(p_ferris_service, &(p_ferris_service->acc_timed_char_handle),
+                                              NULL, FERRIS_TIMED_SAMPLE_SIZE, FERRIS_TIMED_SAMPLE_SIZE,
+                                              0x6058, char_acc_timed_desc, sizeof(char_acc_timed_desc), false);
+  if (err_code) {
+    return err_code;
+  }
+
+  // add time sync
+  err_code = ferris_add_notify_characteristic(p_ferris_service, &(p_ferris_service->time_sync_char_handle),
+                                              NULL, 0, FERRIS_TIME_SYNC_RSP_SIZE,
+                                              0x6059, char_time_sync_desc, sizeof(char_time_sync_desc), true);
+  if (err_code) {
+    return err_code;
+  }
+
+  // add wheel position and speed
+  err_code = ferris_add_notify_characteristic(p_ferris_service, &(p_ferris_service->tilt_char_handle),
+                                              NULL, FERRIS_TILT_VALUE_SIZE, FERRIS_TILT_VALUE_SIZE,
+                                              0x6057, char_tilt_desc, sizeof(char_tilt_desc), false);
+  if (err_code) {
+    return err_code;
+  }
+
+  // add rotation rate and temperature
+  err_code = ferris_add_notify_characteristic(p_ferris_service, &(p_ferris_service->gyro_char_handle),
+                                              NULL, 6, 6,
+                                              0x6055, char_gyro_desc, sizeof(char_gyro_desc), false);
+  if (err_code) {
+    return err_code;
+  }
+
+  err_code = ferris_add_notify_characteristic(p_ferris_service, &(p_ferris_service->temp_char_handle),
+                                              NULL, 2, 2,
+                                              0x6056, char_temp_desc, sizeof(char_temp_desc), false);
+  if (err_code) {
+    return err_code;
+  }
+
+  // add batched acceleration
+  err_code = ferris_add_notify_characteristic(p_ferris_service, &(p_ferris_service->batch_char_handle),
+                                              NULL, 0, FERRIS_BATCH_MAX_LEN,
+                                              0x6051, char_batch_desc, sizeof(char_batch_desc), false);
+  if (err_code) {
+    return err_code;
+  }
+
+  // add compressed acceleration
+  err_code = ferris_add_notify_characteristic(p_ferris_service, &(p_ferris_service->codec_char_handle),
+                                              NULL, 0, FERRIS_BATCH_MAX_LEN,
+                                              0x6052, char_codec_desc, sizeof(char_codec_desc), false);
+  if (err_code) {
+    return err_code;
+  }
+
+  // add report suppression policy
+  err_code = ferris_add_normal_characteristic(p_ferris_service, &(p_ferris_service->policy_char_handle),
+                                              (uint8_t *)(&p_ferris_service->policy), sizeof(ferris_policy_t),
+                                              ((uint16_t)('P') << 8) + 'O',
+                                              char_policy_desc, sizeof(char_policy_desc), false,
+                                              BLE_GATT_CPF_FORMAT_STRUCT);
+  if (err_code) {
+    return err_code;
+  }
+
+  // add batch size
+  err_code = ferris_add_normal_characteristic(p_ferris_service, &(p_ferris_service->batch_size_char_handle),
+                                              &p_ferris_service->batch_size, 1,
+                                              ((uint16_t)('B') << 8) + 'N',
+                                              char_batch_size_desc, sizeof(char_batch_size_desc), false,
+                                              BLE_GATT_CPF_FORMAT_UINT8);
+  if (err_code) {
+    return err_code;
+  }
+
+  // add tx counters
+  err_code = ferris_add_normal_characteristic(p_ferris_service, &(p_ferris_service->tx_stats_char_handle),
+                                              (uint8_t *)(&p_ferris_service->tx_stats), sizeof(ferris_tx_stats_t),
+                                              ((uint16_t)('T') << 8) + 'X',
+                                              char_tx_stats_desc, sizeof(char_tx_stats_desc), true,
+                                              BLE_GATT_CPF_FORMAT_STRUCT);
+  if (err_code) {
+    return err_code;
+  }
+
+  // add offline log bulk transfer
+  if (p_ferris_service->log_enabled) {
+    err_code = ferris_add_notify_characteristic(p_ferris_service, &(p_ferris_service->log_char_handle),
+                                                NULL, 0, BULK_FRAME_MAX_LEN,
+                                                0x6053, char_log_desc, sizeof(char_log_desc), false);
+    if (err_code) {
+      return err_code;
+    }
+
+    err_code = ferris_add_notify_characteristic(p_ferris_service, &(p_ferris_service->bulk_cp_char_handle),
+                                                NULL, 0, FERRIS_BULK_RSP_MAX_LEN,
+                                                0x6054, char_bulk_cp_desc, sizeof(char_bulk_cp_desc), true);
+    if (err_code) {
+      return err_code;
+    }
+  }
+
   // add sample_interval
   err_code = ferris_add_normal_characteristic(p_ferris_service, &(p_ferris_service->sample_interval_char_handle),
                                               (uint8_t *)(&p_ferris_service->sample_interval), 2,
@@ -190,65 +764,244 @@ uint32_t ferris_service_init(ferris_service_t *p_ferris_service, ferris_service_
       return err_code;
     }
   }
+  // add power state diagnostics
+  if (p_ferris_service->p_energy != NULL) {
+    err_code = ferris_add_normal_characteristic(p_ferris_service, &(p_ferris_service->energy_char_handle),
+                                                (uint8_t *)(p_ferris_service->p_energy), sizeof(ferris_energy_t),
+                                                ((uint16_t)('D') << 8) + 'G',
+                                                char_energy_desc, sizeof(char_energy_desc), true,
+                                                BLE_GATT_CPF_FORMAT_STRUCT);
+    if (err_code) {
+      return err_code;
+    }
+  }
+  // add sample path timing
+  if (p_ferris_service->p_profile != NULL) {
+    err_code = ferris_add_normal_characteristic(p_ferris_service, &(p_ferris_service->profile_char_handle),
+                                                (uint8_t *)(p_ferris_service->p_profile), sizeof(ferris_profile_t),
+                                                ((uint16_t)('P') << 8) + 'F',
+                                                char_profile_desc, sizeof(char_profile_desc), true,
+                                                BLE_GATT_CPF_FORMAT_STRUCT);
+    if (err_code) {
+      return err_code;
+    }
+  }
 
   return 0;
 }
-void decode_acc(uint8_t *p_value, float *p_acc) {
-  for (int i = 0; i < 3; i++) {
-    p_acc[i] = ((float)((int16_t)uint16_big_decode(p_value + i * 2))) / 32768 * 20;
+// the angle policy runs on whichever pair FERRIS_FIXED_POINT selects
+#if FERRIS_FIXED_POINT
+#define decode_acc ferris_orientation_decode
+#define cross_product_length ferris_orientation_change
+#else
+#define decode_acc ferris_orientation_decode_float
+#define cross_product_length ferris_orientation_change_float
+#endif
+
+// sin(angle) * 4096 for angle in 1/100 degree, 0 to 9000. Taylor series to the 5th power, within 0.5 %.
+static uint32_t policy_sin_q12(uint16_t angle) {
+  int32_t x  = ((int32_t)angle * 46851) >> 16; // 1/100 degree to rad * 4096
+  int32_t x2 = (x * x) >> 12;
+  int32_t x3 = (x2 * x) >> 12;
+  int32_t x5 = (x3 * x2) >> 12;
+  return x - x3 / 6 + x5 / 120;
+}
+
+// Clamp what the client wrote and derive the angle threshold.
+static void policy_apply(ferris_service_t *p_ferris_service, uint8_t previous_mode) {
+  ferris_policy_t *p_policy = &p_ferris_service->policy;
+
+  if (p_policy->mode >= FERRIS_POLICY_COUNT) {
+    p_policy->mode = previous_mode;
   }
+  p_policy->heartbeat = MIN(p_policy->heartbeat, INT16_MAX);
+  p_policy->angle     = MAX(1, MIN(p_policy->angle, 9000));
+
+  uint32_t sin_q12 = policy_sin_q12(p_policy->angle);
+#if FERRIS_FIXED_POINT
+  // reduced vectors have 1g = 4096, so |U x V|^2 = (4096 * sin)^2
+  p_ferris_service->angle_threshold = sin_q12 * sin_q12;
+#else
+  // 1g = 10, so |U x V|^2 = (100 * sin)^2
+  p_ferris_service->angle_threshold = (100.0f * sin_q12 / 4096) * (100.0f * sin_q12 / 4096);
+#endif
 }
 
-float cross_product_length(float U[3], float V[3]) {
-  float x = U[1] * V[2] - U[2] * V[1];
-  float y = U[2] * V[0] - V[2] * U[0];
-  float z = U[0] * V[1] - U[1] * V[0];
-  return x * x + y * y + z * z;
+static void policy_default(ferris_service_t *p_ferris_service) {
+  ferris_policy_t *p_policy = &p_ferris_service->policy;
+
+  memset(p_policy, 0, sizeof(*p_policy));
+  p_policy->mode      = FERRIS_POLICY_ANGLE;
+  p_policy->follow_up = 4;
+  p_policy->heartbeat = 5 * 10;
+  p_policy->angle     = 169; // what the fixed threshold of the first releases amounts to
+  p_policy->magnitude = 16384 / 20;
+  for (int axis = 0; axis < 3; axis++) {
+    p_policy->deadband[axis] = 16384 / 20;
+  }
+  policy_apply(p_ferris_service, FERRIS_POLICY_ANGLE);
+  p_ferris_service->policy_mode = FERRIS_POLICY_ANGLE;
+#if FERRIS_FIXED_POINT
+  p_ferris_service->angle_threshold = FERRIS_ORIENTATION_THRESHOLD;
+#endif
 }
 
-uint32_t ferris_acceleration_send(ferris_service_t *p_ferris_service) {
-  ble_gatts_hvx_params_t hvx_params;
+#if FERRIS_FIXED_POINT
+static bool policy_triggered(ferris_service_t *p_ferris_service, int16_t acc[3], int16_t const raw[3]) {
+#else
+static bool policy_triggered(ferris_service_t *p_ferris_service, float acc[3], int16_t const raw[3]) {
+#endif
+  ferris_policy_t const *p_policy = &p_ferris_service->policy;
+  int16_t const *last             = p_ferris_service->last_report_raw;
+
+  switch (p_policy->mode) {
+  case FERRIS_POLICY_ANGLE:
+    return cross_product_length(acc, p_ferris_service->last_report_acc) > p_ferris_service->angle_threshold;
+
+  case FERRIS_POLICY_MAGNITUDE: {
+    // quarter resolution keeps the squared length in uint32
+    uint32_t length = 0;
+    for (int axis = 0; axis < 3; axis++) {
+      int32_t d = ((int32_t)raw[axis] - last[axis]) >> 2;
+      length += d * d;
+    }
+    uint32_t threshold = p_policy->magnitude >> 2;
+    return length > threshold * threshold;
+  }
+
+  case FERRIS_POLICY_DEADBAND:
+    for (int axis = 0; axis < 3; axis++) {
+      int32_t d = (int32_t)raw[axis] - last[axis];
+      if ((d < 0 ? -d : d) > p_policy->deadband[axis]) {
+        return true;
+      }
+    }
+    return false;
 
+  default:
+    return true;
+  }
+}
+
+// Feed the position estimator and publish once per speed window, if a TX buffer is free.
+static void tilt_update(ferris_service_t *p_ferris_service, uint32_t timestamp) {
+  int16_t acc[3];
+  uint8_t value[FERRIS_TILT_VALUE_SIZE];
+
+  for (int axis = 0; axis < 3; axis++) {
+    acc[axis] = (int16_t)uint16_big_decode(p_ferris_service->p_acceleration_data + axis * 2);
+  }
+  if (ferris_tilt_update(&p_ferris_service->tilt, acc, (uint16_t)(timestamp >> 5)) && p_ferris_service->tx_free > 0) {
+    ferris_tilt_encode(&p_ferris_service->tilt, value);
+    tx_notify(p_ferris_service, p_ferris_service->tilt_char_handle.value_handle, value, sizeof(value));
+  }
+}
+
+uint32_t ferris_acceleration_send(ferris_service_t *p_ferris_service, uint32_t timestamp) {
   if (p_ferris_service == NULL) {
     return 0;
   }
 
-  if ((p_ferris_service->conn_handle == BLE_CONN_HANDLE_INVALID) || (!p_ferris_service->acceleration_notification)) {
+  bool logging  = p_ferris_service->log_enabled && p_ferris_service->conn_handle == BLE_CONN_HANDLE_INVALID;
+  bool batching = p_ferris_service->batch_notification || p_ferris_service->codec_notification;
+  bool single   = p_ferris_service->acceleration_notification || p_ferris_service->acc_timed_notification;
+  if (!logging && ((p_ferris_service->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+                   (!single && !batching && !p_ferris_service->tilt_notification))) {
     return NRF_ERROR_INVALID_STATE;
   }
 
-  // Skip report if the rotated angle is too low
+  if (p_ferris_service->tilt_notification) {
+    tilt_update(p_ferris_service, timestamp);
+    if (!single && !batching) {
+      return NRF_SUCCESS;
+    }
+  }
+
+  // Skip the report unless the policy sees a change
+#if FERRIS_FIXED_POINT
+  int16_t acc[3];
+#else
   float acc[3];
+#endif
+  int16_t raw[3];
   decode_acc(p_ferris_service->p_acceleration_data, acc);
-  bool large_angle = cross_product_length(acc, p_ferris_service->last_report_acc) > 10 * 10 * 0.08715574274765817;
+  for (int axis = 0; axis < 3; axis++) {
+    raw[axis] = (int16_t)uint16_big_decode(p_ferris_service->p_acceleration_data + axis * 2);
+  }
+  ferris_policy_t const *p_policy = &p_ferris_service->policy;
 
-  if (large_angle) {
-    // We send some more acceleration value after a big rotate
-    p_ferris_service->mandatory_report_remain = 4;
+  bool triggered = policy_triggered(p_ferris_service, acc, raw);
+  if (triggered) {
+    // We send some more acceleration value after a big change
+    p_ferris_service->mandatory_report_remain = p_policy->follow_up;
   }
 
-  // We skip report if angle change is not large
-  if (p_ferris_service->mandatory_report_remain <= 0 && !large_angle && p_ferris_service->skiped_report < 5 * 10) {
-    p_ferris_service->skiped_report++;
+  uint32_t quiet = timestamp - p_ferris_service->last_report_time;
+  bool due       = (p_policy->heartbeat != 0 && p_ferris_service->skiped_report >= p_policy->heartbeat) ||
+             (p_policy->max_latency_ms != 0 && quiet >= APP_TIMER_TICKS(p_policy->max_latency_ms, 0));
+
+  if (p_ferris_service->mandatory_report_remain <= 0 && !triggered && !due) {
+    if (p_ferris_service->skiped_report < INT16_MAX) {
+      p_ferris_service->skiped_report++;
+    }
     return 0;
   }
 
-  if (p_ferris_service->mandatory_report_remain) {
+  if (p_ferris_service->mandatory_report_remain > 0) {
     p_ferris_service->mandatory_report_remain--;
   }
-  p_ferris_service->skiped_report = 0;
+  p_ferris_service->skiped_report    = 0;
+  p_ferris_service->last_report_time = timestamp;
 
   memcpy(p_ferris_service->last_report_acc, acc, sizeof(acc));
+  memcpy(p_ferris_service->last_report_raw, raw, sizeof(raw));
 
-  // send notification
-  memset(&hvx_params, 0, sizeof(hvx_params));
+  if (logging) {
+    ferris_codec_sample_t sample;
+    sample.timestamp = (uint16_t)(timestamp >> 5); // 32768 Hz ticks to 1/1024 s
+    for (int axis = 0; axis < 3; axis++) {
+      sample.acc[axis] = (int16_t)uint16_big_decode(p_ferris_service->p_acceleration_data + axis * 2);
+    }
+    return ferris_log_append(&sample);
+  }
 
-  hvx_params.handle = p_ferris_service->acc_char_handle.value_handle;
-  hvx_params.p_data = p_ferris_service->p_acceleration_data;
-  hvx_params.p_len  = (uint16_t *)&acc_data_len;
-  hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+  if (batching) {
+    batch_push(p_ferris_service, timestamp);
+  }
+  if (single) {
+    acc_queue_push(p_ferris_service, timestamp);
+  }
+
+  uint32_t err_code = tx_pump(p_ferris_service);
+  // out of buffers is not an error here, the samples wait for BLE_EVT_TX_COMPLETE
+  return err_code == BLE_ERROR_NO_TX_PACKETS ? NRF_SUCCESS : err_code;
+}
+
+bool ferris_acceleration_wanted(ferris_service_t const *p_ferris_service) {
+  if (p_ferris_service->conn_handle == BLE_CONN_HANDLE_INVALID) {
+    return p_ferris_service->log_enabled;
+  }
+  return p_ferris_service->acceleration_notification || p_ferris_service->acc_timed_notification ||
+         p_ferris_service->batch_notification || p_ferris_service->codec_notification ||
+         p_ferris_service->tilt_notification;
+}
 
-  return sd_ble_gatts_hvx(p_ferris_service->conn_handle, &hvx_params);
+uint32_t ferris_motion_send(ferris_service_t *p_ferris_service, uint8_t const *p_gyro, uint8_t const *p_temp) {
+  uint32_t err_code = NRF_SUCCESS;
+
+  if (p_ferris_service->conn_handle == BLE_CONN_HANDLE_INVALID) {
+    return NRF_ERROR_INVALID_STATE;
+  }
+  // a stale rate is worth nothing, the queued acceleration goes first
+  if (p_ferris_service->gyro_notification && p_ferris_service->tx_free > 0) {
+    err_code = tx_notify(p_ferris_service, p_ferris_service->gyro_char_handle.value_handle,
+                         (uint8_t *)p_gyro, 6);
+  }
+  if (err_code == NRF_SUCCESS && p_ferris_service->temp_notification && p_ferris_service->tx_free > 0) {
+    err_code = tx_notify(p_ferris_service, p_ferris_service->temp_char_handle.value_handle,
+                         (uint8_t *)p_temp, 2);
+  }
+  return err_code == BLE_ERROR_NO_TX_PACKETS ? NRF_SUCCESS : err_code;
 }
 
 /**@brief Function for handling the @ref BLE_GAP_EVT_CONNECTED event from the S110 SoftDevice.
@@ -258,6 +1011,28 @@ uint32_t ferris_acceleration_send(ferris_service_t *p_ferris_service) {
  */
 static void on_connect(ferris_service_t *p_ferris_service, ble_evt_t *p_ble_evt) {
   p_ferris_service->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+  p_ferris_service->tx_free     = tx_packet_count(p_ferris_service);
+
+  if (p_ferris_service->log_enabled) {
+    // the samples of the last motion go to flash before the client can ask for them
+    ferris_log_flush();
+  }
+}
+
+/**@brief Function for handling the @ref BLE_EVT_TX_COMPLETE event from the S110 SoftDevice.
+ *
+ * @details BLE events are pulled from the main loop, the queues are refilled right here.
+ *
+ * @param[in] p_ferris_service     Ferris Service structure.
+ * @param[in] p_ble_evt Pointer to the event received from BLE stack.
+ */
+static void on_tx_complete(ferris_service_t *p_ferris_service, ble_evt_t *p_ble_evt) {
+  if (p_ferris_service->conn_handle == BLE_CONN_HANDLE_INVALID) {
+    return;
+  }
+  uint16_t tx_free          = p_ferris_service->tx_free + p_ble_evt->evt.common_evt.params.tx_complete.count;
+  p_ferris_service->tx_free = MIN(tx_free, tx_packet_count(p_ferris_service));
+  tx_pump(p_ferris_service);
 }
 
 /**@brief Function for handling the @ref BLE_GAP_EVT_DISCONNECTED event from the S110 SoftDevice.
@@ -266,7 +1041,116 @@ static void on_connect(ferris_service_t *p_ferris_service, ble_evt_t *p_ble_evt)
  * @param[in] p_ble_evt Pointer to the event received from BLE stack.
  */
 static void on_disconnect(ferris_service_t *p_ferris_service, ble_evt_t *p_ble_evt) {
-  p_ferris_service->conn_handle = BLE_CONN_HANDLE_INVALID;
+  if (p_ferris_service->bulk_active) {
+    // the next transfer resumes after what the client acknowledged
+    bulk_stop(p_ferris_service, false);
+  }
+  if (p_ferris_service->gyro_notification || p_ferris_service->temp_notification) {
+    p_ferris_service->gyro_notification = false;
+    p_ferris_service->temp_notification = false;
+    ferris_evt_send(p_ferris_service, FERRIS_EVT_CHANNELS_UPDATED);
+  }
+  p_ferris_service->conn_handle               = BLE_CONN_HANDLE_INVALID;
+  p_ferris_service->acceleration_notification = false;
+  p_ferris_service->acc_timed_notification    = false;
+  p_ferris_service->time_sync_notification    = false;
+  p_ferris_service->time_sync_pending         = false;
+  p_ferris_service->tilt_notification         = false;
+  p_ferris_service->batch_notification        = false;
+  p_ferris_service->codec_notification        = false;
+  p_ferris_service->log_notification          = false;
+  p_ferris_service->bulk_cp_notification      = false;
+  p_ferris_service->bulk_rsp_len              = 0;
+  p_ferris_service->batch_max_len             = BLE_GATT_ATT_MTU_DEFAULT - 3;
+  p_ferris_service->tx_free                   = 0;
+  batch_reset(p_ferris_service);
+  acc_queue_reset(p_ferris_service);
+}
+
+/**@brief Handle a write to the bulk transfer control point.
+ *
+ * @param[in] p_ferris_service     Ferris Service structure.
+ * @param[in] p_data               Written value, opcode first.
+ * @param[in] len                  Length of the written value.
+ */
+static void on_bulk_cp_write(ferris_service_t *p_ferris_service, uint8_t const *p_data, uint16_t len) {
+  uint16_t seq;
+
+  if (len == 0) {
+    return;
+  }
+
+  switch (p_data[0]) {
+  case FERRIS_BULK_OP_START:
+    if (len == 5) {
+      uint8_t rsp[10] = {FERRIS_BULK_RSP_START, FERRIS_BULK_STATUS_OK};
+      if (!p_ferris_service->log_notification) {
+        rsp[1] = FERRIS_BULK_STATUS_NOT_SUBSCRIBED;
+        bulk_respond(p_ferris_service, rsp, sizeof(rsp));
+        break;
+      }
+      uint32_t pos = uint32_decode(p_data + 1);
+      if (pos == 0) {
+        pos = ferris_log_checkpoint_get();
+      }
+      pos = MAX(pos, ferris_log_begin());
+
+      p_ferris_service->bulk_active       = true;
+      p_ferris_service->bulk_seq          = 0;
+      p_ferris_service->bulk_acked        = 0;
+      p_ferris_service->bulk_pos          = pos;
+      p_ferris_service->bulk_resend_count = 0;
+
+      uint32_encode(pos, rsp + 2);
+      uint32_encode(ferris_log_end(), rsp + 6);
+      bulk_respond(p_ferris_service, rsp, sizeof(rsp));
+      ferris_evt_send(p_ferris_service, FERRIS_EVT_BULK_STARTED);
+    }
+    break;
+
+  case FERRIS_BULK_OP_ACK:
+    if (len == 3 && p_ferris_service->bulk_active) {
+      seq = uint16_decode(p_data + 1);
+      if ((uint16_t)(seq - p_ferris_service->bulk_acked) <= (uint16_t)(p_ferris_service->bulk_seq - p_ferris_service->bulk_acked)) {
+        p_ferris_service->bulk_acked = seq;
+      }
+    }
+    break;
+
+  case FERRIS_BULK_OP_NACK:
+    if (len == 3 && p_ferris_service->bulk_active && p_ferris_service->bulk_resend_count < FERRIS_BULK_RESEND_SIZE) {
+      seq = uint16_decode(p_data + 1);
+      p_ferris_service->bulk_resend[p_ferris_service->bulk_resend_count++] = seq;
+    }
+    break;
+
+  case FERRIS_BULK_OP_STOP:
+    if (p_ferris_service->bulk_active) {
+      bulk_stop(p_ferris_service, false);
+    }
+    break;
+  }
+
+  tx_pump(p_ferris_service);
+}
+
+/**@brief Handle a time sync request, T1 is taken right away.
+ *
+ * @param[in] p_ferris_service     Ferris Service structure.
+ * @param[in] p_data               Written value, the client time T0.
+ * @param[in] len                  Length of the written value.
+ */
+static void on_time_sync_write(ferris_service_t *p_ferris_service, uint8_t const *p_data, uint16_t len) {
+  uint32_t t1 = ferris_time_now();
+
+  if (len != FERRIS_TIME_SYNC_REQ_SIZE || !p_ferris_service->time_sync_notification) {
+    return;
+  }
+  // a newer request replaces one still waiting, the client matches responses by T0
+  memcpy(p_ferris_service->time_sync_rsp, p_data, FERRIS_TIME_SYNC_REQ_SIZE);
+  uint32_encode(t1, p_ferris_service->time_sync_rsp + 4);
+  p_ferris_service->time_sync_pending = true;
+  tx_pump(p_ferris_service);
 }
 
 /**@brief Function for handling the @ref BLE_GATTS_EVT_WRITE event from the S110 SoftDevice.
@@ -276,6 +1160,7 @@ static void on_disconnect(ferris_service_t *p_ferris_service, ble_evt_t *p_ble_e
  */
 static void on_write(ferris_service_t *p_ferris_service, ble_evt_t *p_ble_evt) {
   ble_gatts_evt_write_t *p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+  bool wanted                        = ferris_acceleration_wanted(p_ferris_service);
 
   if (
       (p_evt_write->handle == p_ferris_service->acc_char_handle.cccd_handle) &&
@@ -286,11 +1171,106 @@ static void on_write(ferris_service_t *p_ferris_service, ble_evt_t *p_ble_evt) {
       p_ferris_service->skiped_report             = 0;
     } else {
       p_ferris_service->acceleration_notification = false;
+      if (!p_ferris_service->acc_timed_notification) {
+        acc_queue_reset(p_ferris_service);
+      }
+    }
+  } else if ( // timestamped acceleration
+      (p_evt_write->handle == p_ferris_service->acc_timed_char_handle.cccd_handle) &&
+      (p_evt_write->len == 2)) {
+    if (ble_srv_is_notification_enabled(p_evt_write->data)) {
+      p_ferris_service->acc_timed_notification  = true;
+      p_ferris_service->mandatory_report_remain = 5;
+      p_ferris_service->skiped_report           = 0;
+    } else {
+      p_ferris_service->acc_timed_notification = false;
+      if (!p_ferris_service->acceleration_notification) {
+        acc_queue_reset(p_ferris_service);
+      }
+    }
+  } else if ( // time sync
+      (p_evt_write->handle == p_ferris_service->time_sync_char_handle.cccd_handle) &&
+      (p_evt_write->len == 2)) {
+    p_ferris_service->time_sync_notification = ble_srv_is_notification_enabled(p_evt_write->data);
+  } else if (p_evt_write->handle == p_ferris_service->time_sync_char_handle.value_handle) {
+    on_time_sync_write(p_ferris_service, p_evt_write->data, p_evt_write->len);
+  } else if ( // wheel position and speed
+      (p_evt_write->handle == p_ferris_service->tilt_char_handle.cccd_handle) &&
+      (p_evt_write->len == 2)) {
+    p_ferris_service->tilt_notification = ble_srv_is_notification_enabled(p_evt_write->data);
+    ferris_tilt_reset(&p_ferris_service->tilt);
+  } else if ( // rotation rate
+      (p_evt_write->handle == p_ferris_service->gyro_char_handle.cccd_handle) &&
+      (p_evt_write->len == 2)) {
+    p_ferris_service->gyro_notification = ble_srv_is_notification_enabled(p_evt_write->data);
+    ferris_evt_send(p_ferris_service, FERRIS_EVT_CHANNELS_UPDATED);
+  } else if ( // temperature
+      (p_evt_write->handle == p_ferris_service->temp_char_handle.cccd_handle) &&
+      (p_evt_write->len == 2)) {
+    p_ferris_service->temp_notification = ble_srv_is_notification_enabled(p_evt_write->data);
+    ferris_evt_send(p_ferris_service, FERRIS_EVT_CHANNELS_UPDATED);
+  } else if ( // batched acceleration
+      (p_evt_write->handle == p_ferris_service->batch_char_handle.cccd_handle) &&
+      (p_evt_write->len == 2)) {
+    if (ble_srv_is_notification_enabled(p_evt_write->data)) {
+      p_ferris_service->batch_notification      = true;
+      p_ferris_service->mandatory_report_remain = 5;
+      p_ferris_service->skiped_report           = 0;
+    } else {
+      p_ferris_service->batch_notification = false;
+      if (!p_ferris_service->codec_notification) {
+        batch_reset(p_ferris_service);
+      }
+    }
+  } else if ( // compressed acceleration
+      (p_evt_write->handle == p_ferris_service->codec_char_handle.cccd_handle) &&
+      (p_evt_write->len == 2)) {
+    if (ble_srv_is_notification_enabled(p_evt_write->data)) {
+      p_ferris_service->codec_notification      = true;
+      p_ferris_service->mandatory_report_remain = 5;
+      p_ferris_service->skiped_report           = 0;
+      ferris_codec_encoder_reset(&p_ferris_service->codec);
+    } else {
+      p_ferris_service->codec_notification = false;
+      if (!p_ferris_service->batch_notification) {
+        batch_reset(p_ferris_service);
+      }
     }
+  } else if ( // offline log bulk data
+      (p_evt_write->handle == p_ferris_service->log_char_handle.cccd_handle) &&
+      (p_evt_write->len == 2)) {
+    p_ferris_service->log_notification = ble_srv_is_notification_enabled(p_evt_write->data);
+    if (!p_ferris_service->log_notification && p_ferris_service->bulk_active) {
+      bulk_stop(p_ferris_service, false);
+    }
+  } else if ( // offline log bulk control point
+      (p_evt_write->handle == p_ferris_service->bulk_cp_char_handle.cccd_handle) &&
+      (p_evt_write->len == 2)) {
+    p_ferris_service->bulk_cp_notification = ble_srv_is_notification_enabled(p_evt_write->data);
+  } else if (p_evt_write->handle == p_ferris_service->bulk_cp_char_handle.value_handle) {
+    on_bulk_cp_write(p_ferris_service, p_evt_write->data, p_evt_write->len);
+  } else if ( // report suppression policy
+      (p_evt_write->handle == p_ferris_service->policy_char_handle.value_handle)) {
+    // Read back the clamped policy to learn what is applied.
+    policy_apply(p_ferris_service, p_ferris_service->policy_mode);
+    p_ferris_service->policy_mode = p_ferris_service->policy.mode;
+  } else if ( // batch size
+      (p_evt_write->handle == p_ferris_service->batch_size_char_handle.value_handle) &&
+      (p_evt_write->len == 1)) {
+    // Read back the clamped value to learn what was negotiated.
+    p_ferris_service->batch_size = batch_samples_per_packet(p_ferris_service);
   } else if ( // sample_interval
       (p_evt_write->handle == p_ferris_service->sample_interval_char_handle.value_handle) &&
       (p_evt_write->len == 2)) {
     p_ferris_service->sample_interval = *((uint16_t *)p_evt_write->data);
+    if (p_ferris_service->evt_handler != NULL) {
+      ferris_evt_t evt = {.evt_type = FERRIS_EVT_SAMPLE_INTERVAL_UPDATED};
+      p_ferris_service->evt_handler(p_ferris_service, &evt);
+    }
+  }
+
+  if (ferris_acceleration_wanted(p_ferris_service) != wanted) {
+    ferris_evt_send(p_ferris_service, FERRIS_EVT_DEMAND_UPDATED);
   }
 }
 
@@ -312,6 +1292,17 @@ void ferris_on_ble_evt(ferris_service_t *p_ferris_service, ble_evt_t *p_ble_evt)
     on_write(p_ferris_service, p_ble_evt);
     break;
 
+  case BLE_EVT_TX_COMPLETE:
+    on_tx_complete(p_ferris_service, p_ble_evt);
+    break;
+
+#if (NRF_SD_BLE_API_VERSION == 3)
+  case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
+    p_ferris_service->batch_max_len = MIN(p_ble_evt->evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu,
+                                          NRF_BLE_MAX_MTU_SIZE) - 3;
+    break;
+#endif
+
   default:
     // No implementation needed.
     break;
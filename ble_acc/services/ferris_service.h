@@ -6,11 +6,123 @@
 
 #include "ble.h"
 #include "ble_gatts.h"
+#include "ferris_codec.h"
+#include "ferris_energy.h"
+#include "ferris_log.h"
+#include "ferris_profile.h"
+#include "ferris_tilt.h"
+#include "ferris_time.h"
+
+// Report suppression arithmetic.
+// 1: integer cross product on raw samples (no soft-float calls on Cortex-M0).
+// 0: original float implementation.
+#ifndef FERRIS_FIXED_POINT
+#define FERRIS_FIXED_POINT 1
+#endif
+
+#define FERRIS_BATCH_SAMPLE_SIZE 8   /**< Bytes per batched sample, {T_L, T_H, X_H, X_L, Y_H, Y_L, Z_H, Z_L}. */
+#define FERRIS_BATCH_RING_SIZE 32    /**< Samples waiting for a batch notification. */
+#define FERRIS_BATCH_DEADLINE_MS 1000 /**< Max time a sample waits for its batch to fill. */
+#if (NRF_SD_BLE_API_VERSION == 3)
+#define FERRIS_BATCH_MAX_LEN (NRF_BLE_MAX_MTU_SIZE - 3)
+#else
+#define FERRIS_BATCH_MAX_LEN (BLE_GATT_ATT_MTU_DEFAULT - 3)
+#endif
+
+#define FERRIS_TX_QUEUE_SIZE 8 /**< Single sample notifications waiting for a SoftDevice buffer. */
+#define FERRIS_TIMED_SAMPLE_SIZE 10 /**< Bytes per timestamped sample, {T:4, X_H, X_L, Y_H, Y_L, Z_H, Z_L}, T little endian. */
+
+// Time sync, NTP style. The client writes any 4 byte value T0 (its own clock) to 0x6059 and gets
+// {T0:4, T1:4, T2:4} back as a notification of 0x6059, T1 the device time when the write arrived
+// and T2 the device time when the response was handed to the SoftDevice, see ferris_time.h.
+// With T3 the client time when the response arrived, the device clock is ahead of the client
+// clock by ((T1 - T0) + (T2 - T3)) / 2, give or take half the round trip asymmetry. Writes and
+// notifications only move at connection events, so that asymmetry is up to a connection interval:
+// repeat the exchange and keep the one with the shortest (T3 - T0) - (T2 - T1).
+#define FERRIS_TIME_SYNC_REQ_SIZE 4
+#define FERRIS_TIME_SYNC_RSP_SIZE 12
+
+// Bulk transfer of the offline log.
+// Data frames on 0x6053 are {SEQ_L, SEQ_H, record}. The client drives the transfer with the
+// control point 0x6054, responses come back as notifications of the control point.
+#define FERRIS_BULK_WINDOW 16     /**< Frames sent but not acknowledged. */
+#define FERRIS_BULK_RESEND_SIZE 4 /**< Retransmit requests waiting for a TX buffer. */
+#define FERRIS_BULK_FRAME_HEADER_SIZE 2
+#define FERRIS_BULK_RSP_MAX_LEN 10
+
+typedef enum {
+  FERRIS_BULK_OP_START = 0x01, /**< {POS:4}, send from POS, 0 resumes from the checkpoint. */
+  FERRIS_BULK_OP_ACK   = 0x02, /**< {SEQ:2}, every frame before SEQ was received. */
+  FERRIS_BULK_OP_NACK  = 0x03, /**< {SEQ:2}, send frame SEQ again. */
+  FERRIS_BULK_OP_STOP  = 0x04, /**< Stop, the acknowledged part becomes the checkpoint. */
+  FERRIS_BULK_RSP_START = 0x81, /**< {STATUS, POS:4, END:4}, first and end log position. */
+  FERRIS_BULK_RSP_DONE  = 0x82, /**< {END:4}, everything was acknowledged, END is the new checkpoint. */
+} ferris_bulk_op_t;
+
+#define FERRIS_BULK_STATUS_OK 0x00
+#define FERRIS_BULK_STATUS_NOT_SUBSCRIBED 0x01 /**< Subscribe to the data stream first. */
+
+typedef struct {
+  uint16_t timestamp; /**< Capture time in 1/1024 s, wraps every 64 s. */
+  uint8_t acc[6];
+} ferris_batch_sample_t;
+
+/**@brief What makes a sample worth reporting. */
+typedef enum {
+  FERRIS_POLICY_ANGLE     = 0, /**< The direction turned by more than angle. */
+  FERRIS_POLICY_MAGNITUDE = 1, /**< The vector moved by more than magnitude. */
+  FERRIS_POLICY_DEADBAND  = 2, /**< An axis moved by more than its deadband. */
+  FERRIS_POLICY_ALL       = 3, /**< Every sample. */
+  FERRIS_POLICY_COUNT,
+} ferris_policy_mode_t;
+
+/**@brief Report suppression policy, written by the client as it is laid out here (little endian).
+ *
+ * @details A triggering sample is reported together with the follow_up samples after it.
+ *          heartbeat and max_latency_ms bound how long a still wheel stays silent.
+ *          Acceleration is in raw LSB, 16384 = 1g.
+ */
+typedef struct {
+  uint8_t mode;            /**< ferris_policy_mode_t. */
+  uint8_t follow_up;       /**< Samples reported after a triggering one. */
+  uint16_t heartbeat;      /**< Report after this many skipped samples, 0 never, at most INT16_MAX. */
+  uint16_t angle;          /**< ANGLE threshold in 1/100 degree, 1 to 9000. */
+  uint16_t magnitude;      /**< MAGNITUDE threshold in raw LSB. */
+  uint16_t deadband[3];    /**< DEADBAND threshold per axis in raw LSB. */
+  uint16_t max_latency_ms; /**< Report at least this often, 0 never. */
+} ferris_policy_t;
+
+/**@brief Transmit counters, readable by the client as they are laid out here (little endian). */
+typedef struct {
+  uint32_t packets_sent;  /**< Notifications accepted by the SoftDevice. */
+  uint32_t acc_dropped;   /**< Single sample notifications overwritten in the TX queue, or whose other half was sent alone. */
+  uint32_t batch_dropped; /**< Samples overwritten because the batch ring was full. */
+} ferris_tx_stats_t;
+
+typedef enum {
+  FERRIS_EVT_SAMPLE_INTERVAL_UPDATED, /**< The client wrote sample_interval. */
+  FERRIS_EVT_BULK_STARTED,            /**< A bulk transfer started, a short connection interval helps. */
+  FERRIS_EVT_BULK_STOPPED,            /**< The bulk transfer finished or was stopped. */
+  FERRIS_EVT_CHANNELS_UPDATED,        /**< Gyro or temperature subscription changed, see gyro_notification and temp_notification. */
+  FERRIS_EVT_DEMAND_UPDATED,          /**< ferris_acceleration_wanted() changed with a subscription. */
+} ferris_evt_type_t;
 
 typedef struct {
+  ferris_evt_type_t evt_type;
+} ferris_evt_t;
+
+typedef struct ferris_service_s ferris_service_t;
+
+#define FERRIS_SCHED_EVENT_SIZE sizeof(ferris_service_t *) /**< Size of the events the service puts in app_scheduler. */
+
+/**@brief Ferris Service event handler type. Called from the BLE event handler. */
+typedef void (*ferris_evt_handler_t)(ferris_service_t *p_ferris_service, ferris_evt_t *p_evt);
+
+struct ferris_service_s {
   uint8_t uuid_type;       /**< UUID type for Ferris Service Base UUID. */
   uint16_t service_handle; /**< Handle of Ferris Service (as provided by the BLE stack). */
   uint16_t conn_handle;
+  ferris_evt_handler_t evt_handler;
 
   // sample interval
   uint16_t sample_interval;
@@ -18,27 +130,140 @@ typedef struct {
   int16_t skiped_report;
   int16_t mandatory_report_remain;
 
+  // report suppression
+  ferris_policy_t policy;
+  ble_gatts_char_handles_t policy_char_handle;
+  uint8_t policy_mode; /**< Mode in use, restored when the client writes an unknown one. */
+#if FERRIS_FIXED_POINT
+  uint32_t angle_threshold; /**< policy.angle as |U x V|^2 of reduced vectors. */
+#else
+  float angle_threshold;
+#endif
+  int16_t last_report_raw[3];
+  uint32_t last_report_time;
+
   // battery voltage
   uint16_t *p_battery_voltage;
   ble_gatts_char_handles_t battery_voltage_handle;
 
+  // power state diagnostics
+  ferris_energy_t *p_energy;
+  ble_gatts_char_handles_t energy_char_handle;
+  ferris_profile_t *p_profile;
+  ble_gatts_char_handles_t profile_char_handle;
+
   // acceleration
   uint8_t *p_acceleration_data;
   ble_gatts_char_handles_t acc_char_handle;
   bool acceleration_notification;
+  ble_gatts_char_handles_t acc_timed_char_handle;
+  bool acc_timed_notification;
+  uint8_t acc_queue[FERRIS_TX_QUEUE_SIZE][FERRIS_TIMED_SAMPLE_SIZE]; /**< Timestamped samples waiting for a free SoftDevice buffer. */
+  uint8_t acc_queue_head;
+  uint8_t acc_queue_count;
+#if FERRIS_FIXED_POINT
+  int16_t last_report_acc[3];
+#else
   float last_report_acc[3];
+#endif
+
+  // rotation rate and temperature, only powered while subscribed
+  ble_gatts_char_handles_t gyro_char_handle;
+  bool gyro_notification;
+  ble_gatts_char_handles_t temp_char_handle;
+  bool temp_notification;
 
-} ferris_service_t;
+  // wheel position and speed, published every FERRIS_TILT_PERIOD_MS instead of every sample
+  ble_gatts_char_handles_t tilt_char_handle;
+  bool tilt_notification;
+  ferris_tilt_t tilt;
+
+  // time sync
+  ble_gatts_char_handles_t time_sync_char_handle;
+  bool time_sync_notification;
+  uint8_t time_sync_rsp[FERRIS_TIME_SYNC_RSP_SIZE]; /**< Response waiting for a TX buffer, T2 is set when it is sent. */
+  bool time_sync_pending;
+
+  // batched acceleration
+  ble_gatts_char_handles_t batch_char_handle;
+  bool batch_notification;
+  uint8_t batch_size; /**< Samples per notification, written by the client and clamped to the ATT payload. */
+  ble_gatts_char_handles_t batch_size_char_handle;
+  uint16_t batch_max_len; /**< ATT payload of the current connection. */
+  ferris_batch_sample_t batch_ring[FERRIS_BATCH_RING_SIZE];
+  uint8_t batch_head;
+  uint8_t batch_count;
+  bool batch_timer_running;
+  bool batch_deadline; /**< The deadline passed, send partial batches until the ring is empty. */
+
+  // compressed acceleration, drains the batch ring instead of the batch characteristic when subscribed
+  ble_gatts_char_handles_t codec_char_handle;
+  bool codec_notification;
+  ferris_codec_encoder_t codec;
+
+  // flow control, notifications are only handed to the SoftDevice while it has free buffers
+  uint8_t tx_free; /**< Free SoftDevice TX buffers, refilled by BLE_EVT_TX_COMPLETE. */
+  ferris_tx_stats_t tx_stats;
+  ble_gatts_char_handles_t tx_stats_char_handle;
+
+  // offline log, samples go to flash while no central is connected
+  bool log_enabled;
+  ble_gatts_char_handles_t log_char_handle; /**< Bulk data stream. */
+  bool log_notification;
+  ble_gatts_char_handles_t bulk_cp_char_handle;
+  bool bulk_cp_notification;
+  bool bulk_active;
+  uint16_t bulk_seq;                         /**< SEQ of the next new frame. */
+  uint16_t bulk_acked;                       /**< Every frame before this SEQ was received. */
+  uint32_t bulk_pos;                         /**< Log position of the next new frame. */
+  uint32_t bulk_window[FERRIS_BULK_WINDOW];  /**< Log position of the frames in flight, by SEQ. */
+  uint16_t bulk_resend[FERRIS_BULK_RESEND_SIZE];
+  uint8_t bulk_resend_count;
+  uint8_t bulk_rsp[FERRIS_BULK_RSP_MAX_LEN]; /**< Control point response waiting for a TX buffer. */
+  uint8_t bulk_rsp_len;
+};
 
 typedef struct {
   uint8_t *p_acceleration_data;
   uint16_t *p_battery_voltage;
+  ferris_energy_t *p_energy; /**< Diagnostics kept up to date by the application, NULL for none. */
+  ferris_profile_t *p_profile; /**< Hot path timing kept up to date by the application, NULL for none. */
+  ferris_evt_handler_t evt_handler;
+  bool log_enabled; /**< Log samples to flash while disconnected, needs the SoftDevice enabled. */
 } ferris_service_init_t;
 
 uint32_t ferris_service_init(ferris_service_t *p_ferris_service, ferris_service_init_t *p_ferris_service_init);
 
 void ferris_on_ble_evt(ferris_service_t *p_nus, ble_evt_t *p_ble_evt);
 
-uint32_t ferris_acceleration_send(ferris_service_t *p_ferris_service);
+/**@brief Report the sample in p_acceleration_data, unless the suppression filter skips it.
+ *
+ * @details The sample is queued and sent as soon as the SoftDevice has a free TX buffer. When
+ *          the queue is full the oldest sample is dropped and counted in tx_stats.
+ *          Every sample, reported or not, feeds the wheel position estimator.
+ *          While disconnected the sample goes to the offline log, if enabled.
+ *
+ * @param[in] p_ferris_service Ferris Service structure.
+ * @param[in] timestamp        Capture time, ferris_time_now() when the sample was taken.
+ */
+uint32_t ferris_acceleration_send(ferris_service_t *p_ferris_service, uint32_t timestamp);
+
+/**@brief Whether ferris_acceleration_send() has a use for samples: a client is subscribed to
+ *        acceleration in any form, or the offline log takes them while disconnected.
+ *
+ * @details Changes on connect and disconnect, and with subscriptions, which emit
+ *          FERRIS_EVT_DEMAND_UPDATED.
+ */
+bool ferris_acceleration_wanted(ferris_service_t const *p_ferris_service);
+
+/**@brief Notify rotation rate and temperature to the clients subscribed to them.
+ *
+ * @details Latest value only: without a free TX buffer the values are not sent.
+ *
+ * @param[in] p_ferris_service Ferris Service structure.
+ * @param[in] p_gyro           Rotation rate, {X_H, X_L, Y_H, Y_L, Z_H, Z_L}.
+ * @param[in] p_temp           Temperature, {T_H, T_L}.
+ */
+uint32_t ferris_motion_send(ferris_service_t *p_ferris_service, uint8_t const *p_gyro, uint8_t const *p_temp);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include <string.h>
+
+#include "ferris_tilt.h"
+
+#define TILT_PERIOD_TICKS ((FERRIS_TILT_PERIOD_MS * 1024UL) / 1000) // in 1/1024 s
+#define TILT_MAX_GAP (4 * TILT_PERIOD_TICKS) // longer without samples, the wheel was standing still
+#define CORDIC_SHIFT 4 // extra precision bits of the CORDIC vector
+
+// atan(2^-i) in 1/65536 turn
+static const uint16_t cordic_atan[] = {8192, 4836, 2555, 1297, 651, 326, 163, 81, 41, 20, 10, 5, 3, 1};
+
+uint16_t ferris_tilt_atan2(int16_t y, int16_t x) {
+  int32_t xi     = x;
+  int32_t yi     = y;
+  uint16_t angle = 0;
+
+  // CORDIC converges within +-99 degrees, start from the right half plane
+  if (xi < 0) {
+    xi    = -xi;
+    yi    = -yi;
+    angle = 32768;
+  }
+  xi <<= CORDIC_SHIFT;
+  yi <<= CORDIC_SHIFT;
+
+  // rotate the vector onto the x axis, summing up the rotation
+  for (unsigned i = 0; i < sizeof(cordic_atan) / sizeof(cordic_atan[0]); i++) {
+    int32_t xn;
+    if (yi > 0) {
+      xn = xi + (yi >> i);
+      yi = yi - (xi >> i);
+      angle += cordic_atan[i];
+    } else {
+      xn = xi - (yi >> i);
+      yi = yi + (xi >> i);
+      angle -= cordic_atan[i];
+    }
+    xi = xn;
+  }
+  return angle;
+}
+
+void ferris_tilt_reset(ferris_tilt_t *p_tilt) {
+  memset(p_tilt, 0, sizeof(*p_tilt));
+}
+
+static void window_start(ferris_tilt_t *p_tilt, uint16_t time) {
+  p_tilt->window_position = p_tilt->position;
+  p_tilt->window_time     = time;
+}
+
+bool ferris_tilt_update(ferris_tilt_t *p_tilt, int16_t const acc[3], uint16_t time) {
+  int16_t u = acc[FERRIS_TILT_AXIS_U];
+  int16_t v = acc[FERRIS_TILT_AXIS_V];
+
+  if ((u < 0 ? -u : u) + (v < 0 ? -v : v) < FERRIS_TILT_MIN_PLANE) {
+    return false; // the next usable sample unwraps against the last angle
+  }
+  // gravity turns against the wheel
+  uint16_t angle = -ferris_tilt_atan2(v, u);
+
+  if (!p_tilt->valid) {
+    p_tilt->valid     = true;
+    p_tilt->position  = angle;
+    p_tilt->last_time = time;
+    p_tilt->rpm       = 0;
+    window_start(p_tilt, time);
+    return false;
+  }
+
+  // shortest way from the last angle, the wheel turns less than half a turn between samples
+  p_tilt->position += (int16_t)(angle - (uint16_t)p_tilt->position);
+
+  if ((uint16_t)(time - p_tilt->last_time) > TILT_MAX_GAP) {
+    // acquisition was stopped, the speed before says nothing about now
+    p_tilt->last_time = time;
+    p_tilt->rpm       = 0;
+    window_start(p_tilt, time);
+    return true;
+  }
+  p_tilt->last_time = time;
+
+  uint16_t dt = time - p_tilt->window_time;
+  if (dt < TILT_PERIOD_TICKS) {
+    return false;
+  }
+
+  // 1/65536 turn per 1/1024 s to 1/100 rpm: * 1024 * 60 * 100 / 65536 = * 375 / 4
+  int32_t rpm = (int32_t)(((int64_t)(p_tilt->position - p_tilt->window_position) * 375) / (4 * (int32_t)dt));
+  rpm         = rpm > INT16_MAX ? INT16_MAX : (rpm < INT16_MIN ? INT16_MIN : rpm);
+  // average with the last window, a sample jitters by a few degrees
+  p_tilt->rpm = (int16_t)((p_tilt->rpm + rpm) / 2);
+  window_start(p_tilt, time);
+  return true;
+}
+
+void ferris_tilt_encode(ferris_tilt_t const *p_tilt, uint8_t *p_data) {
+  uint32_t position = (uint32_t)p_tilt->position;
+  uint16_t rpm      = (uint16_t)p_tilt->rpm;
+
+  p_data[0] = (uint8_t)position;
+  p_data[1] = (uint8_t)(position >> 8);
+  p_data[2] = (uint8_t)(position >> 16);
+  p_data[3] = (uint8_t)(position >> 24);
+  p_data[4] = (uint8_t)rpm;
+  p_data[5] = (uint8_t)(rpm >> 8);
+}
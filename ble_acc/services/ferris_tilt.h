@@ -0,0 +1,71 @@
+#ifndef FERRIS_TILT_H
+#define FERRIS_TILT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @file
+ * @brief Wheel angle and rotation speed from the gravity vector, integer only.
+ *
+ * The sensor turns with the wheel, so gravity turns the other way in the wheel plane. The
+ * angle is atan2 of the two acceleration axes in that plane, computed with CORDIC, in
+ * 1/65536 turn. Consecutive angles are unwrapped into a cumulative position, which is
+ * valid as long as the wheel turns less than half a turn between two samples.
+ *
+ * Published value, little endian: {POSITION:4, RPM:2}
+ *   POSITION  int32, cumulative angle in 1/65536 turn, the low 16 bits are the angle.
+ *   RPM       int16, rotation speed in 1/100 rpm, positive counterclockwise.
+ *
+ * Like the codec, the estimator does not depend on the SDK.
+ */
+
+#define FERRIS_TILT_AXIS_U 0            /**< First axis in the wheel plane, X. */
+#define FERRIS_TILT_AXIS_V 1            /**< Second axis in the wheel plane, Y. The axle is along Z. */
+#define FERRIS_TILT_MIN_PLANE 2048      /**< |U| + |V| below this (1/8 g) means the axle points up, no angle. */
+#define FERRIS_TILT_PERIOD_MS 1000      /**< Speed window and publish period. */
+#define FERRIS_TILT_VALUE_SIZE 6
+
+typedef struct {
+  bool valid;               /**< position is set. */
+  int32_t position;         /**< Cumulative angle in 1/65536 turn. */
+  int32_t window_position;  /**< position at the start of the speed window. */
+  uint16_t window_time;     /**< Start of the speed window in 1/1024 s. */
+  uint16_t last_time;       /**< Time of the last angle. */
+  int16_t rpm;              /**< Rotation speed in 1/100 rpm, filtered. */
+} ferris_tilt_t;
+
+/**
+ * @brief atan2(y, x) in 1/65536 turn, 0 along +x, counterclockwise.
+ */
+uint16_t ferris_tilt_atan2(int16_t y, int16_t x);
+
+/**
+ * @brief Forget the position, the next sample starts over.
+ */
+void ferris_tilt_reset(ferris_tilt_t *p_tilt);
+
+/**
+ * @brief Feed one acceleration sample.
+ *
+ * @param[in,out] p_tilt Estimator.
+ * @param[in]     acc    Raw acceleration, X, Y, Z.
+ * @param[in]     time   Capture time in 1/1024 s.
+ *
+ * @return true once a speed window of FERRIS_TILT_PERIOD_MS completed and rpm was updated.
+ */
+bool ferris_tilt_update(ferris_tilt_t *p_tilt, int16_t const acc[3], uint16_t time);
+
+/**
+ * @brief Encode the published value, FERRIS_TILT_VALUE_SIZE bytes.
+ */
+void ferris_tilt_encode(ferris_tilt_t const *p_tilt, uint8_t *p_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "ferris_time.h"
+
+#define RTC_COUNTER_BITS 24
+
+static uint32_t m_high; // wraps counted so far, in the upper 8 bits
+static uint32_t m_last; // last 24 bit counter value seen
+
+uint32_t ferris_time_now(void) {
+  uint32_t now;
+
+  CRITICAL_REGION_ENTER();
+  app_timer_cnt_get(&now);
+  if (now < m_last) {
+    m_high += 1UL << RTC_COUNTER_BITS;
+  }
+  m_last = now;
+  now |= m_high;
+  CRITICAL_REGION_EXIT();
+
+  return now;
+}
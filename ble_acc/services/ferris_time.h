@@ -0,0 +1,29 @@
+#ifndef FERRIS_TIME_H
+#define FERRIS_TIME_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @file
+ * @brief Device time: RTC1 ticks (32768 Hz, APP_TIMER_PRESCALER 0) extended from 24 to 32 bit.
+ *
+ * Sample timestamps and the time sync characteristic use this time base. It wraps after
+ * about 36 hours. The 24 bit counter wraps every 512 s, so ferris_time_now() must be called
+ * more often than that to count the wraps, a repeated app_timer is enough.
+ */
+
+#define FERRIS_TIME_TICKS_PER_SECOND 32768
+
+/**
+ * @brief Current device time. Safe to call from interrupts.
+ */
+uint32_t ferris_time_now(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,12 +15,22 @@ SRC_FILES += \
   $(SDK_ROOT)/components/drivers_nrf/adc/nrf_drv_adc.c \
   $(SDK_ROOT)/components/drivers_nrf/clock/nrf_drv_clock.c \
   $(SDK_ROOT)/components/drivers_nrf/common/nrf_drv_common.c \
+  $(SDK_ROOT)/components/drivers_nrf/gpiote/nrf_drv_gpiote.c \
+  $(SDK_ROOT)/components/drivers_nrf/timer/nrf_drv_timer.c \
   $(SDK_ROOT)/components/drivers_nrf/twi_master/nrf_drv_twi.c \
   $(SDK_ROOT)/components/drivers_nrf/uart/nrf_drv_uart.c \
   $(SDK_ROOT)/components/ble/ble_services/ble_bas/ble_bas.c \
   $(PROJ_DIR)/main.c \
   $(PROJ_DIR)/driver/mpu6050.c \
+  $(PROJ_DIR)/driver/battery.c \
   $(PROJ_DIR)/services/ferris_service.c \
+  $(PROJ_DIR)/services/ferris_codec.c \
+  $(PROJ_DIR)/services/ferris_log.c \
+  $(PROJ_DIR)/services/ferris_orientation.c \
+  $(PROJ_DIR)/services/ferris_tilt.c \
+  $(PROJ_DIR)/services/ferris_time.c \
+  $(PROJ_DIR)/services/ferris_energy.c \
+  $(PROJ_DIR)/services/ferris_profile.c \
   $(SDK_ROOT)/components/ble/common/ble_conn_params.c \
   $(SDK_ROOT)/components/ble/common/ble_conn_state.c \
   $(SDK_ROOT)/components/ble/common/ble_advdata.c \
@@ -32,6 +42,7 @@ SRC_FILES += \
   $(SDK_ROOT)/components/toolchain/gcc/gcc_startup_nrf51.S \
   $(SDK_ROOT)/components/toolchain/system_nrf51.c \
   $(SDK_ROOT)/components/softdevice/common/softdevice_handler/softdevice_handler.c \
+  $(SDK_ROOT)/components/softdevice/common/softdevice_handler/softdevice_handler_appsh.c \
 
 # Include folders common to all targets
 INC_FOLDERS += \
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "battery.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#define ROUNDS 20000
+#define CODE_FIRST 700 // readings sweep the discharge curve, where the cell spends its life
+#define CODE_COUNT 200
+
+// Cost of one battery update, level and voltage, against the linear walk and the double
+// conversion of the first releases, then with the filter and the hysteresis update_battery() runs. On the nRF51 the double conversion is a soft-float call,
+// so the gap there is wider than on the host.
+
+static const uint16_t reference_table[] = {569, 606, 642, 676, 703, 722, 732, 740, 747, 753, 759, 764, 769, 773, 776, 780, 783, 785, 788, 790, 792, 794, 796, 798, 800, 801, 803, 804, 805, 807, 808, 809, 810, 811, 812, 813, 814, 815, 816, 817, 818, 819, 820, 820, 821, 822, 823, 823, 824, 825, 825, 826, 827, 827, 828, 829, 829, 830, 830, 831, 831, 832, 833, 833, 834, 834, 835, 835, 836, 836, 837, 837, 838, 838, 839, 839, 840, 840, 841, 842, 842, 843, 843, 844, 844, 844, 845, 845, 845, 845, 846, 846, 846, 847, 847, 848, 849, 850, 851, 853, 876, 907, 937, 967, 996, 1023};
+
+static volatile uint32_t m_sink; // keeps the results alive
+
+static void update_reference(uint16_t raw) {
+  uint8_t level = 0;
+  while (level < sizeof(reference_table) / sizeof(uint16_t) && reference_table[level] <= raw) {
+    level++;
+  }
+  m_sink += level + (uint16_t)(raw * 3600.0 / 1024);
+}
+
+static void lookup_integer(uint16_t raw) {
+  m_sink += battery_level_get(raw) + battery_raw_to_mv(raw);
+}
+
+static void update_integer(uint16_t raw) {
+  static battery_level_t battery;
+  static battery_filter_t filter;
+  uint16_t filtered = battery_filter_update(&filter, raw);
+
+  battery_level_update(&battery, battery_filtered_to_raw(filtered));
+  m_sink += battery.level + battery_filtered_to_mv(filtered);
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Per update, best of 5, over a shuffled sweep so the search exit is not predictable.
+static void run(char const *p_name, void (*update)(uint16_t)) {
+  double best_ns = 1e18;
+#if HAVE_TSC
+  double best_ticks = 1e18;
+#endif
+
+  for (int repeat = 0; repeat < 5; repeat++) {
+    double start = now_ns();
+#if HAVE_TSC
+    unsigned long long ticks = __rdtsc();
+#endif
+    for (int round = 0; round < ROUNDS; round++) {
+      for (uint16_t i = 0; i < CODE_COUNT; i++) {
+        update((uint16_t)(CODE_FIRST + (i * 73) % CODE_COUNT));
+      }
+    }
+    double ns = (now_ns() - start) / ((double)ROUNDS * CODE_COUNT);
+    best_ns   = ns < best_ns ? ns : best_ns;
+#if HAVE_TSC
+    double t   = (double)(__rdtsc() - ticks) / ((double)ROUNDS * CODE_COUNT);
+    best_ticks = t < best_ticks ? t : best_ticks;
+#endif
+  }
+#if HAVE_TSC
+  printf("%s: %.2f ns, %.1f TSC cycles per update\n", p_name, best_ns, best_ticks);
+#else
+  printf("%s: %.2f ns per update\n", p_name, best_ns);
+#endif
+}
+
+int main(void) {
+  run("linear walk, double", update_reference);
+  run("binary search, integer", lookup_integer);
+  run("with filter and hysteresis", update_integer);
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ferris_codec.h"
+#include "ferris_decoder.hpp"
+
+#define PACKET_SIZE 20
+#define SAMPLE_COUNT 1000000
+#define ROUNDS 5
+
+// Decoding throughput of the compressed acceleration stream, best of ROUNDS.
+int main() {
+  std::vector<ferris_codec_sample_t> samples(SAMPLE_COUNT);
+  std::vector<std::vector<uint8_t> > packets;
+  ferris_codec_encoder_t enc = {};
+  size_t bytes               = 0;
+
+  srand(4);
+  for (size_t i = 0; i < samples.size(); i++) {
+    double a = i * 0.002;
+
+    samples[i].timestamp = (uint16_t)(i * 1024 / 400); // 400 Hz
+    samples[i].acc[0]    = (int16_t)(16000 * cos(a) + rand() % 32 - 16);
+    samples[i].acc[1]    = (int16_t)(16000 * sin(a) + rand() % 32 - 16);
+    samples[i].acc[2]    = (int16_t)(rand() % 100 - 50);
+  }
+  ferris_codec_encoder_reset(&enc);
+  for (size_t pos = 0; pos < samples.size();) {
+    size_t left = samples.size() - pos;
+    std::vector<uint8_t> p(PACKET_SIZE);
+    uint16_t len;
+    bool full;
+    uint8_t n =
+        ferris_codec_encode(&enc, &samples[pos], left > UINT8_MAX ? UINT8_MAX : (uint8_t)left, p.data(), PACKET_SIZE,
+                            &len, &full);
+
+    p.resize(len);
+    ferris_codec_encoder_commit(&enc, &samples[pos + n - 1]);
+    packets.push_back(p);
+    bytes += len;
+    pos += n;
+  }
+
+  double best = 1e9;
+  std::vector<ferris::sample> out;
+  out.reserve(samples.size());
+  for (int round = 0; round < ROUNDS; round++) {
+    ferris::decoder dec;
+
+    out.clear();
+    auto start = std::chrono::steady_clock::now();
+    for (std::vector<uint8_t> const &p : packets) {
+      dec.feed(p.data(), p.size(), out);
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (out.size() != samples.size()) {
+      fprintf(stderr, "decoded %zu of %zu samples\n", out.size(), samples.size());
+      return 1;
+    }
+    if (s < best) {
+      best = s;
+    }
+  }
+
+  printf("%zu samples in %zu packets, %.2f bytes per sample\n", samples.size(), packets.size(),
+         (double)bytes / samples.size());
+  printf("decode: %.1f M samples/s, %.1f MB/s, %.1f ns per sample\n", samples.size() / best / 1e6, bytes / best / 1e6,
+         best * 1e9 / samples.size());
+  return 0;
+}
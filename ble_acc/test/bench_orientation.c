@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ferris_orientation.h"
+
+#define SAMPLE_COUNT 4096 // power of 2
+#define ROUNDS 2000
+
+// Report decision of ferris_acceleration_send() on both paths, decode included, best of 5.
+// On the host the FPU makes the float path cheap. On the nRF51 every float operation is a
+// soft-float call: compare the FERRIS_PROFILE_SEND stage of a make FERRIS_FIXED_POINT=0 build.
+
+static uint8_t m_values[SAMPLE_COUNT][6];
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double run_fixed(uint32_t *p_reports) {
+  double best = 1e18;
+
+  for (int repeat = 0; repeat < 5; repeat++) {
+    uint32_t reports = 0;
+    int16_t last[3]  = {0, 0, 16384};
+    double start     = now_ns();
+
+    for (int round = 0; round < ROUNDS; round++) {
+      for (int i = 0; i < SAMPLE_COUNT; i++) {
+        int16_t acc[3];
+        ferris_orientation_decode(m_values[i], acc);
+        if (ferris_orientation_change(acc, last) > FERRIS_ORIENTATION_THRESHOLD) {
+          last[0] = acc[0];
+          last[1] = acc[1];
+          last[2] = acc[2];
+          reports++;
+        }
+      }
+    }
+    double ns = (now_ns() - start) / ((double)ROUNDS * SAMPLE_COUNT);
+    best      = ns < best ? ns : best;
+    *p_reports = reports;
+  }
+  return best;
+}
+
+static double run_float(uint32_t *p_reports) {
+  double best = 1e18;
+
+  for (int repeat = 0; repeat < 5; repeat++) {
+    uint32_t reports = 0;
+    float last[3]    = {0, 0, 10};
+    double start     = now_ns();
+
+    for (int round = 0; round < ROUNDS; round++) {
+      for (int i = 0; i < SAMPLE_COUNT; i++) {
+        float acc[3];
+        ferris_orientation_decode_float(m_values[i], acc);
+        if (ferris_orientation_change_float(acc, last) > FERRIS_ORIENTATION_THRESHOLD_FLOAT) {
+          last[0] = acc[0];
+          last[1] = acc[1];
+          last[2] = acc[2];
+          reports++;
+        }
+      }
+    }
+    double ns = (now_ns() - start) / ((double)ROUNDS * SAMPLE_COUNT);
+    best      = ns < best ? ns : best;
+    *p_reports = reports;
+  }
+  return best;
+}
+
+int main(void) {
+  uint32_t fixed_reports, float_reports;
+
+  srand(7);
+  for (int i = 0; i < SAMPLE_COUNT; i++) {
+    for (int j = 0; j < 6; j++) {
+      m_values[i][j] = (uint8_t)rand();
+    }
+  }
+
+  double fixed_ns = run_fixed(&fixed_reports);
+  double float_ns = run_float(&float_reports);
+
+  printf("fixed: %.2f ns per sample, %u reports\n", fixed_ns, fixed_reports);
+  printf("float: %.2f ns per sample, %u reports\n", float_ns, float_reports);
+  return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef APP_SCHEDULER_H__
+#define APP_SCHEDULER_H__
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name, implemented by fake_sched.c.
+ */
+
+typedef void (*app_sched_event_handler_t)(void *p_event_data, uint16_t event_size);
+
+uint32_t app_sched_event_put(void const *p_event_data, uint16_t event_size, app_sched_event_handler_t handler);
+void app_sched_execute(void);
+uint16_t app_sched_queue_space_get(void);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef APP_TIMER_H__
+#define APP_TIMER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "app_util.h"
+#include "sdk_errors.h"
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name, implemented by fake_timer.c.
+ *        Timers run on the clock of fake_time.h, fake_timer_advance() fires them.
+ */
+
+#define APP_TIMER_CLOCK_FREQ 32768
+#define APP_TIMER_MIN_TIMEOUT_TICKS 5
+
+#define APP_TIMER_TICKS(MS, PRESCALER) \
+  ((uint32_t)ROUNDED_DIV((MS) * (uint64_t)APP_TIMER_CLOCK_FREQ, 1000 * ((PRESCALER) + 1)))
+
+typedef void (*app_timer_timeout_handler_t)(void *p_context);
+
+typedef enum {
+  APP_TIMER_MODE_SINGLE_SHOT,
+  APP_TIMER_MODE_REPEATED,
+} app_timer_mode_t;
+
+typedef struct app_timer_s {
+  struct app_timer_s *p_next; // created timers
+  app_timer_timeout_handler_t handler;
+  app_timer_mode_t mode;
+  bool running;
+  uint32_t expiry;
+  uint32_t period;
+  void *p_context;
+} app_timer_t;
+
+typedef app_timer_t *app_timer_id_t;
+
+#define APP_TIMER_DEF(timer_id)                \
+  static app_timer_t timer_id##_data = {NULL}; \
+  static const app_timer_id_t timer_id = &timer_id##_data
+
+uint32_t app_timer_create(app_timer_id_t const *p_timer_id, app_timer_mode_t mode,
+                          app_timer_timeout_handler_t timeout_handler);
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *p_context);
+uint32_t app_timer_stop(app_timer_id_t timer_id);
+uint32_t app_timer_cnt_get(uint32_t *p_ticks);
+
+#endif
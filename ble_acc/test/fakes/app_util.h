@@ -0,0 +1,55 @@
+#ifndef APP_UTIL_H__
+#define APP_UTIL_H__
+
+#include <stdint.h>
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name.
+ */
+
+#define STATIC_ASSERT(EXPR) _Static_assert(EXPR, #EXPR)
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
+
+#define ROUNDED_DIV(A, B) (((A) + ((B) / 2)) / (B))
+#define CEIL_DIV(A, B) (((A) + (B) - 1) / (B))
+
+static inline uint8_t uint16_encode(uint16_t value, uint8_t *p_encoded_data) {
+  p_encoded_data[0] = (uint8_t)(value & 0x00FF);
+  p_encoded_data[1] = (uint8_t)((value & 0xFF00) >> 8);
+  return sizeof(uint16_t);
+}
+
+static inline uint8_t uint16_big_encode(uint16_t value, uint8_t *p_encoded_data) {
+  p_encoded_data[0] = (uint8_t)(value >> 8);
+  p_encoded_data[1] = (uint8_t)(value & 0xFF);
+  return sizeof(uint16_t);
+}
+
+static inline uint8_t uint32_encode(uint32_t value, uint8_t *p_encoded_data) {
+  p_encoded_data[0] = (uint8_t)(value & 0xFF);
+  p_encoded_data[1] = (uint8_t)((value >> 8) & 0xFF);
+  p_encoded_data[2] = (uint8_t)((value >> 16) & 0xFF);
+  p_encoded_data[3] = (uint8_t)(value >> 24);
+  return sizeof(uint32_t);
+}
+
+static inline uint16_t uint16_decode(const uint8_t *p_encoded_data) {
+  return (uint16_t)(p_encoded_data[0] | (p_encoded_data[1] << 8));
+}
+
+static inline uint16_t uint16_big_decode(const uint8_t *p_encoded_data) {
+  return (uint16_t)((p_encoded_data[0] << 8) | p_encoded_data[1]);
+}
+
+static inline uint32_t uint32_decode(const uint8_t *p_encoded_data) {
+  return (uint32_t)p_encoded_data[0] | ((uint32_t)p_encoded_data[1] << 8) |
+         ((uint32_t)p_encoded_data[2] << 16) | ((uint32_t)p_encoded_data[3] << 24);
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name.
+ *
+ * There is no interrupt to mask on the host. Interrupts the fakes raise (see fake_twi.h) are
+ * held while a critical region is open and run when the outermost one is left, as the NVIC
+ * would.
+ */
+
+#define APP_IRQ_PRIORITY_HIGHEST 0
+#define APP_IRQ_PRIORITY_HIGH 1
+#define APP_IRQ_PRIORITY_MID 2
+#define APP_IRQ_PRIORITY_LOW 3
+#define APP_IRQ_PRIORITY_LOWEST 3
+
+void fake_critical_region_enter(void);
+void fake_critical_region_exit(void);
+
+#define CRITICAL_REGION_ENTER() fake_critical_region_enter()
+#define CRITICAL_REGION_EXIT() fake_critical_region_exit()
+
+#endif
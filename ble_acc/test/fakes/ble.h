@@ -0,0 +1,51 @@
+#ifndef BLE_H__
+#define BLE_H__
+
+#include <stdint.h>
+
+#include "ble_gap.h"
+#include "ble_gatts.h"
+#include "ble_types.h"
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name, implemented by fake_ble.c.
+ */
+
+#define NRF_BLE_MAX_MTU_SIZE BLE_GATT_ATT_MTU_DEFAULT
+
+enum {
+  BLE_EVT_TX_COMPLETE = 0x01,
+  BLE_GAP_EVT_CONNECTED = 0x10,
+  BLE_GAP_EVT_DISCONNECTED = 0x11,
+  BLE_GATTS_EVT_WRITE = 0x50,
+};
+
+typedef struct {
+  uint8_t count;
+} ble_evt_tx_complete_t;
+
+typedef struct {
+  uint16_t conn_handle;
+  union {
+    ble_evt_tx_complete_t tx_complete;
+  } params;
+} ble_common_evt_t;
+
+typedef struct {
+  uint16_t evt_id;
+  uint16_t evt_len;
+} ble_evt_hdr_t;
+
+typedef struct {
+  ble_evt_hdr_t header;
+  union {
+    ble_common_evt_t common_evt;
+    ble_gap_evt_t gap_evt;
+    ble_gatts_evt_t gatts_evt;
+  } evt;
+} ble_evt_t;
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const *p_vs_uuid, uint8_t *p_uuid_type);
+uint32_t sd_ble_tx_packet_count_get(uint16_t conn_handle, uint8_t *p_count);
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef BLE_GATTS_H__
+#define BLE_GATTS_H__
+
+#include <stdint.h>
+
+#include "ble_gap.h"
+#include "ble_types.h"
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name, implemented by fake_ble.c.
+ */
+
+#define BLE_GATT_ATT_MTU_DEFAULT 23
+#define BLE_GATT_HVX_NOTIFICATION 0x01
+#define BLE_GATT_HVX_INDICATION 0x02
+
+#define BLE_GATT_CPF_FORMAT_UINT8 0x04
+#define BLE_GATT_CPF_FORMAT_UINT16 0x06
+#define BLE_GATT_CPF_FORMAT_STRUCT 0x1B
+
+#define BLE_GATTS_SRVC_TYPE_PRIMARY 0x01
+#define BLE_GATTS_VLOC_STACK 0x01
+#define BLE_GATTS_VLOC_USER 0x02
+
+#define BLE_GATTS_OP_WRITE_REQ 0x01
+#define BLE_GATTS_OP_WRITE_CMD 0x02
+
+typedef struct {
+  uint8_t broadcast : 1;
+  uint8_t read : 1;
+  uint8_t write_wo_resp : 1;
+  uint8_t write : 1;
+  uint8_t notify : 1;
+  uint8_t indicate : 1;
+  uint8_t auth_signed_wr : 1;
+} ble_gatt_char_props_t;
+
+typedef struct {
+  uint8_t format;
+  int8_t exponent;
+  uint16_t unit;
+  uint8_t name_space;
+  uint16_t desc;
+} ble_gatts_char_pf_t;
+
+typedef struct {
+  ble_gap_conn_sec_mode_t read_perm;
+  ble_gap_conn_sec_mode_t write_perm;
+  uint8_t vlen : 1;
+  uint8_t vloc : 2;
+  uint8_t rd_auth : 1;
+  uint8_t wr_auth : 1;
+} ble_gatts_attr_md_t;
+
+typedef struct {
+  ble_uuid_t const *p_uuid;
+  ble_gatts_attr_md_t const *p_attr_md;
+  uint16_t init_len;
+  uint16_t init_offs;
+  uint16_t max_len;
+  uint8_t *p_value;
+} ble_gatts_attr_t;
+
+typedef struct {
+  ble_gatt_char_props_t char_props;
+  uint8_t char_ext_props;
+  uint8_t *p_char_user_desc;
+  uint16_t char_user_desc_max_size;
+  uint16_t char_user_desc_size;
+  ble_gatts_char_pf_t const *p_char_pf;
+  ble_gatts_attr_md_t const *p_user_desc_md;
+  ble_gatts_attr_md_t const *p_cccd_md;
+  ble_gatts_attr_md_t const *p_sccd_md;
+} ble_gatts_char_md_t;
+
+typedef struct {
+  uint16_t value_handle;
+  uint16_t user_desc_handle;
+  uint16_t cccd_handle;
+  uint16_t sccd_handle;
+} ble_gatts_char_handles_t;
+
+typedef struct {
+  uint16_t handle;
+  uint8_t type;
+  uint16_t offset;
+  uint16_t *p_len;
+  uint8_t const *p_data;
+} ble_gatts_hvx_params_t;
+
+typedef struct {
+  uint16_t handle;
+  ble_uuid_t uuid;
+  uint8_t op;
+  uint8_t auth_required;
+  uint16_t offset;
+  uint16_t len;
+  uint8_t data[1]; /**< Written data, len bytes. */
+} ble_gatts_evt_write_t;
+
+typedef struct {
+  uint16_t conn_handle;
+  union {
+    ble_gatts_evt_write_t write;
+  } params;
+} ble_gatts_evt_t;
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const *p_uuid, uint16_t *p_handle);
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle, ble_gatts_char_md_t const *p_char_md,
+                                         ble_gatts_attr_t const *p_attr_char_value,
+                                         ble_gatts_char_handles_t *p_handles);
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const *p_hvx_params);
+
+#endif
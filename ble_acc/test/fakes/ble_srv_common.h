@@ -0,0 +1,17 @@
+#ifndef BLE_SRV_COMMON_H__
+#define BLE_SRV_COMMON_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ble.h"
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name.
+ */
+
+static inline bool ble_srv_is_notification_enabled(uint8_t const *p_encoded_data) {
+  return (p_encoded_data[0] & BLE_GATT_HVX_NOTIFICATION) != 0;
+}
+
+#endif
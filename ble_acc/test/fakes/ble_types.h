@@ -0,0 +1,34 @@
+#ifndef BLE_TYPES_H__
+#define BLE_TYPES_H__
+
+#include <stdint.h>
+
+#include "nrf_error.h"
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name.
+ */
+
+#define BLE_CONN_HANDLE_INVALID 0xFFFF
+#define BLE_GATT_HANDLE_INVALID 0x0000
+
+#define BLE_ERROR_NOT_ENABLED (NRF_ERROR_STK_BASE_NUM + 0x001)
+#define BLE_ERROR_INVALID_CONN_HANDLE (NRF_ERROR_STK_BASE_NUM + 0x002)
+#define BLE_ERROR_INVALID_ATTR_HANDLE (NRF_ERROR_STK_BASE_NUM + 0x003)
+#define BLE_ERROR_NO_TX_PACKETS (NRF_ERROR_STK_BASE_NUM + 0x004)
+#define BLE_ERROR_GATTS_SYS_ATTR_MISSING (NRF_ERROR_STK_BASE_NUM + 0x401)
+
+#define BLE_UUID_TYPE_UNKNOWN 0x00
+#define BLE_UUID_TYPE_BLE 0x01
+#define BLE_UUID_TYPE_VENDOR_BEGIN 0x02
+
+typedef struct {
+  uint8_t uuid128[16];
+} ble_uuid128_t;
+
+typedef struct {
+  uint16_t uuid;
+  uint8_t type;
+} ble_uuid_t;
+
+#endif
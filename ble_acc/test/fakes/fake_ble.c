@@ -0,0 +1,234 @@
+#include <string.h>
+
+#include "app_util.h"
+#include "ble_srv_common.h"
+#include "fake_ble.h"
+
+#define CHAR_COUNT 32
+
+typedef struct {
+  uint16_t uuid;
+  ble_gatts_char_handles_t handles;
+  bool notify;
+  uint8_t *p_value; // user memory attribute, NULL in the stack
+  uint16_t max_len;
+  uint8_t cccd[2];
+} attr_char_t;
+
+static attr_char_t m_chars[CHAR_COUNT];
+static uint8_t m_char_count;
+static uint16_t m_next_handle;
+
+static uint16_t m_conn_handle;
+static uint8_t m_tx_packets;
+static uint8_t m_tx_in_flight;
+static uint32_t m_no_tx_packets;
+
+static fake_ble_notification_t m_log[FAKE_BLE_NOTIFICATION_LOG];
+static uint16_t m_log_head;
+static uint16_t m_log_count;
+
+// room for the written data behind the event
+static union {
+  ble_evt_t evt;
+  uint8_t buf[sizeof(ble_evt_t) + BLE_GATT_ATT_MTU_DEFAULT];
+} m_evt;
+
+void fake_ble_reset(uint8_t tx_packets) {
+  memset(m_chars, 0, sizeof(m_chars));
+  m_char_count   = 0;
+  m_next_handle  = 1;
+  m_conn_handle  = BLE_CONN_HANDLE_INVALID;
+  m_tx_packets   = tx_packets;
+  m_tx_in_flight = 0;
+  m_no_tx_packets = 0;
+  m_log_head     = 0;
+  m_log_count    = 0;
+}
+
+static attr_char_t *char_by_handle(uint16_t handle) {
+  for (uint8_t i = 0; i < m_char_count; i++) {
+    if (m_chars[i].handles.value_handle == handle || m_chars[i].handles.cccd_handle == handle) {
+      return &m_chars[i];
+    }
+  }
+  return NULL;
+}
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const *p_vs_uuid, uint8_t *p_uuid_type) {
+  *p_uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN;
+  return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const *p_uuid, uint16_t *p_handle) {
+  *p_handle = m_next_handle++;
+  return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle, ble_gatts_char_md_t const *p_char_md,
+                                         ble_gatts_attr_t const *p_attr_char_value,
+                                         ble_gatts_char_handles_t *p_handles) {
+  if (m_char_count == CHAR_COUNT) {
+    return NRF_ERROR_NO_MEM;
+  }
+  attr_char_t *p_char = &m_chars[m_char_count++];
+
+  memset(p_handles, 0, sizeof(*p_handles));
+  m_next_handle++; // declaration
+  p_handles->value_handle = m_next_handle++;
+  if (p_char_md->char_props.notify) {
+    p_handles->cccd_handle = m_next_handle++;
+  }
+  if (p_char_md->p_char_user_desc != NULL) {
+    p_handles->user_desc_handle = m_next_handle++;
+  }
+  p_char->uuid    = p_attr_char_value->p_uuid->uuid;
+  p_char->handles = *p_handles;
+  p_char->notify  = p_char_md->char_props.notify;
+  p_char->p_value = (p_attr_char_value->p_attr_md->vloc == BLE_GATTS_VLOC_USER) ? p_attr_char_value->p_value : NULL;
+  p_char->max_len = p_attr_char_value->max_len;
+  return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const *p_hvx_params) {
+  if (conn_handle == BLE_CONN_HANDLE_INVALID || conn_handle != m_conn_handle) {
+    return BLE_ERROR_INVALID_CONN_HANDLE;
+  }
+  attr_char_t *p_char = char_by_handle(p_hvx_params->handle);
+  if (p_char == NULL || p_char->handles.value_handle != p_hvx_params->handle || !p_char->notify) {
+    return BLE_ERROR_INVALID_ATTR_HANDLE;
+  }
+  if (!ble_srv_is_notification_enabled(p_char->cccd)) {
+    return NRF_ERROR_INVALID_STATE;
+  }
+  if (*p_hvx_params->p_len > BLE_GATT_ATT_MTU_DEFAULT - 3) {
+    return NRF_ERROR_DATA_SIZE;
+  }
+  if (m_tx_in_flight >= m_tx_packets) {
+    m_no_tx_packets++;
+    return BLE_ERROR_NO_TX_PACKETS;
+  }
+  m_tx_in_flight++;
+
+  if (m_log_count == FAKE_BLE_NOTIFICATION_LOG) {
+    m_log_head = (m_log_head + 1) % FAKE_BLE_NOTIFICATION_LOG;
+    m_log_count--;
+  }
+  fake_ble_notification_t *p_entry = &m_log[(m_log_head + m_log_count) % FAKE_BLE_NOTIFICATION_LOG];
+  p_entry->handle                  = p_hvx_params->handle;
+  p_entry->len                     = *p_hvx_params->p_len;
+  memcpy(p_entry->data, p_hvx_params->p_data, p_entry->len);
+  m_log_count++;
+  return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_tx_packet_count_get(uint16_t conn_handle, uint8_t *p_count) {
+  if (conn_handle == BLE_CONN_HANDLE_INVALID || conn_handle != m_conn_handle) {
+    return BLE_ERROR_INVALID_CONN_HANDLE;
+  }
+  *p_count = m_tx_packets;
+  return NRF_SUCCESS;
+}
+
+ble_gatts_char_handles_t fake_ble_char_handles(uint16_t uuid) {
+  ble_gatts_char_handles_t none = {0};
+
+  for (uint8_t i = 0; i < m_char_count; i++) {
+    if (m_chars[i].uuid == uuid) {
+      return m_chars[i].handles;
+    }
+  }
+  return none;
+}
+
+static ble_evt_t *evt_new(uint16_t evt_id) {
+  memset(&m_evt, 0, sizeof(m_evt));
+  m_evt.evt.header.evt_id  = evt_id;
+  m_evt.evt.header.evt_len = sizeof(ble_evt_t);
+  return &m_evt.evt;
+}
+
+ble_evt_t *fake_ble_connect(void) {
+  ble_evt_t *p_evt = evt_new(BLE_GAP_EVT_CONNECTED);
+
+  m_conn_handle              = FAKE_BLE_CONN_HANDLE;
+  m_tx_in_flight             = 0;
+  p_evt->evt.gap_evt.conn_handle = m_conn_handle;
+  return p_evt;
+}
+
+ble_evt_t *fake_ble_disconnect(void) {
+  ble_evt_t *p_evt = evt_new(BLE_GAP_EVT_DISCONNECTED);
+
+  p_evt->evt.gap_evt.conn_handle = m_conn_handle;
+  m_conn_handle                  = BLE_CONN_HANDLE_INVALID;
+  m_tx_in_flight                 = 0;
+  for (uint8_t i = 0; i < m_char_count; i++) {
+    memset(m_chars[i].cccd, 0, sizeof(m_chars[i].cccd)); // no bonding, the CCCDs do not survive
+  }
+  return p_evt;
+}
+
+ble_evt_t *fake_ble_write(uint16_t handle, uint8_t const *p_data, uint16_t len) {
+  ble_evt_t *p_evt    = evt_new(BLE_GATTS_EVT_WRITE);
+  attr_char_t *p_char = char_by_handle(handle);
+
+  len = MIN(len, BLE_GATT_ATT_MTU_DEFAULT - 3);
+  if (p_char != NULL && handle == p_char->handles.cccd_handle && len == 2) {
+    memcpy(p_char->cccd, p_data, 2);
+  } else if (p_char != NULL && p_char->p_value != NULL) {
+    memcpy(p_char->p_value, p_data, MIN(len, p_char->max_len));
+  }
+
+  p_evt->evt.gatts_evt.conn_handle           = m_conn_handle;
+  p_evt->evt.gatts_evt.params.write.handle   = handle;
+  p_evt->evt.gatts_evt.params.write.op       = BLE_GATTS_OP_WRITE_REQ;
+  p_evt->evt.gatts_evt.params.write.len      = len;
+  memcpy(p_evt->evt.gatts_evt.params.write.data, p_data, len);
+  return p_evt;
+}
+
+ble_evt_t *fake_ble_subscribe(uint16_t uuid, bool enable) {
+  uint8_t cccd[2] = {enable ? BLE_GATT_HVX_NOTIFICATION : 0, 0};
+
+  return fake_ble_write(fake_ble_char_handles(uuid).cccd_handle, cccd, sizeof(cccd));
+}
+
+ble_evt_t *fake_ble_tx_complete(uint8_t count) {
+  count = MIN(count, m_tx_in_flight);
+  if (count == 0) {
+    return NULL;
+  }
+  ble_evt_t *p_evt = evt_new(BLE_EVT_TX_COMPLETE);
+
+  m_tx_in_flight -= count;
+  p_evt->evt.common_evt.conn_handle              = m_conn_handle;
+  p_evt->evt.common_evt.params.tx_complete.count = count;
+  return p_evt;
+}
+
+void fake_ble_tx_take(uint8_t count) {
+  m_tx_in_flight = MIN(m_tx_in_flight + count, m_tx_packets);
+}
+
+uint8_t fake_ble_tx_in_flight(void) {
+  return m_tx_in_flight;
+}
+
+uint32_t fake_ble_no_tx_packets(void) {
+  return m_no_tx_packets;
+}
+
+uint16_t fake_ble_notification_count(void) {
+  return m_log_count;
+}
+
+bool fake_ble_notification_pop(fake_ble_notification_t *p_notification) {
+  if (m_log_count == 0) {
+    return false;
+  }
+  *p_notification = m_log[m_log_head];
+  m_log_head      = (m_log_head + 1) % FAKE_BLE_NOTIFICATION_LOG;
+  m_log_count--;
+  return true;
+}
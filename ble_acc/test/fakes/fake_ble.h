@@ -0,0 +1,86 @@
+#ifndef FAKE_BLE_H
+#define FAKE_BLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ble.h"
+
+/** @file
+ * @brief The SoftDevice GATT server for the host, one link.
+ *
+ * sd_ble_gatts_hvx() takes a TX buffer per notification, like the S130. A buffer stays taken
+ * until the test lets the link send it with fake_ble_tx_complete(), whose event gives it back.
+ * Notifications are kept in order for the test to check.
+ *
+ * The fake_ble_*() event builders return an event for the service's BLE event handler. It
+ * stays valid until the next one is built.
+ */
+
+#define FAKE_BLE_CONN_HANDLE 0x0001
+#define FAKE_BLE_NOTIFICATION_LOG 256 /**< Notifications kept, the oldest are dropped. */
+
+typedef struct {
+  uint16_t handle;
+  uint16_t len;
+  uint8_t data[BLE_GATT_ATT_MTU_DEFAULT - 3];
+} fake_ble_notification_t;
+
+/**
+ * @brief Forget the attribute table, the link and the notifications.
+ *
+ * @param[in] tx_packets TX buffers of the link, what sd_ble_tx_packet_count_get() reports.
+ */
+void fake_ble_reset(uint8_t tx_packets);
+
+/**
+ * @brief Handles of the characteristic with this 16 bit UUID, all zero if there is none.
+ */
+ble_gatts_char_handles_t fake_ble_char_handles(uint16_t uuid);
+
+ble_evt_t *fake_ble_connect(void);
+ble_evt_t *fake_ble_disconnect(void);
+
+/**
+ * @brief A write from the client. The value of a user memory attribute and the CCCDs are
+ *        updated first, as the SoftDevice does.
+ */
+ble_evt_t *fake_ble_write(uint16_t handle, uint8_t const *p_data, uint16_t len);
+
+/**
+ * @brief The client writes the CCCD of the characteristic with this 16 bit UUID.
+ */
+ble_evt_t *fake_ble_subscribe(uint16_t uuid, bool enable);
+
+/**
+ * @brief The link sends up to count buffered notifications.
+ *
+ * @return BLE_EVT_TX_COMPLETE for the buffers freed, NULL if none was taken.
+ */
+ble_evt_t *fake_ble_tx_complete(uint8_t count);
+
+/**
+ * @brief Take TX buffers for traffic the test does not see, a notification of another service.
+ */
+void fake_ble_tx_take(uint8_t count);
+
+/**
+ * @brief TX buffers taken and not sent yet.
+ */
+uint8_t fake_ble_tx_in_flight(void);
+
+/**
+ * @brief sd_ble_gatts_hvx() calls answered BLE_ERROR_NO_TX_PACKETS.
+ */
+uint32_t fake_ble_no_tx_packets(void);
+
+uint16_t fake_ble_notification_count(void);
+
+/**
+ * @brief Take the oldest notification from the log.
+ *
+ * @return false if the log is empty.
+ */
+bool fake_ble_notification_pop(fake_ble_notification_t *p_notification);
+
+#endif
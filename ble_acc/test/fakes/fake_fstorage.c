@@ -0,0 +1,99 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "fake_fstorage.h"
+
+// The linker collects FS_REGISTER_CFG() configurations between these.
+extern fs_config_t __start_fs_data[];
+extern fs_config_t __stop_fs_data[];
+
+typedef struct {
+  fs_config_t const *p_config;
+  bool erase;
+  uint32_t *p_dest;
+  uint32_t const *p_src;
+  uint16_t length; // words, or pages for an erase
+  void *p_context;
+} fs_op_t;
+
+static uint32_t m_flash[FAKE_FSTORAGE_PAGES * FS_PAGE_SIZE_WORDS];
+static bool m_flash_blank; // erased once before first use
+static fs_op_t m_queue[FAKE_FSTORAGE_QUEUE_SIZE];
+static uint8_t m_head;
+static uint8_t m_count;
+
+void fake_fstorage_erase_all(void) {
+  memset(m_flash, 0xFF, sizeof(m_flash));
+  m_flash_blank = true;
+  m_head        = 0;
+  m_count       = 0;
+}
+
+fs_ret_t fs_init(void) {
+  uint32_t *p_addr = m_flash;
+
+  if (!m_flash_blank) {
+    fake_fstorage_erase_all();
+  }
+  for (fs_config_t *p_config = __start_fs_data; p_config < __stop_fs_data; p_config++) {
+    if (p_addr + p_config->num_pages * FS_PAGE_SIZE_WORDS > m_flash + FAKE_FSTORAGE_PAGES * FS_PAGE_SIZE_WORDS) {
+      return FS_ERR_INVALID_CFG;
+    }
+    p_config->p_start_addr = p_addr;
+    p_addr += p_config->num_pages * FS_PAGE_SIZE_WORDS;
+    p_config->p_end_addr = p_addr;
+  }
+  return FS_SUCCESS;
+}
+
+static fs_ret_t op_queue(fs_op_t const *p_op) {
+  if (m_count == FAKE_FSTORAGE_QUEUE_SIZE) {
+    return FS_ERR_QUEUE_FULL;
+  }
+  m_queue[(m_head + m_count) % FAKE_FSTORAGE_QUEUE_SIZE] = *p_op;
+  m_count++;
+  return FS_SUCCESS;
+}
+
+fs_ret_t fs_store(fs_config_t const *p_config, uint32_t const *p_dest, uint32_t const *p_src,
+                  uint16_t length_words, void *p_context) {
+  if (p_dest < p_config->p_start_addr || p_dest + length_words > p_config->p_end_addr) {
+    return FS_ERR_INVALID_ADDR;
+  }
+  fs_op_t op = {p_config, false, (uint32_t *)p_dest, p_src, length_words, p_context};
+  return op_queue(&op);
+}
+
+fs_ret_t fs_erase(fs_config_t const *p_config, uint32_t const *p_page_addr, uint16_t num_pages,
+                  void *p_context) {
+  if ((p_page_addr - m_flash) % FS_PAGE_SIZE_WORDS != 0) {
+    return FS_ERR_UNALIGNED_ADDR;
+  }
+  if (p_page_addr < p_config->p_start_addr || p_page_addr + num_pages * FS_PAGE_SIZE_WORDS > p_config->p_end_addr) {
+    return FS_ERR_INVALID_ADDR;
+  }
+  fs_op_t op = {p_config, true, (uint32_t *)p_page_addr, NULL, num_pages, p_context};
+  return op_queue(&op);
+}
+
+uint32_t fake_fstorage_run(void) {
+  uint32_t done = 0;
+
+  while (m_count > 0) {
+    fs_op_t op = m_queue[m_head];
+    m_head     = (m_head + 1) % FAKE_FSTORAGE_QUEUE_SIZE;
+    m_count--;
+
+    fs_evt_t evt = {.id = op.erase ? FS_EVT_ERASE : FS_EVT_STORE, .p_context = op.p_context};
+    if (op.erase) {
+      memset(op.p_dest, 0xFF, op.length * FS_PAGE_SIZE);
+    } else {
+      for (uint16_t i = 0; i < op.length; i++) {
+        op.p_dest[i] &= op.p_src[i]; // programming only clears bits
+      }
+    }
+    done++;
+    op.p_config->callback(&evt, FS_SUCCESS);
+  }
+  return done;
+}
@@ -0,0 +1,28 @@
+#ifndef FAKE_FSTORAGE_H
+#define FAKE_FSTORAGE_H
+
+#include <stdint.h>
+
+#include "fstorage.h"
+
+/** @file
+ * @brief fstorage for the host, see fstorage.h.
+ */
+
+#define FAKE_FSTORAGE_PAGES 64     /**< Flash pages shared by the registered configurations. */
+#define FAKE_FSTORAGE_QUEUE_SIZE 8 /**< Operations waiting for fake_fstorage_run(). */
+
+/**
+ * @brief Erase the whole flash and drop the queued operations. The flash keeps its content
+ *        otherwise, fs_init() included, as it does over a reset.
+ */
+void fake_fstorage_erase_all(void);
+
+/**
+ * @brief Carry out the queued operations and report them, the ones the callbacks queue included.
+ *
+ * @return Operations carried out.
+ */
+uint32_t fake_fstorage_run(void);
+
+#endif
@@ -0,0 +1,213 @@
+#include <string.h>
+
+#include "fake_mpu6050.h"
+#include "mpu6050.h"
+#include "mpu_reg.h"
+#include "nrf_gpio.h"
+
+#define REG_COUNT 0x80
+#define REG_SIGNAL_PATH_RESET 0x68
+#define REG_WHO_AM_I 0x75
+#define PIN_COUNT 32
+
+static uint8_t m_regs[REG_COUNT];
+static uint32_t m_writes[REG_COUNT];
+static uint8_t m_pointer; // register the next access starts at
+static uint8_t m_fifo[MPU6050_FIFO_SIZE];
+static uint16_t m_fifo_head;
+static uint16_t m_fifo_count;
+static uint32_t m_int_pin;
+static nrf_gpio_pin_pull_t m_pull[PIN_COUNT];
+
+static void regs_reset(void) {
+  memset(m_regs, 0, sizeof(m_regs));
+  m_regs[PWR_MGMT_1]   = SLEEP;
+  m_regs[REG_WHO_AM_I] = FAKE_MPU6050_ADDRESS;
+  m_fifo_head          = 0;
+  m_fifo_count         = 0;
+}
+
+void fake_mpu6050_reset(void) {
+  regs_reset();
+  memset(m_writes, 0, sizeof(m_writes));
+  memset(m_pull, 0, sizeof(m_pull));
+  m_pointer = 0;
+  m_int_pin = FAKE_MPU6050_PIN_NONE;
+}
+
+static void fifo_push(uint8_t byte) {
+  if (m_fifo_count == MPU6050_FIFO_SIZE) {
+    // the oldest byte goes, whatever frame it belongs to
+    m_fifo_head = (m_fifo_head + 1) % MPU6050_FIFO_SIZE;
+    m_fifo_count--;
+    m_regs[INT_STATUS] |= FIFO_OFLOW_INT;
+  }
+  m_fifo[(m_fifo_head + m_fifo_count) % MPU6050_FIFO_SIZE] = byte;
+  m_fifo_count++;
+}
+
+static uint8_t fifo_pop(void) {
+  if (m_fifo_count == 0) {
+    return 0;
+  }
+  uint8_t byte = m_fifo[m_fifo_head];
+  m_fifo_head  = (m_fifo_head + 1) % MPU6050_FIFO_SIZE;
+  m_fifo_count--;
+  return byte;
+}
+
+bool fake_mpu6050_sample(int16_t const acc[3]) {
+  if (m_regs[PWR_MGMT_1] & SLEEP) {
+    return false;
+  }
+  for (int axis = 0; axis < 3; axis++) {
+    m_regs[ACCEL_XOUT_H + axis * 2] = (uint8_t)((uint16_t)acc[axis] >> 8);
+    m_regs[ACCEL_XOUT_L + axis * 2] = (uint8_t)acc[axis];
+  }
+  if ((m_regs[USER_CTRL] & USER_FIFO_EN) && (m_regs[FIFO_EN] & ACCEL_FIFO_EN)) {
+    for (int n = 0; n < MPU6050_SAMPLE_SIZE; n++) {
+      fifo_push(m_regs[ACCEL_XOUT_H + n]);
+    }
+  }
+  m_regs[INT_STATUS] |= DATA_RDY_INT;
+  return true;
+}
+
+void fake_mpu6050_motion(void) {
+  m_regs[INT_STATUS] |= MOT_INT;
+}
+
+uint8_t fake_mpu6050_reg(uint8_t reg) {
+  return m_regs[reg % REG_COUNT];
+}
+
+void fake_mpu6050_reg_set(uint8_t reg, uint8_t value) {
+  m_regs[reg % REG_COUNT] = value;
+}
+
+uint32_t fake_mpu6050_writes(uint8_t reg) {
+  return m_writes[reg % REG_COUNT];
+}
+
+uint16_t fake_mpu6050_fifo_count(void) {
+  return m_fifo_count;
+}
+
+void fake_mpu6050_int_pin_set(uint32_t pin) {
+  m_int_pin = pin;
+}
+
+bool fake_mpu6050_int_level(void) {
+  bool active = (m_regs[INT_STATUS] & m_regs[INT_ENABLE]) != 0;
+  return (m_regs[INT_PIN_CFG] & INT_LEVEL_LOW) ? !active : active;
+}
+
+static bool reg_read_only(uint8_t reg) {
+  return reg == INT_STATUS || (reg >= ACCEL_XOUT_H && reg <= GYRO_ZOUT_L) || reg == FIFO_COUNTH ||
+         reg == FIFO_COUNTL || reg == REG_WHO_AM_I;
+}
+
+static void reg_write(uint8_t reg, uint8_t value) {
+  m_writes[reg]++;
+  if (reg == FIFO_R_W) {
+    fifo_push(value);
+    return;
+  }
+  if (reg_read_only(reg)) {
+    return;
+  }
+  switch (reg) {
+  case PWR_MGMT_1:
+    if (value & DEVICE_RESET) {
+      regs_reset();
+      return;
+    }
+    break;
+  case USER_CTRL:
+    if (value & USER_FIFO_RESET) {
+      m_fifo_head  = 0;
+      m_fifo_count = 0;
+    }
+    value &= ~(USER_FIFO_RESET | USER_I2C_MST_RESET | USER_SIG_COND_RESET);
+    break;
+  case REG_SIGNAL_PATH_RESET:
+    value = 0;
+    break;
+  }
+  m_regs[reg] = value;
+}
+
+static uint8_t reg_read(uint8_t reg) {
+  uint8_t value;
+
+  switch (reg) {
+  case FIFO_R_W:
+    return fifo_pop();
+  case FIFO_COUNTH:
+    return (uint8_t)(m_fifo_count >> 8);
+  case FIFO_COUNTL:
+    return (uint8_t)m_fifo_count;
+  case INT_STATUS:
+    value              = m_regs[INT_STATUS];
+    m_regs[INT_STATUS] = 0;
+    return value;
+  default:
+    value = m_regs[reg];
+    if (m_regs[INT_PIN_CFG] & INT_RD_CLEAR) {
+      m_regs[INT_STATUS] = 0;
+    }
+    return value;
+  }
+}
+
+// The next register of a burst, FIFO_R_W stays put.
+static void pointer_next(void) {
+  if (m_pointer != FIFO_R_W) {
+    m_pointer = (m_pointer + 1) % REG_COUNT;
+  }
+}
+
+bool fake_mpu6050_xfer(nrf_drv_twi_xfer_desc_t const *p_xfer) {
+  if (p_xfer->address != FAKE_MPU6050_ADDRESS) {
+    return false;
+  }
+
+  if (p_xfer->type != NRF_DRV_TWI_XFER_RX && p_xfer->primary_length > 0) {
+    m_pointer = p_xfer->p_primary_buf[0] % REG_COUNT;
+    for (uint8_t n = 1; n < p_xfer->primary_length; n++) {
+      reg_write(m_pointer, p_xfer->p_primary_buf[n]);
+      pointer_next();
+    }
+  }
+
+  uint8_t *p_rx = NULL;
+  uint8_t rx_len = 0;
+  if (p_xfer->type == NRF_DRV_TWI_XFER_RX) {
+    p_rx   = p_xfer->p_primary_buf;
+    rx_len = p_xfer->primary_length;
+  } else if (p_xfer->type == NRF_DRV_TWI_XFER_TXRX) {
+    p_rx   = p_xfer->p_secondary_buf;
+    rx_len = p_xfer->secondary_length;
+  }
+  for (uint8_t n = 0; n < rx_len; n++) {
+    p_rx[n] = reg_read(m_pointer);
+    pointer_next();
+  }
+  return true;
+}
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config) {
+  m_pull[pin_number % PIN_COUNT] = pull_config;
+}
+
+void nrf_gpio_cfg_default(uint32_t pin_number) {
+  m_pull[pin_number % PIN_COUNT] = NRF_GPIO_PIN_NOPULL;
+}
+
+// The INT output is push-pull, it wins over the pull resistor.
+uint32_t nrf_gpio_pin_read(uint32_t pin_number) {
+  if (pin_number == m_int_pin) {
+    return fake_mpu6050_int_level() ? 1 : 0;
+  }
+  return m_pull[pin_number % PIN_COUNT] == NRF_GPIO_PIN_PULLUP ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+#ifndef FAKE_MPU6050_H
+#define FAKE_MPU6050_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nrf_drv_twi.h"
+
+/** @file
+ * @brief Register model of the MPU6050 on the fake TWI bus, see fake_twi.h.
+ *
+ * Burst accesses move to the next register, except FIFO_R_W which pops the FIFO. Bits which
+ * trigger an action clear themselves, DEVICE_RESET brings back the reset values, SLEEP set.
+ * Read-only registers ignore writes. INT_STATUS clears when read, its bits enabled in
+ * INT_ENABLE drive the INT output at the INT_PIN_CFG level.
+ *
+ * The test plays the sample clock: every fake_mpu6050_sample() is one sample. The FIFO keeps
+ * MPU6050_FIFO_SIZE bytes and then overwrites the oldest ones, so its frames lose alignment.
+ */
+
+#define FAKE_MPU6050_ADDRESS 0x68
+#define FAKE_MPU6050_PIN_NONE 0xFFFFFFFF
+
+/**
+ * @brief Power on: reset values, empty FIFO, INT not wired, counters cleared.
+ */
+void fake_mpu6050_reset(void);
+
+/**
+ * @brief One tick of the sample clock. Nothing happens while the sensor sleeps.
+ *
+ * @param[in] acc Acceleration in raw LSB, X, Y and Z.
+ *
+ * @return false if the sensor sleeps.
+ */
+bool fake_mpu6050_sample(int16_t const acc[3]);
+
+/**
+ * @brief The motion detector fired, sets MOT_INT.
+ */
+void fake_mpu6050_motion(void);
+
+uint8_t fake_mpu6050_reg(uint8_t reg);
+void fake_mpu6050_reg_set(uint8_t reg, uint8_t value);
+
+/**
+ * @brief Writes a register took since power on, strobes and ignored writes included.
+ */
+uint32_t fake_mpu6050_writes(uint8_t reg);
+
+uint16_t fake_mpu6050_fifo_count(void);
+
+/**
+ * @brief Wire the INT output to a GPIO, FAKE_MPU6050_PIN_NONE for none.
+ */
+void fake_mpu6050_int_pin_set(uint32_t pin);
+
+/**
+ * @brief Level of the INT output.
+ */
+bool fake_mpu6050_int_level(void);
+
+/**
+ * @brief Carry out a transfer addressed to the bus, for fake_twi.c.
+ *
+ * @return false if the address is not the MPU6050's, nobody acknowledged.
+ */
+bool fake_mpu6050_xfer(nrf_drv_twi_xfer_desc_t const *p_xfer);
+
+#endif
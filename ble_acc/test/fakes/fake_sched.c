@@ -0,0 +1,56 @@
+#include <string.h>
+
+#include "app_scheduler.h"
+#include "app_util.h"
+#include "fake_sched.h"
+
+typedef struct {
+  app_sched_event_handler_t handler;
+  uint16_t size;
+  uint8_t data[FAKE_SCHED_EVENT_SIZE_MAX];
+} sched_evt_t;
+
+static sched_evt_t m_queue[FAKE_SCHED_QUEUE_SIZE];
+static uint16_t m_size = FAKE_SCHED_QUEUE_SIZE;
+static uint16_t m_head;
+static uint16_t m_count;
+
+void fake_sched_init(uint16_t queue_size) {
+  m_size  = MIN(queue_size, FAKE_SCHED_QUEUE_SIZE);
+  m_head  = 0;
+  m_count = 0;
+}
+
+uint16_t fake_sched_pending(void) {
+  return m_count;
+}
+
+uint32_t app_sched_event_put(void const *p_event_data, uint16_t event_size, app_sched_event_handler_t handler) {
+  if (event_size > FAKE_SCHED_EVENT_SIZE_MAX) {
+    return NRF_ERROR_INVALID_LENGTH;
+  }
+  if (m_count == m_size) {
+    return NRF_ERROR_NO_MEM;
+  }
+  sched_evt_t *p_evt = &m_queue[(m_head + m_count) % FAKE_SCHED_QUEUE_SIZE];
+  p_evt->handler     = handler;
+  p_evt->size        = event_size;
+  if (p_event_data != NULL) {
+    memcpy(p_evt->data, p_event_data, event_size);
+  }
+  m_count++;
+  return NRF_SUCCESS;
+}
+
+void app_sched_execute(void) {
+  while (m_count > 0) {
+    sched_evt_t evt = m_queue[m_head];
+    m_head          = (m_head + 1) % FAKE_SCHED_QUEUE_SIZE;
+    m_count--;
+    evt.handler(evt.data, evt.size);
+  }
+}
+
+uint16_t app_sched_queue_space_get(void) {
+  return m_size - m_count;
+}
@@ -0,0 +1,24 @@
+#ifndef FAKE_SCHED_H
+#define FAKE_SCHED_H
+
+#include <stdint.h>
+
+/** @file
+ * @brief app_scheduler for the host. app_sched_execute() runs the queued events in order,
+ *        the ones they put included, like the SDK's.
+ */
+
+#define FAKE_SCHED_QUEUE_SIZE 32     /**< Most events the queue can be given. */
+#define FAKE_SCHED_EVENT_SIZE_MAX 32 /**< Largest event, bytes. Host pointers are twice the size of the target ones. */
+
+/**
+ * @brief Empty the queue and make room for queue_size events, at most FAKE_SCHED_QUEUE_SIZE.
+ */
+void fake_sched_init(uint16_t queue_size);
+
+/**
+ * @brief Events waiting for app_sched_execute().
+ */
+uint16_t fake_sched_pending(void);
+
+#endif
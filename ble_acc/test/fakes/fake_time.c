@@ -0,0 +1,16 @@
+#include "fake_time.h"
+#include "ferris_time.h"
+
+static uint32_t m_now;
+
+uint32_t ferris_time_now(void) {
+  return m_now;
+}
+
+void fake_time_set(uint32_t now) {
+  m_now = now;
+}
+
+void fake_time_advance(uint32_t ticks) {
+  m_now += ticks;
+}
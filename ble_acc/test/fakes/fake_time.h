@@ -0,0 +1,13 @@
+#ifndef FAKE_TIME_H
+#define FAKE_TIME_H
+
+#include <stdint.h>
+
+/** @file
+ * @brief ferris_time_now() for the host, the test moves the clock.
+ */
+
+void fake_time_set(uint32_t now);
+void fake_time_advance(uint32_t ticks);
+
+#endif
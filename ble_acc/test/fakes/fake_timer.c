@@ -0,0 +1,93 @@
+#include "fake_time.h"
+#include "fake_timer.h"
+#include "ferris_time.h"
+
+static app_timer_t *m_p_timers; // created timers
+
+static bool timer_created(app_timer_t const *p_timer) {
+  for (app_timer_t const *p = m_p_timers; p != NULL; p = p->p_next) {
+    if (p == p_timer) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t app_timer_create(app_timer_id_t const *p_timer_id, app_timer_mode_t mode,
+                          app_timer_timeout_handler_t timeout_handler) {
+  app_timer_t *p_timer = *p_timer_id;
+
+  if (timeout_handler == NULL) {
+    return NRF_ERROR_INVALID_PARAM;
+  }
+  if (p_timer->running) {
+    return NRF_ERROR_INVALID_STATE;
+  }
+  p_timer->handler = timeout_handler;
+  p_timer->mode    = mode;
+  if (!timer_created(p_timer)) {
+    p_timer->p_next = m_p_timers;
+    m_p_timers      = p_timer;
+  }
+  return NRF_SUCCESS;
+}
+
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *p_context) {
+  if (timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS) {
+    return NRF_ERROR_INVALID_PARAM;
+  }
+  if (!timer_created(timer_id)) {
+    return NRF_ERROR_INVALID_STATE;
+  }
+  timer_id->expiry    = ferris_time_now() + timeout_ticks;
+  timer_id->period    = timeout_ticks;
+  timer_id->p_context = p_context;
+  timer_id->running   = true;
+  return NRF_SUCCESS;
+}
+
+uint32_t app_timer_stop(app_timer_id_t timer_id) {
+  timer_id->running = false;
+  return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_get(uint32_t *p_ticks) {
+  *p_ticks = ferris_time_now() & 0x00FFFFFF; // RTC1 is 24 bit
+  return NRF_SUCCESS;
+}
+
+bool fake_timer_running(app_timer_id_t timer_id) {
+  return timer_id->running;
+}
+
+void fake_timer_reset(void) {
+  for (app_timer_t *p = m_p_timers; p != NULL; p = p->p_next) {
+    p->running = false;
+  }
+}
+
+void fake_timer_advance(uint32_t ticks) {
+  uint32_t end = ferris_time_now() + ticks;
+
+  while (true) {
+    // the timer which expires first, no later than end
+    app_timer_t *p_next = NULL;
+    for (app_timer_t *p = m_p_timers; p != NULL; p = p->p_next) {
+      if (p->running && (int32_t)(end - p->expiry) >= 0 &&
+          (p_next == NULL || (int32_t)(p_next->expiry - p->expiry) > 0)) {
+        p_next = p;
+      }
+    }
+    if (p_next == NULL) {
+      break;
+    }
+    fake_time_set(p_next->expiry);
+    if (p_next->mode == APP_TIMER_MODE_REPEATED) {
+      p_next->expiry += p_next->period;
+    } else {
+      p_next->running = false;
+    }
+    p_next->handler(p_next->p_context);
+  }
+  fake_time_set(end);
+}
@@ -0,0 +1,26 @@
+#ifndef FAKE_TIMER_H
+#define FAKE_TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "app_timer.h"
+
+/** @file
+ * @brief app_timer for the host, on the clock of fake_time.h.
+ */
+
+/**
+ * @brief Move the clock forward, firing the timers which expire on the way in order.
+ *        Handlers run as the RTC1 interrupt would.
+ */
+void fake_timer_advance(uint32_t ticks);
+
+/**
+ * @brief Stop every timer.
+ */
+void fake_timer_reset(void);
+
+bool fake_timer_running(app_timer_id_t timer_id);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef FAKE_TWI_H
+#define FAKE_TWI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nrf_drv_twi.h"
+
+/** @file
+ * @brief nrf_drv_twi for the host. One transfer is on the bus at a time. It reaches the MPU6050
+ *        model (see fake_mpu6050.h) and completes when the test says so, the event handler
+ *        running as the TWI interrupt would.
+ *
+ * With auto completion the transfer completes as soon as no critical region is open, which
+ * is what the blocking driver calls need.
+ */
+
+/**
+ * @brief Forget the transfer on the bus, the failures asked for and the counters.
+ */
+void fake_twi_reset(void);
+
+/**
+ * @brief Complete transfers on their own, as soon as no critical region is open.
+ */
+void fake_twi_auto_complete(bool enable);
+
+/**
+ * @brief Complete the transfer on the bus and call the event handler.
+ *
+ * @return false if the bus was idle.
+ */
+bool fake_twi_complete(void);
+
+/**
+ * @brief Complete transfers until the bus is idle, the ones the handler starts included.
+ *
+ * @return Transfers completed.
+ */
+uint32_t fake_twi_run(void);
+
+/**
+ * @brief Fail the next transfer that completes. An address NACK never reaches the device, a
+ *        data NACK stops a write before its data.
+ */
+void fake_twi_fail_next(nrf_drv_twi_evt_type_t type);
+
+bool fake_twi_busy(void);
+
+/**
+ * @brief Transfers started since fake_twi_reset().
+ */
+uint32_t fake_twi_transfers(void);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef FSTORAGE_H__
+#define FSTORAGE_H__
+
+#include <stdint.h>
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name, implemented by fake_fstorage.c.
+ *
+ * Flash is a RAM array with flash rules: a store only clears bits, an erase sets a page to
+ * 0xFF. Operations complete in fake_fstorage_run(), as they would in the SoftDevice flash
+ * events after the caller returned.
+ */
+
+#define FS_PAGE_SIZE 1024
+#define FS_PAGE_SIZE_WORDS 256
+
+typedef enum {
+  FS_SUCCESS,
+  FS_ERR_NOT_INITIALIZED,
+  FS_ERR_INVALID_CFG,
+  FS_ERR_NULL_ARG,
+  FS_ERR_INVALID_ARG,
+  FS_ERR_INVALID_ADDR,
+  FS_ERR_UNALIGNED_ADDR,
+  FS_ERR_QUEUE_FULL,
+  FS_ERR_OPERATION_TIMEOUT,
+  FS_ERR_INTERNAL,
+} fs_ret_t;
+
+typedef enum {
+  FS_EVT_STORE,
+  FS_EVT_ERASE,
+} fs_evt_id_t;
+
+typedef struct {
+  fs_evt_id_t id;
+  void *p_context;
+} fs_evt_t;
+
+typedef void (*fs_cb_t)(fs_evt_t const *const evt, fs_ret_t result);
+
+typedef struct {
+  uint32_t const *p_start_addr;
+  uint32_t const *p_end_addr;
+  fs_cb_t const callback;
+  uint8_t const num_pages;
+  uint8_t const priority;
+} fs_config_t;
+
+// The SDK collects the configurations in the fs_data section, so does the host build.
+#define FS_REGISTER_CFG(cfg_var) __attribute__((section("fs_data"), used)) cfg_var
+
+fs_ret_t fs_init(void);
+fs_ret_t fs_store(fs_config_t const *p_config, uint32_t const *p_dest, uint32_t const *p_src,
+                  uint16_t length_words, void *p_context);
+fs_ret_t fs_erase(fs_config_t const *p_config, uint32_t const *p_page_addr, uint16_t num_pages,
+                  void *p_context);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef NRF_DELAY_H__
+#define NRF_DELAY_H__
+
+#include <stdint.h>
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name. Delays return at once.
+ */
+
+static inline void nrf_delay_us(uint32_t number_of_us) {
+}
+
+static inline void nrf_delay_ms(uint32_t number_of_ms) {
+}
+
+#endif
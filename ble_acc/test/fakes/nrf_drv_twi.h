@@ -0,0 +1,91 @@
+#ifndef NRF_DRV_TWI_H__
+#define NRF_DRV_TWI_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name, implemented by fake_twi.c.
+ */
+
+typedef struct {
+  uint8_t drv_inst_idx;
+} nrf_drv_twi_t;
+
+#define NRF_DRV_TWI_INSTANCE(id) \
+  { .drv_inst_idx = (id) }
+
+typedef enum {
+  NRF_TWI_FREQ_100K = 0x01980000UL,
+  NRF_TWI_FREQ_250K = 0x04000000UL,
+  NRF_TWI_FREQ_400K = 0x06680000UL,
+} nrf_twi_frequency_t;
+
+typedef struct {
+  uint32_t scl;
+  uint32_t sda;
+  nrf_twi_frequency_t frequency;
+  uint8_t interrupt_priority;
+  bool clear_bus_init;
+  bool hold_bus_uninit;
+} nrf_drv_twi_config_t;
+
+typedef enum {
+  NRF_DRV_TWI_EVT_DONE,
+  NRF_DRV_TWI_EVT_ADDRESS_NACK,
+  NRF_DRV_TWI_EVT_DATA_NACK,
+} nrf_drv_twi_evt_type_t;
+
+typedef enum {
+  NRF_DRV_TWI_XFER_TX,
+  NRF_DRV_TWI_XFER_RX,
+  NRF_DRV_TWI_XFER_TXRX,
+  NRF_DRV_TWI_XFER_TXTX,
+} nrf_drv_twi_xfer_type_t;
+
+typedef struct {
+  nrf_drv_twi_xfer_type_t type;
+  uint8_t address;
+  uint8_t primary_length;
+  uint8_t secondary_length;
+  uint8_t *p_primary_buf;
+  uint8_t *p_secondary_buf;
+} nrf_drv_twi_xfer_desc_t;
+
+#define NRF_DRV_TWI_XFER_DESC_TX(addr, p_data, length) \
+  {                                                    \
+    .type             = NRF_DRV_TWI_XFER_TX,           \
+    .address          = (addr),                        \
+    .primary_length   = (length),                      \
+    .secondary_length = 0,                             \
+    .p_primary_buf    = (p_data),                      \
+    .p_secondary_buf  = NULL,                          \
+  }
+
+#define NRF_DRV_TWI_XFER_DESC_TXRX(addr, p_tx, tx_len, p_rx, rx_len) \
+  {                                                                  \
+    .type             = NRF_DRV_TWI_XFER_TXRX,                       \
+    .address          = (addr),                                      \
+    .primary_length   = (tx_len),                                    \
+    .secondary_length = (rx_len),                                    \
+    .p_primary_buf    = (p_tx),                                      \
+    .p_secondary_buf  = (p_rx),                                      \
+  }
+
+typedef struct {
+  nrf_drv_twi_evt_type_t type;
+  nrf_drv_twi_xfer_desc_t xfer_desc;
+} nrf_drv_twi_evt_t;
+
+typedef void (*nrf_drv_twi_evt_handler_t)(nrf_drv_twi_evt_t const *p_event, void *p_context);
+
+ret_code_t nrf_drv_twi_init(nrf_drv_twi_t const *p_instance, nrf_drv_twi_config_t const *p_config,
+                            nrf_drv_twi_evt_handler_t event_handler, void *p_context);
+void nrf_drv_twi_enable(nrf_drv_twi_t const *p_instance);
+ret_code_t nrf_drv_twi_xfer(nrf_drv_twi_t const *p_instance, nrf_drv_twi_xfer_desc_t const *p_xfer_desc,
+                            uint32_t flags);
+bool nrf_drv_twi_is_busy(nrf_drv_twi_t const *p_instance);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef NRF_GPIO_H__
+#define NRF_GPIO_H__
+
+#include <stdint.h>
+
+/** @file
+ * @brief Host stand-in for the SDK header of the same name. The only input is the pin the
+ *        MPU6050 model drives, see fake_mpu6050.h.
+ */
+
+typedef enum {
+  NRF_GPIO_PIN_NOPULL   = 0,
+  NRF_GPIO_PIN_PULLDOWN = 1,
+  NRF_GPIO_PIN_PULLUP   = 3,
+} nrf_gpio_pin_pull_t;
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config);
+void nrf_gpio_cfg_default(uint32_t pin_number);
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+
+#endif
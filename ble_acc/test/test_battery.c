@@ -0,0 +1,131 @@
+#include "battery.h"
+#include "unit.h"
+
+// Table and conversion of the first releases, as update_battery() in main.c had them.
+static const uint16_t reference_table[] = {569, 606, 642, 676, 703, 722, 732, 740, 747, 753, 759, 764, 769, 773, 776, 780, 783, 785, 788, 790, 792, 794, 796, 798, 800, 801, 803, 804, 805, 807, 808, 809, 810, 811, 812, 813, 814, 815, 816, 817, 818, 819, 820, 820, 821, 822, 823, 823, 824, 825, 825, 826, 827, 827, 828, 829, 829, 830, 830, 831, 831, 832, 833, 833, 834, 834, 835, 835, 836, 836, 837, 837, 838, 838, 839, 839, 840, 840, 841, 842, 842, 843, 843, 844, 844, 844, 845, 845, 845, 845, 846, 846, 846, 847, 847, 848, 849, 850, 851, 853, 876, 907, 937, 967, 996, 1023};
+
+static uint8_t reference_level(uint16_t raw) {
+  uint8_t level = 0;
+  while (level < sizeof(reference_table) / sizeof(uint16_t) && reference_table[level] <= raw) {
+    level++;
+  }
+  // the table runs past 100, the Battery Service does not
+  return level > BATTERY_LEVEL_MAX ? BATTERY_LEVEL_MAX : level;
+}
+
+static void test_all_codes(void) {
+  for (uint16_t raw = 0; raw < 1024; raw++) {
+    CHECK_EQ(battery_level_get(raw), reference_level(raw));
+    CHECK_EQ(battery_raw_to_mv(raw), (uint16_t)(raw * 3600.0 / 1024));
+    // the filter settles on a steady reading, and maps back to it
+    CHECK_EQ(battery_filtered_to_raw(raw << BATTERY_FILTER_FRAC), raw);
+    CHECK_EQ(battery_filtered_to_mv(raw << BATTERY_FILTER_FRAC), battery_raw_to_mv(raw));
+  }
+}
+
+// From every reported level to every reading: the level moves only if it still would with the
+// reading BATTERY_HYSTERESIS_RAW LSB back towards it, and then to that level.
+static void test_all_transitions(void) {
+  for (uint16_t from = 0; from < 1024; from++) {
+    for (uint16_t raw = 0; raw < 1024; raw++) {
+      battery_level_t battery = {0};
+      uint8_t old;
+
+      CHECK(battery_level_update(&battery, from));
+      old = battery.level;
+
+      uint8_t level = reference_level(raw);
+      if (level > old) {
+        level = reference_level(raw < BATTERY_HYSTERESIS_RAW ? 0 : raw - BATTERY_HYSTERESIS_RAW);
+        level = level > old ? level : old;
+      } else if (level < old) {
+        level = reference_level(raw + BATTERY_HYSTERESIS_RAW);
+        level = level < old ? level : old;
+      }
+      bool changed = battery_level_update(&battery, raw);
+
+      if (changed != (level != old) || battery.level != level) {
+        CHECK_EQ(from * 1024 + raw, -1); // reports the failing pair
+        return;
+      }
+    }
+  }
+}
+
+static void test_raw_to_mv(void) {
+  CHECK_EQ(battery_raw_to_mv(0), 0);
+  CHECK_EQ(battery_raw_to_mv(512), 1800);
+  CHECK_EQ(battery_raw_to_mv(853), 2998);
+  CHECK_EQ(battery_raw_to_mv(1023), 3596);
+}
+
+static void test_level_get(void) {
+  CHECK_EQ(battery_level_get(0), 0);
+  CHECK_EQ(battery_level_get(568), 0);
+  CHECK_EQ(battery_level_get(569), 1);
+  CHECK_EQ(battery_level_get(830), 59);
+  CHECK_EQ(battery_level_get(853), 100);
+  CHECK_EQ(battery_level_get(1023), 100);
+  for (uint16_t raw = 1; raw < 1024; raw++) {
+    CHECK(battery_level_get(raw) >= battery_level_get(raw - 1));
+  }
+}
+
+static void test_burst_median(void) {
+  int16_t even[BATTERY_BURST_SIZE] = {830, 829, 760, 831, 830, 832, 829, 830}; // one reading in a TX peak
+  int16_t odd[3]                   = {5, -3, 4};
+  int16_t negative[2]              = {-8, -2};
+
+  CHECK_EQ(battery_burst_median(even, BATTERY_BURST_SIZE), 830);
+  for (int i = 1; i < BATTERY_BURST_SIZE; i++) {
+    CHECK(even[i - 1] <= even[i]);
+  }
+  CHECK_EQ(battery_burst_median(odd, 3), 4);
+  CHECK_EQ(battery_burst_median(negative, 2), 0); // below ground is 0
+}
+
+static void test_filter(void) {
+  battery_filter_t filter = {0};
+
+  CHECK_EQ(battery_filtered_to_raw(battery_filter_update(&filter, 830)), 830);
+  CHECK_EQ(battery_filtered_to_mv(filter.value), battery_raw_to_mv(830));
+
+  // a single outlier moves the reading by a quarter of its step
+  CHECK_EQ(battery_filtered_to_raw(battery_filter_update(&filter, 810)), 825);
+  for (int i = 0; i < 40; i++) {
+    battery_filter_update(&filter, 840);
+  }
+  CHECK_EQ(battery_filtered_to_raw(filter.value), 840);
+  for (int i = 0; i < 40; i++) {
+    battery_filter_update(&filter, 700);
+  }
+  CHECK_EQ(battery_filtered_to_raw(filter.value), 700);
+}
+
+static void test_level_update(void) {
+  battery_level_t battery = {0};
+
+  CHECK(battery_level_update(&battery, 830));
+  CHECK_EQ(battery.level, 59);
+  // toggling by one LSB across a table edge does not move the level
+  CHECK(!battery_level_update(&battery, 831));
+  CHECK(!battery_level_update(&battery, 829));
+  CHECK(!battery_level_update(&battery, 832));
+  CHECK_EQ(battery.level, 59);
+  // a change that holds the hysteresis does
+  CHECK(battery_level_update(&battery, 834));
+  CHECK_EQ(battery.level, battery_level_get(832));
+  CHECK(battery_level_update(&battery, 700));
+  CHECK_EQ(battery.level, battery_level_get(702));
+}
+
+int main(void) {
+  test_all_codes();
+  test_all_transitions();
+  test_raw_to_mv();
+  test_level_get();
+  test_burst_median();
+  test_filter();
+  test_level_update();
+  return UNIT_END();
+}
@@ -0,0 +1,144 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ferris_codec.h"
+#include "unit.h"
+
+#define PACKET_SIZE 20 // notification payload at the default ATT MTU
+#define SAMPLE_COUNT 5000
+
+static ferris_codec_sample_t m_samples[SAMPLE_COUNT];
+
+// Wheel turning slowly at 50 Hz with sensor noise, full scale spikes now and then.
+static void samples_make(void) {
+  srand(1);
+  for (int i = 0; i < SAMPLE_COUNT; i++) {
+    double a = i * 0.01;
+
+    m_samples[i].timestamp = (uint16_t)(i * 20 + rand() % 3);
+    m_samples[i].acc[0]    = (int16_t)(16000 * cos(a) + rand() % 64 - 32);
+    m_samples[i].acc[1]    = (int16_t)(16000 * sin(a) + rand() % 64 - 32);
+    m_samples[i].acc[2]    = (int16_t)((i % 500 == 0) ? INT16_MIN : rand() % 200 - 100);
+  }
+  m_samples[1000].acc[2] = INT16_MAX; // delta of the full 16 bit range both ways
+}
+
+static uint8_t packet_make(ferris_codec_encoder_t *p_enc, int pos, uint8_t *p_out, uint16_t *p_len) {
+  int left  = SAMPLE_COUNT - pos;
+  bool full = false;
+  uint8_t n = ferris_codec_encode(p_enc, &m_samples[pos], left > UINT8_MAX ? UINT8_MAX : left, p_out, PACKET_SIZE,
+                                  p_len, &full);
+
+  CHECK(n > 0);
+  CHECK(*p_len <= PACKET_SIZE);
+  CHECK(full || n == left);
+  ferris_codec_encoder_commit(p_enc, &m_samples[pos + n - 1]);
+  return n;
+}
+
+static void test_round_trip(void) {
+  ferris_codec_encoder_t enc = {0};
+  ferris_codec_decoder_t dec;
+  ferris_codec_sample_t out[UINT8_MAX];
+  int packets = 0;
+
+  ferris_codec_encoder_reset(&enc);
+  ferris_codec_decoder_reset(&dec);
+  for (int pos = 0; pos < SAMPLE_COUNT;) {
+    uint8_t buf[PACKET_SIZE];
+    uint16_t len;
+    uint8_t n = packet_make(&enc, pos, buf, &len);
+
+    // the first packet and then one in FERRIS_CODEC_KEYFRAME_INTERVAL is a keyframe
+    CHECK_EQ((buf[0] & FERRIS_CODEC_KEY_FLAG) != 0, packets % FERRIS_CODEC_KEYFRAME_INTERVAL == 0);
+    CHECK_EQ(buf[0] & FERRIS_CODEC_SEQ_MASK, packets & FERRIS_CODEC_SEQ_MASK);
+    CHECK_EQ(ferris_codec_decode(&dec, buf, len, out, UINT8_MAX), n);
+    CHECK(memcmp(out, &m_samples[pos], n * sizeof(out[0])) == 0);
+    pos += n;
+    packets++;
+  }
+  // with 64 LSB of noise the deltas still pack below the 8 bytes of a verbatim sample
+  CHECK(packets * PACKET_SIZE < SAMPLE_COUNT * 7);
+}
+
+static void test_packet_loss(void) {
+  ferris_codec_encoder_t enc = {0};
+  ferris_codec_decoder_t dec;
+  ferris_codec_sample_t out[UINT8_MAX];
+  int packets = 0;
+  int lost    = -1; // index of the lost packet
+
+  ferris_codec_encoder_reset(&enc);
+  ferris_codec_decoder_reset(&dec);
+  for (int pos = 0; pos < SAMPLE_COUNT;) {
+    uint8_t buf[PACKET_SIZE];
+    uint16_t len;
+    uint8_t n = packet_make(&enc, pos, buf, &len);
+    bool key  = (buf[0] & FERRIS_CODEC_KEY_FLAG) != 0;
+
+    if (packets % 37 == 5) {
+      lost = packets;
+    } else if (lost >= 0 && !key) {
+      // no delta packet decodes until the next keyframe
+      CHECK_EQ(ferris_codec_decode(&dec, buf, len, out, UINT8_MAX), -1);
+    } else {
+      lost = -1;
+      CHECK_EQ(ferris_codec_decode(&dec, buf, len, out, UINT8_MAX), n);
+      CHECK(memcmp(out, &m_samples[pos], n * sizeof(out[0])) == 0);
+    }
+    pos += n;
+    packets++;
+  }
+}
+
+static void test_malformed(void) {
+  ferris_codec_encoder_t enc = {0};
+  ferris_codec_decoder_t dec;
+  ferris_codec_sample_t out[UINT8_MAX];
+  uint8_t buf[PACKET_SIZE];
+  uint16_t len;
+  uint8_t n;
+
+  ferris_codec_encoder_reset(&enc);
+  ferris_codec_decoder_reset(&dec);
+  n = packet_make(&enc, 0, buf, &len);
+
+  CHECK_EQ(ferris_codec_decode(&dec, buf, 1, out, UINT8_MAX), -1);
+  CHECK_EQ(ferris_codec_decode(&dec, buf, FERRIS_CODEC_HEADER_SIZE + FERRIS_CODEC_KEY_SIZE - 1, out, UINT8_MAX), -1);
+  CHECK_EQ(ferris_codec_decode(&dec, buf, len - 1, out, UINT8_MAX), -1); // truncated deltas
+  CHECK_EQ(ferris_codec_decode(&dec, buf, len, out, n - 1), -1);         // no room
+  CHECK_EQ(ferris_codec_decode(&dec, buf, len, out, UINT8_MAX), n);
+
+  // a packet repeated by the link layer is a SEQ gap
+  uint8_t next[PACKET_SIZE];
+  uint16_t next_len;
+  int pos = n;
+
+  n = packet_make(&enc, pos, next, &next_len);
+  CHECK_EQ(ferris_codec_decode(&dec, next, next_len, out, UINT8_MAX), n);
+  CHECK_EQ(ferris_codec_decode(&dec, next, next_len, out, UINT8_MAX), -1);
+}
+
+static void test_empty(void) {
+  ferris_codec_encoder_t enc = {0};
+  uint8_t buf[PACKET_SIZE];
+  uint16_t len;
+  bool full;
+
+  ferris_codec_encoder_reset(&enc);
+  CHECK_EQ(ferris_codec_encode(&enc, m_samples, 0, buf, sizeof(buf), &len, &full), 0);
+  CHECK_EQ(len, 0);
+  CHECK_EQ(ferris_codec_encode(&enc, m_samples, 1, buf, FERRIS_CODEC_HEADER_SIZE + FERRIS_CODEC_KEY_SIZE - 1, &len,
+                               &full),
+           0);
+}
+
+int main(void) {
+  samples_make();
+  test_round_trip();
+  test_packet_loss();
+  test_malformed();
+  test_empty();
+  return UNIT_END();
+}
@@ -0,0 +1,148 @@
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "ferris_codec.h"
+#include "ferris_decoder.hpp"
+#include "unit.h"
+
+#define PACKET_SIZE 20
+#define RATE_HZ 50
+#define SAMPLE_COUNT (200 * RATE_HZ) // the 16 bit timestamps wrap every 64 s
+
+struct packet {
+  std::vector<uint8_t> data;
+  size_t first; // index of the first sample
+  uint8_t count;
+};
+
+static uint64_t sample_time(size_t i) {
+  return 1000 + (uint64_t)i * 1024 / RATE_HZ;
+}
+
+static std::vector<ferris_codec_sample_t> samples_make() {
+  std::vector<ferris_codec_sample_t> samples(SAMPLE_COUNT);
+
+  srand(3);
+  for (size_t i = 0; i < samples.size(); i++) {
+    double a = i * 0.02;
+
+    samples[i].timestamp = (uint16_t)sample_time(i);
+    samples[i].acc[0]    = (int16_t)(16000 * cos(a) + rand() % 32 - 16);
+    samples[i].acc[1]    = (int16_t)(16000 * sin(a) + rand() % 32 - 16);
+    samples[i].acc[2]    = (int16_t)(rand() % 100 - 50);
+  }
+  return samples;
+}
+
+static std::vector<packet> packets_make(std::vector<ferris_codec_sample_t> const &samples) {
+  std::vector<packet> packets;
+  ferris_codec_encoder_t enc = {};
+
+  ferris_codec_encoder_reset(&enc);
+  for (size_t pos = 0; pos < samples.size();) {
+    size_t left = samples.size() - pos;
+    packet p;
+    uint16_t len;
+    bool full;
+
+    p.data.resize(PACKET_SIZE);
+    p.first = pos;
+    p.count = ferris_codec_encode(&enc, &samples[pos], left > UINT8_MAX ? UINT8_MAX : (uint8_t)left, p.data.data(),
+                                  PACKET_SIZE, &len, &full);
+    p.data.resize(len);
+    ferris_codec_encoder_commit(&enc, &samples[pos + p.count - 1]);
+    packets.push_back(p);
+    pos += p.count;
+  }
+  return packets;
+}
+
+static bool sample_matches(ferris::sample const &out, std::vector<ferris_codec_sample_t> const &samples, size_t i) {
+  return out.time == sample_time(i) && out.acc[0] == samples[i].acc[0] && out.acc[1] == samples[i].acc[1] &&
+         out.acc[2] == samples[i].acc[2];
+}
+
+static void test_round_trip() {
+  std::vector<ferris_codec_sample_t> samples = samples_make();
+  std::vector<packet> packets                = packets_make(samples);
+  std::vector<ferris::sample> out;
+  ferris::decoder dec;
+  size_t bytes = 0;
+
+  for (packet const &p : packets) {
+    CHECK_EQ(dec.feed(p.data.data(), p.data.size(), out), p.count);
+    bytes += p.data.size();
+  }
+  CHECK_EQ(out.size(), samples.size());
+  for (size_t i = 0; i < out.size() && i < samples.size(); i++) {
+    CHECK(sample_matches(out[i], samples, i));
+  }
+  CHECK_EQ(dec.stats().packets, packets.size());
+  CHECK_EQ(dec.stats().packets_dropped, 0);
+  CHECK_EQ(dec.stats().packets_lost, 0);
+  CHECK_EQ(dec.stats().samples, samples.size());
+  CHECK_EQ(dec.stats().bytes, bytes);
+}
+
+static void test_packet_loss() {
+  std::vector<ferris_codec_sample_t> samples = samples_make();
+  std::vector<packet> packets                = packets_make(samples);
+  std::vector<ferris::sample> out;
+  ferris::decoder dec;
+  size_t lost = 0, dropped = 0, decoded = 0;
+  bool synced = true;
+
+  for (size_t n = 0; n < packets.size(); n++) {
+    packet const &p = packets[n];
+    bool key        = (p.data[0] & FERRIS_CODEC_KEY_FLAG) != 0;
+
+    if (n % 53 == 7 || n % 53 == 8) {
+      lost++; // two in a row
+      synced = false;
+      continue;
+    }
+    synced = synced || key;
+    if (!synced) {
+      CHECK_EQ(dec.feed(p.data.data(), p.data.size(), out), 0);
+      dropped++;
+      continue;
+    }
+    CHECK_EQ(dec.feed(p.data.data(), p.data.size(), out), p.count);
+    // the times stay on the line across the gap
+    for (size_t i = 0; i < p.count; i++) {
+      CHECK(sample_matches(out[decoded + i], samples, p.first + i));
+    }
+    decoded += p.count;
+  }
+  CHECK_EQ(out.size(), decoded);
+  CHECK_EQ(dec.stats().packets_lost, lost);
+  CHECK_EQ(dec.stats().packets_dropped, dropped);
+  CHECK(decoded > samples.size() * 3 / 4);
+}
+
+static void test_reset() {
+  std::vector<ferris_codec_sample_t> samples = samples_make();
+  std::vector<packet> packets                = packets_make(samples);
+  std::vector<ferris::sample> out;
+  ferris::decoder dec;
+
+  CHECK_EQ(dec.feed(packets[0].data.data(), packets[0].data.size(), out), packets[0].count);
+  dec.reset();
+  // a delta packet after a reconnection waits for the keyframe
+  CHECK_EQ(dec.feed(packets[1].data.data(), packets[1].data.size(), out), 0);
+  CHECK_EQ(dec.feed(packets[FERRIS_CODEC_KEYFRAME_INTERVAL].data.data(),
+                    packets[FERRIS_CODEC_KEYFRAME_INTERVAL].data.size(), out),
+           packets[FERRIS_CODEC_KEYFRAME_INTERVAL].count);
+  CHECK_EQ(dec.stats().packets_lost, FERRIS_CODEC_KEYFRAME_INTERVAL - 2); // counted from the first packet after the reset
+  CHECK_EQ(dec.stats().packets_dropped, 1);
+  CHECK_EQ(dec.feed(packets[0].data.data(), 1, out), 0); // truncated
+  CHECK_EQ(dec.stats().packets_dropped, 2);
+}
+
+int main() {
+  test_round_trip();
+  test_packet_loss();
+  test_reset();
+  return UNIT_END();
+}
@@ -0,0 +1,77 @@
+#include "fake_time.h"
+#include "ferris_energy.h"
+#include "ferris_time.h"
+#include "unit.h"
+
+#define SECOND FERRIS_TIME_TICKS_PER_SECOND
+
+static void test_states(void) {
+  ferris_energy_t energy;
+
+  fake_time_set(0xFFFF0000); // the clock wraps during the test
+  ferris_energy_init();
+  ferris_energy_state_set(FERRIS_ENERGY_RADIO_ADVERTISING);
+  ferris_energy_state_set(FERRIS_ENERGY_SENSOR_CYCLE);
+
+  // an hour waking up once a second for 1 ms
+  for (int i = 0; i < 3600; i++) {
+    ferris_energy_state_set(FERRIS_ENERGY_CPU_SLEEP);
+    fake_time_advance(SECOND - 33);
+    ferris_energy_state_set(FERRIS_ENERGY_CPU_RUN);
+    ferris_energy_count(FERRIS_ENERGY_WAKEUPS, 1);
+    fake_time_advance(33);
+  }
+  ferris_energy_state_set(FERRIS_ENERGY_CPU_RUN); // no change
+  ferris_energy_snapshot(&energy);
+
+  // 33 ticks are 1.007 ms, the fraction of a second carries over
+  CHECK_EQ(energy.state_ms[FERRIS_ENERGY_CPU_RUN], 3600 * 33 * 1000 / SECOND);
+  // each state rounds down to the ms on its own
+  CHECK_EQ(energy.state_ms[FERRIS_ENERGY_CPU_RUN] + energy.state_ms[FERRIS_ENERGY_CPU_SLEEP], 3600000 - 1);
+  CHECK_EQ(energy.state_ms[FERRIS_ENERGY_RADIO_ADVERTISING], 3600000);
+  CHECK_EQ(energy.state_ms[FERRIS_ENERGY_RADIO_IDLE], 0);
+  CHECK_EQ(energy.state_ms[FERRIS_ENERGY_SENSOR_CYCLE], 3600000);
+  CHECK_EQ(energy.counters[FERRIS_ENERGY_WAKEUPS], 3600);
+  // 2600 uA * 3.625 s + 4 uA * 3596 s + 60 uA + 70 uA for an hour, + 50 nC per wake-up
+  CHECK_EQ(energy.charge_uah, (2600 * 3625ULL + 4 * 3596375ULL + 130 * 3600000ULL + 50 * 3600ULL) / 3600000);
+}
+
+static void test_snapshot_continues(void) {
+  ferris_energy_t energy;
+
+  fake_time_set(0);
+  ferris_energy_init();
+  ferris_energy_state_set(FERRIS_ENERGY_SENSOR_GYRO);
+  fake_time_advance(SECOND / 2);
+  ferris_energy_snapshot(&energy);
+  CHECK_EQ(energy.state_ms[FERRIS_ENERGY_SENSOR_GYRO], 500);
+  fake_time_advance(SECOND / 2);
+  ferris_energy_snapshot(&energy);
+  CHECK_EQ(energy.state_ms[FERRIS_ENERGY_SENSOR_GYRO], 1000);
+  CHECK_EQ(energy.state_ms[FERRIS_ENERGY_SENSOR_SLEEP], 0);
+}
+
+static void test_counters(void) {
+  ferris_energy_t energy;
+
+  fake_time_set(0);
+  ferris_energy_init();
+  ferris_energy_count(FERRIS_ENERGY_HVX, 2400);
+  ferris_energy_counter_set(FERRIS_ENERGY_TWI_TRANSACTIONS, 7);
+  ferris_energy_counter_set(FERRIS_ENERGY_TWI_TRANSACTIONS, 9);
+  ferris_energy_snapshot(&energy);
+  CHECK_EQ(energy.counters[FERRIS_ENERGY_HVX], 2400);
+  CHECK_EQ(energy.counters[FERRIS_ENERGY_TWI_TRANSACTIONS], 9);
+  CHECK_EQ(energy.charge_uah, 2); // 3 uC per notification
+
+  ferris_energy_init(); // starts over
+  ferris_energy_snapshot(&energy);
+  CHECK_EQ(energy.counters[FERRIS_ENERGY_HVX], 0);
+}
+
+int main(void) {
+  test_states();
+  test_snapshot_continues();
+  test_counters();
+  return UNIT_END();
+}
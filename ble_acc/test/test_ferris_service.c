@@ -0,0 +1,295 @@
+#include <string.h>
+
+#include "app_util.h"
+#include "fake_ble.h"
+#include "fake_fstorage.h"
+#include "fake_sched.h"
+#include "fake_time.h"
+#include "fake_timer.h"
+#include "ferris_service.h"
+#include "unit.h"
+
+#define UUID_ACC 0x6050
+#define UUID_ACC_TIMED 0x6058
+#define UUID_LOG 0x6053
+#define UUID_BULK_CP 0x6054
+#define UUID_POLICY (((uint16_t)('P') << 8) + 'O')
+
+#define SAMPLE_TICKS 655 // 50 Hz in 32768 Hz ticks
+#define LOG_SAMPLES 600
+
+static ferris_service_t m_ferris;
+static uint8_t m_acc[6];
+static uint32_t m_timestamp;
+
+static void evt(ble_evt_t *p_ble_evt) {
+  ferris_on_ble_evt(&m_ferris, p_ble_evt);
+}
+
+static uint16_t value_handle(uint16_t uuid) {
+  return fake_ble_char_handles(uuid).value_handle;
+}
+
+static void setup(uint8_t tx_packets, bool log_enabled) {
+  ferris_service_init_t init;
+
+  fake_ble_reset(tx_packets);
+  fake_sched_init(FAKE_SCHED_QUEUE_SIZE);
+  fake_timer_reset();
+  fake_fstorage_erase_all();
+  fake_time_set(0);
+  m_timestamp = 0;
+
+  memset(&init, 0, sizeof(init));
+  init.p_acceleration_data = m_acc;
+  init.log_enabled         = log_enabled;
+  memset(&m_ferris, 0, sizeof(m_ferris));
+  CHECK_EQ(ferris_service_init(&m_ferris, &init), NRF_SUCCESS);
+
+  // every sample is reported, the suppression filter has its own tests
+  ferris_policy_t policy = m_ferris.policy;
+  policy.mode            = FERRIS_POLICY_ALL;
+  evt(fake_ble_write(value_handle(UUID_POLICY), (uint8_t const *)&policy, sizeof(policy)));
+  CHECK_EQ(m_ferris.policy.mode, FERRIS_POLICY_ALL);
+}
+
+// Sample n, timestamped n * SAMPLE_TICKS.
+static uint32_t sample_send(int n) {
+  int16_t acc[3] = {(int16_t)(n * 7), (int16_t)(-n * 3), (int16_t)(16384 - n)};
+
+  for (int axis = 0; axis < 3; axis++) {
+    uint16_big_encode((uint16_t)acc[axis], m_acc + axis * 2);
+  }
+  m_timestamp = (uint32_t)n * SAMPLE_TICKS;
+  return ferris_acceleration_send(&m_ferris, m_timestamp);
+}
+
+// The sample a timestamped notification carries.
+static int timed_sample(fake_ble_notification_t const *p_notification) {
+  CHECK_EQ(p_notification->handle, value_handle(UUID_ACC_TIMED));
+  CHECK_EQ(p_notification->len, FERRIS_TIMED_SAMPLE_SIZE);
+  return (int)(uint32_decode(p_notification->data) / SAMPLE_TICKS);
+}
+
+static void tx_complete(uint8_t count) {
+  evt(fake_ble_tx_complete(count));
+}
+
+static void test_tx_credits(void) {
+  fake_ble_notification_t notification;
+
+  setup(3, false);
+  evt(fake_ble_connect());
+  evt(fake_ble_subscribe(UUID_ACC_TIMED, true));
+  CHECK_EQ(m_ferris.tx_free, 3);
+
+  for (int n = 0; n < 7; n++) {
+    CHECK_EQ(sample_send(n), NRF_SUCCESS);
+  }
+  // the credits ran out, the rest waits without asking the SoftDevice
+  CHECK_EQ(fake_ble_notification_count(), 3);
+  CHECK_EQ(m_ferris.tx_free, 0);
+  CHECK_EQ(m_ferris.acc_queue_count, 4);
+  CHECK_EQ(fake_ble_no_tx_packets(), 0);
+
+  tx_complete(2);
+  CHECK_EQ(fake_ble_notification_count(), 5);
+  tx_complete(3);
+  CHECK_EQ(fake_ble_notification_count(), 7);
+  CHECK_EQ(m_ferris.acc_queue_count, 0);
+  CHECK_EQ(m_ferris.tx_free, 1);
+  for (int n = 0; n < 7; n++) {
+    CHECK(fake_ble_notification_pop(&notification));
+    CHECK_EQ(timed_sample(&notification), n);
+  }
+
+  // another user of the link takes the buffers the count says are free
+  tx_complete(fake_ble_tx_in_flight());
+  CHECK_EQ(m_ferris.tx_free, 3);
+  fake_ble_tx_take(3);
+  for (int n = 100; n < 100 + FERRIS_TX_QUEUE_SIZE + 3; n++) {
+    CHECK_EQ(sample_send(n), NRF_SUCCESS);
+  }
+  CHECK_EQ(fake_ble_no_tx_packets(), 1); // learns the credits are gone, asks once
+  CHECK_EQ(m_ferris.tx_free, 0);
+  // more than the queue holds while the link is stuck, the oldest go
+  CHECK_EQ(m_ferris.tx_stats.acc_dropped, 3);
+  CHECK_EQ(fake_ble_notification_count(), 0);
+
+  tx_complete(3);
+  CHECK_EQ(fake_ble_notification_count(), 3);
+  tx_complete(3);
+  tx_complete(3);
+  CHECK_EQ(fake_ble_notification_count(), FERRIS_TX_QUEUE_SIZE);
+  CHECK_EQ(fake_ble_no_tx_packets(), 1);
+  for (int n = 103; n < 100 + FERRIS_TX_QUEUE_SIZE + 3; n++) {
+    CHECK(fake_ble_notification_pop(&notification));
+    CHECK_EQ(timed_sample(&notification), n);
+  }
+  CHECK_EQ(m_ferris.tx_stats.packets_sent, 7 + FERRIS_TX_QUEUE_SIZE);
+}
+
+static void test_whole_samples(void) {
+  fake_ble_notification_t notification;
+
+  setup(3, false);
+  evt(fake_ble_connect());
+  evt(fake_ble_subscribe(UUID_ACC, true));
+  evt(fake_ble_subscribe(UUID_ACC_TIMED, true));
+
+  // a sample takes two buffers, the second waits rather than going out half
+  sample_send(1);
+  sample_send(2);
+  CHECK_EQ(fake_ble_notification_count(), 2);
+  CHECK_EQ(m_ferris.tx_free, 1);
+  tx_complete(1);
+  CHECK_EQ(fake_ble_notification_count(), 4);
+  CHECK_EQ(m_ferris.tx_stats.acc_dropped, 0);
+
+  for (int n = 1; n <= 2; n++) {
+    CHECK(fake_ble_notification_pop(&notification));
+    CHECK_EQ(timed_sample(&notification), n);
+    CHECK(fake_ble_notification_pop(&notification));
+    CHECK_EQ(notification.handle, value_handle(UUID_ACC));
+    CHECK_EQ(notification.len, 6);
+  }
+
+  // nothing is sent after the link is gone
+  evt(fake_ble_disconnect());
+  CHECK_EQ(sample_send(3), NRF_ERROR_INVALID_STATE);
+  CHECK_EQ(fake_ble_notification_count(), 0);
+}
+
+// Hand every notification back as sent until the service has nothing more to send.
+static void link_run(void) {
+  while (fake_ble_tx_in_flight() > 0) {
+    tx_complete(fake_ble_tx_in_flight());
+  }
+}
+
+static void bulk_write(uint8_t op, uint32_t arg, uint8_t arg_len) {
+  uint8_t data[5] = {op};
+
+  uint32_encode(arg, data + 1);
+  evt(fake_ble_write(value_handle(UUID_BULK_CP), data, 1 + arg_len));
+}
+
+// Frame SEQs in the order they were sent, checked against the log. Returns the count, the
+// control point response stays in p_rsp.
+static uint16_t bulk_frames(uint16_t *p_seq, uint16_t max, uint32_t const *p_pos, uint8_t *p_rsp) {
+  fake_ble_notification_t notification;
+  ferris_log_entry_t entry;
+  uint16_t count = 0;
+
+  while (fake_ble_notification_pop(&notification)) {
+    if (notification.handle == value_handle(UUID_BULK_CP)) {
+      memcpy(p_rsp, notification.data, notification.len);
+      continue;
+    }
+    CHECK_EQ(notification.handle, value_handle(UUID_LOG));
+    uint16_t seq = uint16_decode(notification.data);
+    CHECK(ferris_log_read(p_pos[seq], &entry));
+    CHECK_EQ(notification.len, FERRIS_BULK_FRAME_HEADER_SIZE + entry.len);
+    CHECK(memcmp(notification.data + FERRIS_BULK_FRAME_HEADER_SIZE, entry.data, entry.len) == 0);
+    if (count < max) {
+      p_seq[count] = seq;
+    }
+    count++;
+  }
+  return count;
+}
+
+static void test_bulk_windows(void) {
+  static uint32_t pos[LOG_SAMPLES];
+  uint16_t seq[FERRIS_BULK_WINDOW * 2];
+  uint8_t rsp[FERRIS_BULK_RSP_MAX_LEN];
+  ferris_log_entry_t entry;
+  uint16_t records = 0;
+
+  setup(4, true);
+  // a ride while nobody listens goes to flash
+  for (int n = 0; n < LOG_SAMPLES; n++) {
+    CHECK_EQ(sample_send(n), NRF_SUCCESS);
+    fake_fstorage_run();
+  }
+  evt(fake_ble_connect());
+  fake_fstorage_run();
+  for (uint32_t p = ferris_log_begin(); ferris_log_read(p, &entry); p = entry.next) {
+    pos[records++] = entry.pos;
+  }
+  CHECK(records > FERRIS_BULK_WINDOW * 2);
+  uint32_t end = ferris_log_end();
+
+  evt(fake_ble_subscribe(UUID_BULK_CP, true));
+  bulk_write(FERRIS_BULK_OP_START, 0, 4);
+  link_run();
+  CHECK_EQ(bulk_frames(seq, 0, pos, rsp), 0);
+  CHECK_EQ(rsp[0], FERRIS_BULK_RSP_START);
+  CHECK_EQ(rsp[1], FERRIS_BULK_STATUS_NOT_SUBSCRIBED);
+
+  evt(fake_ble_subscribe(UUID_LOG, true));
+  bulk_write(FERRIS_BULK_OP_START, 0, 4);
+  link_run();
+  // credits come back, still no more than a window in flight
+  memset(rsp, 0, sizeof(rsp));
+  CHECK_EQ(bulk_frames(seq, FERRIS_BULK_WINDOW, pos, rsp), FERRIS_BULK_WINDOW);
+  for (uint16_t n = 0; n < FERRIS_BULK_WINDOW; n++) {
+    CHECK_EQ(seq[n], n);
+  }
+  CHECK_EQ(rsp[0], FERRIS_BULK_RSP_START);
+  CHECK_EQ(rsp[1], FERRIS_BULK_STATUS_OK);
+  CHECK_EQ(uint32_decode(rsp + 2), pos[0]);
+  CHECK_EQ(uint32_decode(rsp + 6), end);
+
+  // ACK opens the window by as much as it acknowledges
+  bulk_write(FERRIS_BULK_OP_ACK, 4, 2);
+  link_run();
+  CHECK_EQ(bulk_frames(seq, FERRIS_BULK_WINDOW, pos, rsp), 4);
+  CHECK_EQ(seq[0], FERRIS_BULK_WINDOW);
+  CHECK_EQ(seq[3], FERRIS_BULK_WINDOW + 3);
+
+  // NACK sends the frame again, and only that
+  bulk_write(FERRIS_BULK_OP_NACK, 5, 2);
+  link_run();
+  CHECK_EQ(bulk_frames(seq, FERRIS_BULK_WINDOW, pos, rsp), 1);
+  CHECK_EQ(seq[0], 5);
+
+  // ACK of frames never sent, and NACK of acknowledged ones, are ignored
+  bulk_write(FERRIS_BULK_OP_ACK, 100, 2);
+  bulk_write(FERRIS_BULK_OP_NACK, 2, 2);
+  link_run();
+  CHECK_EQ(bulk_frames(seq, FERRIS_BULK_WINDOW, pos, rsp), 0);
+  CHECK_EQ(m_ferris.bulk_acked, 4);
+
+  // acknowledge everything until the log is sent
+  uint16_t next = FERRIS_BULK_WINDOW + 4;
+  memset(rsp, 0, sizeof(rsp));
+  while (m_ferris.bulk_active && next <= records) {
+    bulk_write(FERRIS_BULK_OP_ACK, next, 2);
+    link_run();
+    next += bulk_frames(seq, 0, pos, rsp);
+  }
+  CHECK(!m_ferris.bulk_active);
+  CHECK_EQ(next, records);
+  CHECK_EQ(rsp[0], FERRIS_BULK_RSP_DONE);
+  CHECK_EQ(uint32_decode(rsp + 1), end);
+
+  // the checkpoint survives a restart, START 0 resumes after it
+  fake_fstorage_run();
+  CHECK_EQ(ferris_log_checkpoint_get(), end);
+  CHECK_EQ(ferris_log_init(), NRF_SUCCESS);
+  CHECK_EQ(ferris_log_checkpoint_get(), end);
+  bulk_write(FERRIS_BULK_OP_START, 0, 4);
+  link_run();
+  memset(rsp, 0, sizeof(rsp));
+  CHECK_EQ(bulk_frames(seq, 0, pos, rsp), 0);
+  CHECK_EQ(rsp[0], FERRIS_BULK_RSP_DONE);
+  CHECK(!m_ferris.bulk_active);
+}
+
+int main(void) {
+  test_tx_credits();
+  test_whole_samples();
+  test_bulk_windows();
+  return UNIT_END();
+}
@@ -0,0 +1,343 @@
+#include <string.h>
+
+#include "app_scheduler.h"
+#include "fake_mpu6050.h"
+#include "fake_sched.h"
+#include "fake_twi.h"
+#include "mpu6050.h"
+#include "mpu_reg.h"
+#include "unit.h"
+
+#define INT_PIN 8
+
+static nrf_drv_twi_t m_twi = NRF_DRV_TWI_INSTANCE(0);
+
+static uint32_t m_results[16]; // by completion order
+static uintptr_t m_contexts[16];
+static uint8_t m_completions;
+
+static void record_handler(uint32_t result, void *p_context) {
+  if (m_completions < sizeof(m_results) / sizeof(m_results[0])) {
+    m_results[m_completions]  = result;
+    m_contexts[m_completions] = (uintptr_t)p_context;
+  }
+  m_completions++;
+}
+
+// Run the bus and the scheduler until both are idle, as the main loop would.
+static void settle(void) {
+  do {
+    fake_twi_run();
+    app_sched_execute();
+  } while (mpu6050_sched_flush() || fake_twi_busy());
+}
+
+// Power the sensor on and bring the driver up as at boot.
+static void setup(void) {
+  fake_sched_init(FAKE_SCHED_QUEUE_SIZE);
+  fake_twi_reset();
+  fake_mpu6050_reset();
+  nrf_drv_twi_init(&m_twi, NULL, mpu6050_twi_evt_handler, NULL);
+  fake_twi_auto_complete(true);
+  CHECK(mpu6050_init(&m_twi, FAKE_MPU6050_ADDRESS));
+  fake_twi_auto_complete(false);
+  m_completions = 0;
+}
+
+static void sample_make(int n, int16_t acc[3]) {
+  acc[0] = (int16_t)(n * 3);
+  acc[1] = (int16_t)(-n * 5);
+  acc[2] = (int16_t)(16384 + n);
+}
+
+static bool sample_equal(uint8_t const *p_data, int n) {
+  int16_t acc[3];
+
+  sample_make(n, acc);
+  for (int axis = 0; axis < 3; axis++) {
+    if ((int16_t)((p_data[axis * 2] << 8) | p_data[axis * 2 + 1]) != acc[axis]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void samples_push(int first, int count) {
+  int16_t acc[3];
+
+  for (int n = first; n < first + count; n++) {
+    sample_make(n, acc);
+    fake_mpu6050_sample(acc);
+  }
+}
+
+static void test_init(void) {
+  setup();
+  CHECK_EQ(fake_mpu6050_reg(SMPLRT_DIV), 19);
+  CHECK_EQ(fake_mpu6050_reg(CONFIG), DLPF_21HZ);
+  CHECK_EQ(fake_mpu6050_reg(GYRO_CONFIG), GYRO_FS_250);
+  CHECK_EQ(fake_mpu6050_reg(ACCEL_CONFIG), ACCEL_FS_2g);
+  CHECK_EQ(fake_mpu6050_reg(PWR_MGMT_1), CLKSEL_PllGyroX | TEMP_DIS | CYCLE);
+  CHECK_EQ(fake_mpu6050_reg(PWR_MGMT_2), gyroscope_STBY | LP_WAKE_CTRL_5);
+  CHECK_EQ(mpu6050_power_get(), MPU6050_POWER_CYCLE);
+
+  // nobody answers at another address
+  fake_twi_auto_complete(true);
+  CHECK(!mpu6050_init(&m_twi, FAKE_MPU6050_ADDRESS + 1));
+  CHECK(mpu6050_init(&m_twi, FAKE_MPU6050_ADDRESS));
+  fake_twi_auto_complete(false);
+}
+
+static void test_fifo_drain(void) {
+  mpu6050_fifo_read_t read;
+  uint8_t data[MPU6050_FIFO_MAX_BURST * MPU6050_SAMPLE_SIZE];
+
+  setup();
+  CHECK_EQ(mpu6050_fifo_enable(true), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(mpu6050_power_get(), MPU6050_POWER_ACCEL);
+  CHECK_EQ(fake_mpu6050_reg(PWR_MGMT_1) & CYCLE, 0);
+  samples_push(0, 50);
+
+  // more than a burst, the rest stays in the FIFO
+  read.p_data      = data;
+  read.max_samples = MPU6050_FIFO_MAX_BURST;
+  CHECK_EQ(mpu6050_fifo_read_async(&read, record_handler, NULL), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(m_completions, 1);
+  CHECK_EQ(m_results[0], NRF_SUCCESS);
+  CHECK(!read.overflow);
+  CHECK_EQ(read.count, MPU6050_FIFO_MAX_BURST);
+  for (int n = 0; n < read.count; n++) {
+    CHECK(sample_equal(data + n * MPU6050_SAMPLE_SIZE, n));
+  }
+
+  CHECK_EQ(mpu6050_fifo_read_async(&read, record_handler, NULL), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(read.count, 50 - MPU6050_FIFO_MAX_BURST);
+  CHECK(sample_equal(data, MPU6050_FIFO_MAX_BURST));
+  CHECK_EQ(fake_mpu6050_fifo_count(), 0);
+
+  // an empty FIFO costs the count read only
+  uint32_t transfers = fake_twi_transfers();
+  CHECK_EQ(mpu6050_fifo_read_async(&read, record_handler, NULL), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(read.count, 0);
+  CHECK_EQ(fake_twi_transfers() - transfers, 1);
+
+  CHECK_EQ(mpu6050_fifo_enable(false), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(mpu6050_power_get(), MPU6050_POWER_CYCLE);
+  CHECK_EQ(fake_mpu6050_reg(PWR_MGMT_1) & CYCLE, CYCLE);
+}
+
+static void test_fifo_overflow_resync(void) {
+  mpu6050_fifo_read_t read;
+  uint8_t data[MPU6050_FIFO_MAX_BURST * MPU6050_SAMPLE_SIZE];
+
+  setup();
+  CHECK_EQ(mpu6050_fifo_enable(true), NRF_SUCCESS);
+  settle();
+
+  // 1200 bytes into 1024, the oldest frames lost their first bytes
+  samples_push(0, 200);
+  CHECK_EQ(fake_mpu6050_fifo_count(), MPU6050_FIFO_SIZE);
+  CHECK(fake_mpu6050_reg(INT_STATUS) & FIFO_OFLOW_INT);
+
+  uint32_t resets     = fake_mpu6050_writes(USER_CTRL);
+  read.p_data         = data;
+  read.max_samples    = MPU6050_FIFO_MAX_BURST;
+  CHECK_EQ(mpu6050_fifo_read_async(&read, record_handler, NULL), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(m_completions, 1);
+  CHECK_EQ(m_results[0], NRF_SUCCESS);
+  CHECK(read.overflow);
+  CHECK_EQ(read.count, 0);
+  CHECK_EQ(fake_mpu6050_writes(USER_CTRL) - resets, 1);
+  CHECK_EQ(fake_mpu6050_fifo_count(), 0);
+  CHECK(fake_mpu6050_reg(USER_CTRL) & USER_FIFO_EN);
+
+  // the next drain is aligned again
+  samples_push(1000, 3);
+  CHECK_EQ(mpu6050_fifo_read_async(&read, record_handler, NULL), NRF_SUCCESS);
+  settle();
+  CHECK(!read.overflow);
+  CHECK_EQ(read.count, 3);
+  for (int n = 0; n < 3; n++) {
+    CHECK(sample_equal(data + n * MPU6050_SAMPLE_SIZE, 1000 + n));
+  }
+
+  CHECK_EQ(mpu6050_fifo_enable(false), NRF_SUCCESS);
+  settle();
+}
+
+static void test_no_elision_behind_queued_write(void) {
+  mpu6050_bus_stats_t before;
+  mpu6050_bus_stats_t after;
+
+  setup();
+  mpu6050_bus_stats_get(&before);
+
+  // the first write is still queued when the same value is written again
+  CHECK_EQ(mpu6050_register_write_async(SMPLRT_DIV, 9, record_handler, (void *)1), NRF_SUCCESS);
+  CHECK_EQ(mpu6050_register_write_async(SMPLRT_DIV, 9, record_handler, (void *)2), NRF_SUCCESS);
+  fake_twi_fail_next(NRF_DRV_TWI_EVT_DATA_NACK);
+  settle();
+  CHECK_EQ(m_completions, 2);
+  CHECK(m_results[0] != NRF_SUCCESS);
+  CHECK_EQ(m_results[1], NRF_SUCCESS);
+  CHECK_EQ(fake_mpu6050_reg(SMPLRT_DIV), 9);
+  mpu6050_bus_stats_get(&after);
+  CHECK_EQ(after.elided - before.elided, 0);
+  CHECK_EQ(after.errors - before.errors, 1);
+
+  // now the register holds it
+  uint32_t writes = fake_mpu6050_writes(SMPLRT_DIV);
+  CHECK_EQ(mpu6050_register_write_async(SMPLRT_DIV, 9, record_handler, (void *)3), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(m_completions, 3);
+  CHECK_EQ(m_results[2], NRF_SUCCESS);
+  CHECK_EQ(fake_mpu6050_writes(SMPLRT_DIV), writes);
+  mpu6050_bus_stats_get(&after);
+  CHECK_EQ(after.elided - before.elided, 1);
+
+  // a failed write leaves the value unknown, the same value goes to the bus again
+  CHECK_EQ(mpu6050_register_write_async(MOT_THR, 20, NULL, NULL), NRF_SUCCESS);
+  fake_twi_fail_next(NRF_DRV_TWI_EVT_DATA_NACK);
+  settle();
+  CHECK_EQ(fake_mpu6050_reg(MOT_THR), 0);
+  CHECK_EQ(mpu6050_register_write_async(MOT_THR, 20, NULL, NULL), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(fake_mpu6050_reg(MOT_THR), 20);
+}
+
+static void test_update_unknown_register(void) {
+  setup();
+  // MOT_DETECT_CTRL was never written, its value has to come from the bus
+  fake_mpu6050_reg_set(MOT_DETECT_CTRL, 0x30);
+  uint32_t transfers = fake_twi_transfers();
+  CHECK_EQ(mpu6050_register_update_async(MOT_DETECT_CTRL, 0x03, 0x01, record_handler, NULL), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(m_completions, 1);
+  CHECK_EQ(m_results[0], NRF_SUCCESS);
+  CHECK_EQ(fake_mpu6050_reg(MOT_DETECT_CTRL), 0x31);
+  CHECK_EQ(fake_twi_transfers() - transfers, 2);
+
+  // known now, no read
+  transfers = fake_twi_transfers();
+  CHECK_EQ(mpu6050_register_update_async(MOT_DETECT_CTRL, 0x30, 0x10, NULL, NULL), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(fake_mpu6050_reg(MOT_DETECT_CTRL), 0x11);
+  CHECK_EQ(fake_twi_transfers() - transfers, 1);
+
+  CHECK_EQ(mpu6050_register_update_async(INT_STATUS, 1, 1, NULL, NULL), NRF_ERROR_INVALID_PARAM);
+}
+
+static void test_queue_full(void) {
+  setup();
+  for (int n = 0; n < MPU6050_TXN_QUEUE_SIZE; n++) {
+    CHECK_EQ(mpu6050_register_write_async(MOT_THR, (uint8_t)(n + 1), NULL, NULL), NRF_SUCCESS);
+  }
+  CHECK_EQ(mpu6050_register_write_async(MOT_THR, 100, NULL, NULL), NRF_ERROR_NO_MEM);
+  settle();
+  CHECK_EQ(fake_mpu6050_reg(MOT_THR), MPU6050_TXN_QUEUE_SIZE);
+  CHECK_EQ(mpu6050_register_write_async(MOT_THR, 100, NULL, NULL), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(fake_mpu6050_reg(MOT_THR), 100);
+}
+
+static void test_sched_backlog(void) {
+  uint8_t values[3];
+
+  setup();
+  fake_sched_init(1);
+  for (uintptr_t n = 0; n < 3; n++) {
+    CHECK_EQ(mpu6050_register_read_async(PWR_MGMT_1, &values[n], 1, record_handler, (void *)n), NRF_SUCCESS);
+  }
+  fake_twi_run();
+  CHECK_EQ(fake_sched_pending(), 1);
+
+  // two completions wait for the scheduler, nothing new goes on the bus
+  CHECK_EQ(mpu6050_register_write_async(MOT_THR, 7, NULL, NULL), NRF_ERROR_NO_MEM);
+  CHECK(!fake_twi_busy());
+
+  while (true) {
+    app_sched_execute();
+    if (!mpu6050_sched_flush()) {
+      break;
+    }
+  }
+  CHECK_EQ(m_completions, 3);
+  for (uintptr_t n = 0; n < 3; n++) {
+    CHECK_EQ(m_contexts[n], n);
+    CHECK_EQ(m_results[n], NRF_SUCCESS);
+    CHECK_EQ(values[n], fake_mpu6050_reg(PWR_MGMT_1));
+  }
+  CHECK_EQ(mpu6050_register_write_async(MOT_THR, 7, NULL, NULL), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(fake_mpu6050_reg(MOT_THR), 7);
+  fake_sched_init(FAKE_SCHED_QUEUE_SIZE);
+}
+
+static void test_power_modes(void) {
+  int16_t acc[3] = {1, 2, 3};
+
+  setup();
+  CHECK_EQ(mpu6050_channels_set(MPU6050_CHANNEL_GYRO | MPU6050_CHANNEL_TEMP), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(mpu6050_power_get(), MPU6050_POWER_GYRO);
+  CHECK_EQ(fake_mpu6050_reg(PWR_MGMT_1), CLKSEL_PllGyroX);
+  CHECK_EQ(fake_mpu6050_reg(PWR_MGMT_2) & gyroscope_STBY, 0);
+
+  CHECK_EQ(mpu6050_enter_sleep(), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(mpu6050_power_get(), MPU6050_POWER_SLEEP);
+  CHECK(!fake_mpu6050_sample(acc));
+
+  CHECK_EQ(mpu6050_channels_set(MPU6050_CHANNEL_ACCEL), NRF_SUCCESS);
+  CHECK_EQ(mpu6050_wake_up(), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(mpu6050_power_get(), MPU6050_POWER_CYCLE);
+  CHECK_EQ(fake_mpu6050_reg(PWR_MGMT_1), CLKSEL_PllGyroX | TEMP_DIS | CYCLE);
+  CHECK_EQ(fake_mpu6050_reg(PWR_MGMT_2) & gyroscope_STBY, gyroscope_STBY);
+
+  // cycle mode tops out at 40 Hz
+  CHECK_EQ(mpu6050_set_sample_period(MPU6050_CYCLE_MIN_PERIOD), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(fake_mpu6050_reg(SMPLRT_DIV), MPU6050_CYCLE_MIN_PERIOD - 1);
+  CHECK_EQ(fake_mpu6050_reg(PWR_MGMT_2) & LP_WAKE_CTRL_MASK, LP_WAKE_CTRL_40);
+  CHECK_EQ(mpu6050_set_sample_period(0), NRF_ERROR_INVALID_PARAM);
+}
+
+static void test_int_pin(void) {
+  setup();
+  fake_mpu6050_int_pin_set(INT_PIN);
+  fake_twi_auto_complete(true);
+  CHECK(mpu6050_int_pin_check(INT_PIN));
+  CHECK(!mpu6050_int_pin_check(INT_PIN + 1));
+  fake_twi_auto_complete(false);
+
+  // latched until INT_STATUS is read
+  uint8_t status = 0;
+  CHECK_EQ(mpu6050_int_enable(MOT_INT), NRF_SUCCESS);
+  settle();
+  fake_mpu6050_motion();
+  CHECK(fake_mpu6050_int_level());
+  CHECK_EQ(mpu6050_int_status_read_async(&status, record_handler, NULL), NRF_SUCCESS);
+  settle();
+  CHECK_EQ(status & MOT_INT, MOT_INT);
+  CHECK(!fake_mpu6050_int_level());
+}
+
+int main(void) {
+  test_init();
+  test_fifo_drain();
+  test_fifo_overflow_resync();
+  test_no_elision_behind_queued_write();
+  test_update_unknown_register();
+  test_queue_full();
+  test_sched_backlog();
+  test_power_modes();
+  test_int_pin();
+  return UNIT_END();
+}
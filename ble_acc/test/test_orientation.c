@@ -0,0 +1,145 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "ferris_orientation.h"
+#include "unit.h"
+
+#define PAIR_COUNT 1000000
+// the >> 2 of the samples is worth up to 4 units per axis of the cross product at full
+// scale, the rounding half a unit
+#define LENGTH_TOLERANCE 8
+#define FLOAT_TO_FIXED (40.96 * 40.96) // |U x V|^2 of 1g = 10 vectors to 1g = 4096 vectors
+
+static void sample_encode(int16_t const acc[3], uint8_t *p_value) {
+  for (int i = 0; i < 3; i++) {
+    p_value[i * 2]     = (uint8_t)((uint16_t)acc[i] >> 8);
+    p_value[i * 2 + 1] = (uint8_t)acc[i];
+  }
+}
+
+static int16_t clamp(double v) {
+  return (int16_t)(v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : lround(v)));
+}
+
+static double uniform(double lo, double hi) {
+  return lo + (hi - lo) * rand() / RAND_MAX;
+}
+
+// Both paths fed the same sample bytes. Returns the float |U x V|^2, p_fixed gets the fixed one.
+static float change_both(int16_t const a[3], int16_t const b[3], uint32_t *p_fixed) {
+  uint8_t va[6], vb[6];
+  int16_t ia[3], ib[3];
+  float fa[3], fb[3];
+
+  sample_encode(a, va);
+  sample_encode(b, vb);
+  ferris_orientation_decode(va, ia);
+  ferris_orientation_decode(vb, ib);
+  ferris_orientation_decode_float(va, fa);
+  ferris_orientation_decode_float(vb, fb);
+  *p_fixed = ferris_orientation_change(ia, ib);
+  return ferris_orientation_change_float(fa, fb);
+}
+
+// Gravity of 0.8 to 1.2 g, the second sample turned by up to max_turn degrees, with noise.
+static void pair_make(double max_turn, int16_t a[3], int16_t b[3]) {
+  double theta = uniform(0, M_PI);
+  double phi   = uniform(0, 2 * M_PI);
+  double turn  = uniform(-max_turn, max_turn) * M_PI / 180;
+  double g     = uniform(0.8, 1.2) * 16384;
+
+  a[0] = clamp(g * sin(theta) * cos(phi) + uniform(-20, 20));
+  a[1] = clamp(g * sin(theta) * sin(phi) + uniform(-20, 20));
+  a[2] = clamp(g * cos(theta) + uniform(-20, 20));
+  b[0] = clamp(g * sin(theta + turn) * cos(phi) + uniform(-20, 20));
+  b[1] = clamp(g * sin(theta + turn) * sin(phi) + uniform(-20, 20));
+  b[2] = clamp(g * cos(theta + turn) + uniform(-20, 20));
+}
+
+// Count the pairs on which the report decisions differ, and how far from the threshold they lie.
+static int disagreements(double max_turn, double *p_worst) {
+  int count = 0;
+
+  *p_worst = 0;
+  for (int n = 0; n < PAIR_COUNT; n++) {
+    int16_t a[3], b[3];
+    uint32_t fixed;
+
+    pair_make(max_turn, a, b);
+    float change = change_both(a, b, &fixed);
+    if ((fixed > FERRIS_ORIENTATION_THRESHOLD) != (change > FERRIS_ORIENTATION_THRESHOLD_FLOAT)) {
+      double distance = fabs(change / FERRIS_ORIENTATION_THRESHOLD_FLOAT - 1);
+      *p_worst        = distance > *p_worst ? distance : *p_worst;
+      count++;
+    }
+  }
+  return count;
+}
+
+static void test_threshold_equivalence(void) {
+  double worst;
+
+  srand(5);
+  // turns up to 11.5 degrees (0.2 rad), the paths disagree on at most 0.05 % of the pairs
+  CHECK(disagreements(11.5, &worst) <= PAIR_COUNT / 2000);
+  CHECK(worst < 0.03);
+  // turns packed around the 1.7 degree threshold, a disagreement is a pair within 3 % of it
+  // in |U x V|^2, 0.025 degree in angle
+  CHECK(disagreements(4, &worst) <= PAIR_COUNT / 500);
+  CHECK(worst < 0.03);
+}
+
+// |U x V| of the fixed path against the float path, in fixed units.
+static double length_error(uint32_t fixed, float change) {
+  return fabs(sqrt(fixed) - sqrt(change * FLOAT_TO_FIXED));
+}
+
+// Away from the threshold the fixed path follows the float path, the full scale included.
+static void test_value(void) {
+  int16_t const extremes[][3] = {
+      {INT16_MIN, INT16_MIN, INT16_MIN}, {INT16_MAX, INT16_MIN, INT16_MAX}, {INT16_MIN, INT16_MAX, 0},
+      {INT16_MAX, INT16_MAX, INT16_MIN}, {0, INT16_MIN, INT16_MAX},          {INT16_MIN, 0, 0},
+  };
+  int count = sizeof(extremes) / sizeof(extremes[0]);
+  uint32_t fixed;
+
+  for (int i = 0; i < count; i++) {
+    for (int j = 0; j < count; j++) {
+      float change = change_both(extremes[i], extremes[j], &fixed);
+      CHECK(length_error(fixed, change) <= LENGTH_TOLERANCE);
+    }
+  }
+
+  srand(6);
+  for (int n = 0; n < PAIR_COUNT / 10; n++) {
+    int16_t a[3], b[3];
+
+    for (int i = 0; i < 3; i++) {
+      a[i] = (int16_t)(rand() & 0xFFFF);
+      b[i] = (int16_t)(rand() & 0xFFFF);
+    }
+    float change = change_both(a, b, &fixed);
+    CHECK(length_error(fixed, change) <= LENGTH_TOLERANCE);
+  }
+}
+
+static void test_decode(void) {
+  uint8_t const value[6] = {0x40, 0x00, 0xC0, 0x00, 0x80, 0x00};
+  int16_t acc[3];
+  float acc_float[3];
+
+  ferris_orientation_decode(value, acc);
+  ferris_orientation_decode_float(value, acc_float);
+  CHECK_EQ(acc[0], 16384);
+  CHECK_EQ(acc[1], -16384);
+  CHECK_EQ(acc[2], INT16_MIN);
+  CHECK(acc_float[0] == 10.0f && acc_float[1] == -10.0f && acc_float[2] == -20.0f);
+}
+
+int main(void) {
+  test_threshold_equivalence();
+  test_value();
+  test_decode();
+  return UNIT_END();
+}
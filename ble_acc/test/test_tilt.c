@@ -0,0 +1,108 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "ferris_tilt.h"
+#include "unit.h"
+
+#define TURN 65536
+#define RATE_HZ 50
+
+static int32_t angle_error(uint16_t actual, double expected) {
+  double e = fmod(actual - expected + 1.5 * TURN, TURN) - 0.5 * TURN;
+  return (int32_t)lround(fabs(e));
+}
+
+static void test_atan2(void) {
+  int32_t worst = 0;
+
+  for (int d = 0; d < 3600; d++) {
+    double a  = d * 2 * M_PI / 3600;
+    int16_t x = (int16_t)lround(16000 * cos(a));
+    int16_t y = (int16_t)lround(16000 * sin(a));
+    int32_t e = angle_error(ferris_tilt_atan2(y, x), fmod(a / (2 * M_PI) * TURN, TURN));
+
+    if (e > worst) {
+      worst = e;
+    }
+  }
+  CHECK(worst <= 8); // 0.05 degree
+
+  // the CORDIC residue is a unit either way
+  CHECK(angle_error(ferris_tilt_atan2(0, 1000), 0) <= 1);
+  CHECK(angle_error(ferris_tilt_atan2(1000, 0), TURN / 4) <= 1);
+  CHECK(angle_error(ferris_tilt_atan2(0, -1000), TURN / 2) <= 1);
+  CHECK(angle_error(ferris_tilt_atan2(-1000, 0), 3 * TURN / 4) <= 1);
+  CHECK(angle_error(ferris_tilt_atan2(INT16_MIN, INT16_MIN), 5 * TURN / 8) <= 8);
+}
+
+// Turn the wheel at rpm for seconds, return the last published speed.
+static int16_t wheel_run(ferris_tilt_t *p_tilt, double rpm, int seconds, int noise) {
+  int windows = 0;
+
+  for (int i = 0; i < RATE_HZ * seconds; i++) {
+    // gravity turns against the wheel
+    double a       = -rpm / 60 * 2 * M_PI * i / RATE_HZ;
+    int16_t acc[3] = {(int16_t)(16384 * cos(a) + (noise ? rand() % noise - noise / 2 : 0)),
+                      (int16_t)(16384 * sin(a) + (noise ? rand() % noise - noise / 2 : 0)), 0};
+    uint16_t time  = (uint16_t)((uint32_t)i * 1024 / RATE_HZ);
+
+    if (ferris_tilt_update(p_tilt, acc, time)) {
+      windows++;
+    }
+  }
+  CHECK(windows >= seconds * 1000 / FERRIS_TILT_PERIOD_MS - 2);
+  return p_tilt->rpm;
+}
+
+static void test_speed(void) {
+  ferris_tilt_t tilt;
+
+  srand(2);
+  ferris_tilt_reset(&tilt);
+  CHECK(abs(wheel_run(&tilt, 2, 20, 0) - 200) <= 4);
+  ferris_tilt_reset(&tilt);
+  CHECK(abs(wheel_run(&tilt, -12.5, 20, 200) + 1250) <= 15);
+  ferris_tilt_reset(&tilt);
+  CHECK(abs(wheel_run(&tilt, 0, 10, 200)) <= 2);
+}
+
+static void test_gap(void) {
+  ferris_tilt_t tilt;
+  int16_t acc[3] = {16384, 0, 0};
+
+  ferris_tilt_reset(&tilt);
+  wheel_run(&tilt, 5, 5, 0);
+  CHECK(tilt.rpm != 0);
+  // acquisition stopped for 10 s, the time stamps wrap every 64 s
+  CHECK(ferris_tilt_update(&tilt, acc, (uint16_t)(15 * 1024)));
+  CHECK_EQ(tilt.rpm, 0);
+}
+
+static void test_axle_up(void) {
+  ferris_tilt_t tilt;
+  int16_t acc[3] = {FERRIS_TILT_MIN_PLANE / 4, -FERRIS_TILT_MIN_PLANE / 4, 16384};
+
+  ferris_tilt_reset(&tilt);
+  for (int i = 0; i < 5 * RATE_HZ; i++) {
+    CHECK(!ferris_tilt_update(&tilt, acc, (uint16_t)(i * 1024 / RATE_HZ)));
+  }
+  CHECK(!tilt.valid);
+}
+
+static void test_encode(void) {
+  ferris_tilt_t tilt = {.valid = true, .position = -0x12345678, .rpm = -1250};
+  uint8_t data[FERRIS_TILT_VALUE_SIZE];
+
+  ferris_tilt_encode(&tilt, data);
+  CHECK_EQ(data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24, (uint32_t)-0x12345678);
+  CHECK_EQ((int16_t)(data[4] | data[5] << 8), -1250);
+}
+
+int main(void) {
+  test_atan2();
+  test_speed();
+  test_gap();
+  test_axle_up();
+  test_encode();
+  return UNIT_END();
+}
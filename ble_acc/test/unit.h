@@ -0,0 +1,33 @@
+#ifndef UNIT_H
+#define UNIT_H
+
+#include <stdio.h>
+
+/** @file
+ * @brief Checks for the host tests. A failed check is reported and the test goes on, the
+ *        exit status of UNIT_END() tells make whether any failed.
+ */
+
+static int unit_failures;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      unit_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                                               \
+  do {                                                                                           \
+    long long unit_a = (long long)(actual), unit_e = (long long)(expected);                      \
+    if (unit_a != unit_e) {                                                                      \
+      fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, unit_a, \
+              unit_e);                                                                           \
+      unit_failures++;                                                                           \
+    }                                                                                            \
+  } while (0)
+
+#define UNIT_END() (unit_failures ? 1 : 0)
+
+#endif